@@ -876,6 +876,45 @@ LIBVLC_API
 void libvlc_media_slaves_release( libvlc_media_slave_t **pp_slaves,
                                   unsigned int i_count );
 
+/**
+ * Callback prototype for thumbnails.
+ *
+ * \param opaque data pointer as passed to libvlc_media_thumbnails()
+ * \param i_time time of the decoded frame (in ms)
+ * \param p_data encoded image
+ * \param i_size size of the encoded image in bytes
+ */
+typedef void (*libvlc_media_thumbnail_cb)( void *opaque, libvlc_time_t i_time,
+                                           const void *p_data, size_t i_size );
+
+/**
+ * Generate thumbnails of a media
+ *
+ * The media is opened once for all the thumbnails. Each of them is decoded
+ * from the keyframe closest to the requested time, which is fast enough to
+ * build seek bar previews or sprite sheets of long media. This function is
+ * synchronous.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param p_times times of the thumbnails (in ms)
+ * \param i_count number of elements in p_times
+ * \param i_width thumbnails width (0 to preserve the aspect ratio)
+ * \param i_height thumbnails height (0 to preserve the aspect ratio)
+ * \param psz_format image format (e.g. "png" or "jpg")
+ * \param cb callback invoked once per generated thumbnail
+ * \param opaque data pointer for the callback
+ *
+ * \return the number of generated thumbnails, or -1 on error
+ */
+LIBVLC_API
+int libvlc_media_thumbnails( libvlc_media_t *p_md,
+                             const libvlc_time_t *p_times, unsigned i_count,
+                             unsigned i_width, unsigned i_height,
+                             const char *psz_format,
+                             libvlc_media_thumbnail_cb cb, void *opaque );
+
 /** @}*/
 
 # ifdef __cplusplus
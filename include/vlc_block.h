@@ -215,6 +215,35 @@ static inline block_t *block_Duplicate( block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares a block payload.
+ *
+ * Creates a new block referencing the payload of an existing block, without
+ * copying it. Each block has its own view of the payload (p_buffer and
+ * i_buffer) and its own properties, and is released independently. The
+ * memory is freed with the last reference.
+ *
+ * The payload of shared blocks is read-only. block_Realloc() copies it when
+ * a view needs to grow, and block_Unshare() returns a private copy.
+ *
+ * @param pp_block block to share [IN/OUT];
+ * it may be replaced with an equivalent block on the first call
+ * @return the new reference on success, NULL on error
+ * (in which case *pp_block is left untouched).
+ */
+VLC_API block_t *block_Share(block_t **pp_block) VLC_USED;
+
+/**
+ * Gets a writable block.
+ *
+ * Returns the block itself if no other block shares its payload, or a
+ * private copy of it otherwise.
+ *
+ * @note On error, the block is released.
+ * @return a block with a writable payload, or NULL on memory error.
+ */
+VLC_API block_t *block_Unshare(block_t *) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -433,6 +433,47 @@ VLC_API decoder_t * demux_PacketizerNew( demux_t *p_demux, es_format_t *p_fmt, c
  */
 VLC_API void demux_PacketizerDestroy( decoder_t *p_packetizer );
 
+/**
+ * Entry of a cached demuxer index.
+ *
+ * Apart from the byte offset, the meaning of the fields is up to the demuxer.
+ */
+typedef struct
+{
+    int64_t  i_time;   /**< timestamp, or demuxer-defined position */
+    uint64_t i_offset; /**< byte offset in the file */
+    uint32_t i_size;   /**< size of the indexed data, or 0 if unknown */
+    uint32_t i_stream; /**< track or stream the entry belongs to */
+    uint32_t i_flags;  /**< demuxer-defined flags (e.g. key frame) */
+} demux_index_entry_t;
+
+/**
+ * Loads an index saved by demux_IndexSave() for the same local file.
+ *
+ * The cache is keyed by the file path, size and modification time, so
+ * modified files are indexed again.
+ *
+ * \param psz_name demuxer-defined name of the index (should be bumped when
+ *                 the meaning of the entries changes)
+ * \param pp_entries pointer to the table, to be freed by the caller [OUT]
+ * \param pi_count pointer to the number of entries [OUT]
+ * \return VLC_SUCCESS, or an error if no (valid) index is cached
+ */
+VLC_API int demux_IndexLoad( demux_t *p_demux, const char *psz_name,
+                             demux_index_entry_t **pp_entries,
+                             size_t *pi_count ) VLC_USED;
+
+/**
+ * Saves an index of the current local file into the user cache.
+ *
+ * This is meant for indexes that are expensive to build, typically by
+ * scanning the whole file. The cache size is bounded: the oldest tables
+ * are removed when saving a new one.
+ */
+VLC_API int demux_IndexSave( demux_t *p_demux, const char *psz_name,
+                             const demux_index_entry_t *p_entries,
+                             size_t i_count );
+
 /* */
 #define DEMUX_INIT_COMMON() do {            \
     p_demux->pf_control = Control;          \
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * vlc_fft.h: fast Fourier transform
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FFT_H
+#define VLC_FFT_H 1
+
+/**
+ * \defgroup fft Fast Fourier transform
+ * \ingroup misc
+ * Spectrum analysis of real signals
+ *
+ * The transform of N real samples is computed as a complex transform of
+ * N/2 points, vectorized where the CPU allows it. The precomputed tables
+ * (plans) are cached and shared, so that getting a plan for a size already
+ * in use is cheap.
+ * @{
+ * \file
+ * Fast Fourier transform interface
+ */
+
+typedef struct vlc_fft vlc_fft_t;
+
+/** Largest supported transform size */
+#define VLC_FFT_SIZE_MAX (1u << 20)
+
+/**
+ * Gets a real FFT plan.
+ *
+ * \param size number of real input samples, a power of two between 4 and
+ * VLC_FFT_SIZE_MAX
+ * \return a plan, or NULL on error
+ */
+VLC_API vlc_fft_t *vlc_fft_Get(unsigned size) VLC_USED;
+
+/**
+ * Releases a plan obtained with vlc_fft_Get().
+ */
+VLC_API void vlc_fft_Release(vlc_fft_t *);
+
+/**
+ * Computes the (unnormalized) discrete Fourier transform of real samples:
+ * X[k] = sum(x[n] * exp(-2i * pi * k * n / N))
+ *
+ * Only the first N/2 + 1 bins are computed, the others being their complex
+ * conjugates.
+ *
+ * \param in N real samples
+ * \param re real part of the N/2 + 1 bins [OUT]
+ * \param im imaginary part of the N/2 + 1 bins [OUT]
+ */
+VLC_API void vlc_fft_Real(const vlc_fft_t *, const float *in,
+                          float *restrict re, float *restrict im);
+
+/**
+ * Computes the power of each bin: re^2 + im^2.
+ *
+ * The power may be stored in place of re or im.
+ */
+static inline void vlc_fft_Power(const float *re, const float *im,
+                                 float *power, unsigned bins)
+{
+    for (unsigned i = 0; i < bins; i++)
+        power[i] = re[i] * re[i] + im[i] * im[i];
+}
+
+/** @} */
+
+#endif
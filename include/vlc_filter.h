@@ -26,6 +26,7 @@
 #define VLC_FILTER_H 1
 
 #include <vlc_es.h>
+#include <vlc_block.h>
 
 /**
  * \defgroup filter Filters
@@ -52,6 +53,10 @@ typedef struct filter_owner_t
         {
             subpicture_t * (*buffer_new)( filter_t * );
         } sub;
+        struct
+        {
+            block_t * (*buffer_new)( filter_t *, size_t );
+        } audio;
     };
 } filter_owner_t;
 
@@ -158,6 +163,23 @@ static inline picture_t *filter_NewPicture( filter_t *p_filter )
     return pic;
 }
 
+/**
+ * This function will return a new audio block usable by p_filter as an
+ * output buffer. The block may be recycled by the owner of the filter, so it
+ * should be preferred to block_Alloc() for per-buffer allocations.
+ *
+ * \param p_filter filter_t object
+ * \param i_size size of the block payload in bytes
+ * \return new block on success or NULL on failure
+ */
+static inline block_t *filter_NewAudioBuffer( filter_t *p_filter,
+                                              size_t i_size )
+{
+    if( p_filter->owner.audio.buffer_new == NULL )
+        return block_Alloc( i_size );
+    return p_filter->owner.audio.buffer_new( p_filter, i_size );
+}
+
 /**
  * Flush a filter
  *
@@ -426,5 +448,39 @@ VLC_API int filter_chain_MouseEvent( filter_chain_t *,
 int filter_chain_ForEach( filter_chain_t *chain,
                           int (*cb)( filter_t *, void * ), void *opaque );
 
+/**
+ * Slice processing callback.
+ *
+ * \param opaque data pointer passed to vlc_slice_exec()
+ * \param slice index of the slice to process (from 0 to count - 1)
+ * \param count total number of slices
+ */
+typedef void (*vlc_slice_cb)( void *opaque, unsigned slice, unsigned count );
+
+/**
+ * Processes slices in parallel.
+ *
+ * The slices are spread over a pool of worker threads shared by the whole
+ * LibVLC instance, and over the calling thread. The callback is invoked
+ * exactly once per slice, in no particular order and possibly concurrently.
+ * This function returns only after all slices have been processed.
+ *
+ * \param obj calling object (typically the filter)
+ * \param cb slice processing callback
+ * \param opaque data pointer for the callback
+ * \param count number of slices
+ */
+VLC_API void vlc_slice_exec( vlc_object_t *obj, vlc_slice_cb cb, void *opaque,
+                             unsigned count );
+#define vlc_slice_exec( o, cb, d, n ) \
+        vlc_slice_exec( VLC_OBJECT( o ), cb, d, n )
+
+/**
+ * Gets the number of threads vlc_slice_exec() can use, including the calling
+ * thread. This is a hint for the number of slices to split work into.
+ */
+VLC_API unsigned vlc_slice_threads( vlc_object_t *obj ) VLC_USED;
+#define vlc_slice_threads( o ) vlc_slice_threads( VLC_OBJECT( o ) )
+
 /** @} */
 #endif /* _VLC_FILTER_H */
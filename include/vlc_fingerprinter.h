@@ -35,7 +35,10 @@ typedef struct fingerprinter_sys_t fingerprinter_sys_t;
 struct fingerprint_request_t
 {
     input_item_t *p_item;
-    unsigned int i_duration; /* track length hint in seconds, 0 if unknown */
+    unsigned int i_duration; /* track length in seconds, 0 if unknown: a
+                                hint, then the length found (if still
+                                unknown, the online lookup is skipped) */
+    bool b_fingerprint_only; /* skip the online lookup (no metas result) */
     struct
     {
         char *psz_fingerprint;
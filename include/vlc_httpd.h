@@ -144,6 +144,20 @@ VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, const block_t *p_block );
 VLC_API int httpd_StreamSetHTTPHeaders(httpd_stream_t *, httpd_header *, size_t);
 
+/**
+ * In-memory file, which may be requested while it is still being written.
+ * HTTP/1.1 clients get the data written so far right away and the rest
+ * as it is appended, using the chunked transfer encoding.
+ */
+typedef struct httpd_segment_t httpd_segment_t;
+VLC_API httpd_segment_t * httpd_SegmentNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password ) VLC_USED;
+/** Unregisters the segment. Clients already downloading it are served
+ * until the end, and the data is released after the last of them. */
+VLC_API void httpd_SegmentDelete( httpd_segment_t * );
+VLC_API int httpd_SegmentAppend( httpd_segment_t *, const void *p_data, size_t i_data );
+/** Marks the end of the segment data: no further appends are allowed. */
+VLC_API void httpd_SegmentEnd( httpd_segment_t * );
+
 /* Msg functions facilities */
 VLC_API void httpd_MsgAdd( httpd_message_t *, const char *psz_name, const char *psz_value, ... ) VLC_FORMAT( 3, 4 );
 /* return "" if not found. The string is not allocated */
@@ -432,6 +432,12 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Clock (in microseconds, except the number of late references),
+     * last so that the offsets of the other fields do not change */
+    int64_t i_clock_latency;
+    int64_t i_clock_jitter;
+    int64_t i_clock_late;
 };
 
 #endif
@@ -191,6 +191,18 @@ VLC_API void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src );
  */
 VLC_API void picture_Copy( picture_t *p_dst, const picture_t *p_src );
 
+/**
+ * This function will copy the picture pixels converting them to the chroma
+ * of the destination picture.
+ * Only the NV12 to I420/YV12, I420/YV12 to NV12 and I420/YV12 to YUY2
+ * conversions are supported, in addition to plain copies.
+ *
+ * \param p_dst pointer to the destination picture.
+ * \param p_src pointer to the source picture.
+ * \return VLC_SUCCESS or VLC_EGENERIC if the conversion is not supported.
+ */
+VLC_API int picture_ConvertPixels( picture_t *p_dst, const picture_t *p_src );
+
 /**
  * This function will export a picture to an encoded bitstream.
  *
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: fast thumbnail extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+/**
+ * \defgroup thumbnailer Thumbnailer
+ * \ingroup input
+ * Fast extraction of still images from a media
+ *
+ * The thumbnailer demuxes a media without any input thread, decoder thread
+ * nor video output. Each thumbnail is taken from the keyframe closest to the
+ * requested time and the frames in between are never decoded. A thumbnailer
+ * can extract any number of images from the same media, which avoids
+ * reopening it for every image.
+ * @{
+ * \file
+ * Thumbnailer interface
+ */
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Opens a media for thumbnail extraction.
+ *
+ * \param obj parent object
+ * \param mrl media resource location
+ * \return a thumbnailer, or NULL on error
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_Create(vlc_object_t *obj,
+                                                  const char *mrl) VLC_USED;
+#define vlc_thumbnailer_Create(a, b) vlc_thumbnailer_Create(VLC_OBJECT(a), b)
+
+/**
+ * Extracts one encoded image.
+ *
+ * The image is decoded from the keyframe closest to the given time, then
+ * scaled and encoded in a single pass.
+ *
+ * \param time media time of the thumbnail
+ * \param fmt image format: the chroma is the image codec (e.g. VLC_CODEC_PNG),
+ * a null width or height is computed to preserve the aspect ratio
+ * \param pi_time where to store the time of the decoded frame [OUT]
+ * (can be NULL)
+ * \return the encoded image, or NULL on error
+ */
+VLC_API block_t *vlc_thumbnailer_Extract(vlc_thumbnailer_t *, mtime_t time,
+                                         const video_format_t *fmt,
+                                         mtime_t *pi_time) VLC_USED;
+
+/**
+ * Closes the media.
+ */
+VLC_API void vlc_thumbnailer_Delete(vlc_thumbnailer_t *);
+
+/** @} */
+
+#endif
@@ -38,6 +38,9 @@
 #include <vlc_meta.h>
 #include <vlc_playlist.h> /* For the preparser */
 #include <vlc_url.h>
+#include <vlc_block.h>
+#include <vlc_image.h>
+#include <vlc_thumbnailer.h>
 
 #include "../src/libvlc.h"
 
@@ -1274,3 +1277,58 @@ void libvlc_media_slaves_release( libvlc_media_slave_t **pp_slaves,
     }
     free( pp_slaves );
 }
+
+int libvlc_media_thumbnails( libvlc_media_t *p_md,
+                             const libvlc_time_t *p_times, unsigned i_count,
+                             unsigned i_width, unsigned i_height,
+                             const char *psz_format,
+                             libvlc_media_thumbnail_cb cb, void *opaque )
+{
+    vlc_fourcc_t i_codec = image_Type2Fourcc( psz_format );
+    if( i_codec == 0 )
+    {
+        libvlc_printerr( "Unknown image format: %s", psz_format );
+        return -1;
+    }
+
+    char *psz_uri = input_item_GetURI( p_md->p_input_item );
+    if( psz_uri == NULL )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+
+    vlc_thumbnailer_t *p_thumbnailer =
+        vlc_thumbnailer_Create( p_md->p_libvlc_instance->p_libvlc_int,
+                                psz_uri );
+    free( psz_uri );
+    if( p_thumbnailer == NULL )
+    {
+        libvlc_printerr( "Cannot open the media" );
+        return -1;
+    }
+
+    video_format_t fmt;
+    video_format_Init( &fmt, i_codec );
+    fmt.i_width = i_width;
+    fmt.i_height = i_height;
+
+    int i_done = 0;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        mtime_t i_time;
+        block_t *p_image = vlc_thumbnailer_Extract( p_thumbnailer,
+                                                    to_mtime( p_times[i] ),
+                                                    &fmt, &i_time );
+        if( p_image == NULL )
+            continue;
+
+        cb( opaque, from_mtime( i_time ), p_image->p_buffer,
+            p_image->i_buffer );
+        block_Release( p_image );
+        i_done++;
+    }
+
+    vlc_thumbnailer_Delete( p_thumbnailer );
+    return i_done;
+}
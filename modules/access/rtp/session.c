@@ -25,6 +25,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -35,6 +36,80 @@
 
 typedef struct rtp_source_t rtp_source_t;
 
+/** Number of bits of the SSRC hash (i.e. log2 of the bucket count) */
+#define RTP_SRC_HASH_BITS 6
+
+/** Per-source reception statistics */
+typedef struct
+{
+    uint64_t received; /* packets accepted in the re-ordering queue */
+    uint64_t lost; /* packets never received (sequence gaps) */
+    uint64_t late; /* packets received after their successor was decoded */
+    uint64_t duplicate; /* packets received more than once */
+} rtp_stats_t;
+
+/** Suffixes of the statistics variables (see rtp_stats_publish()) */
+static const char *const rtp_stats_names[] = {
+    "packets-received", "packets-lost", "packets-late", "packets-duplicate",
+    "jitter",
+};
+#define RTP_STATS_COUNT (sizeof (rtp_stats_names) / sizeof (rtp_stats_names[0]))
+
+/**
+ * Formats the name of a statistics variable. The session totals are named
+ * rtp-<statistic>, and the statistics of each source are named
+ * rtp-<SSRC in hexadecimal>-<statistic>.
+ */
+static void rtp_stats_name (char name[32], const uint32_t *ssrc, unsigned i)
+{
+    if (ssrc != NULL)
+        snprintf (name, 32, "rtp-%08"PRIx32"-%s", *ssrc, rtp_stats_names[i]);
+    else
+        snprintf (name, 32, "rtp-%s", rtp_stats_names[i]);
+}
+
+static void rtp_stats_create (demux_t *demux, const uint32_t *ssrc)
+{
+    for (unsigned i = 0; i < RTP_STATS_COUNT; i++)
+    {
+        char name[32];
+
+        rtp_stats_name (name, ssrc, i);
+        var_Create (demux, name, VLC_VAR_INTEGER);
+    }
+}
+
+static void rtp_stats_destroy (demux_t *demux, const uint32_t *ssrc)
+{
+    for (unsigned i = 0; i < RTP_STATS_COUNT; i++)
+    {
+        char name[32];
+
+        rtp_stats_name (name, ssrc, i);
+        var_Destroy (demux, name);
+    }
+}
+
+/**
+ * Publishes reception statistics as demux object variables.
+ * @param jitter jitter estimate (microseconds)
+ */
+static void rtp_stats_publish (demux_t *demux, const uint32_t *ssrc,
+                               const rtp_stats_t *stats, mtime_t jitter)
+{
+    const uint64_t values[RTP_STATS_COUNT] = {
+        stats->received, stats->lost, stats->late, stats->duplicate, jitter,
+    };
+
+    for (unsigned i = 0; i < RTP_STATS_COUNT; i++)
+    {
+        char name[32];
+
+        rtp_stats_name (name, ssrc, i);
+        var_SetInteger (demux, name, values[i]);
+    }
+}
+
 /** State for a RTP session: */
 struct rtp_session_t
 {
@@ -42,12 +117,15 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+    rtp_source_t  *srch[1 << RTP_SRC_HASH_BITS]; /* sources hashed by SSRC */
+    mtime_t        next_tick; /* next garbage collection and statistics */
+    rtp_stats_t    stats; /* statistics of already expired sources */
 };
 
 static rtp_source_t *
 rtp_source_create (demux_t *, const rtp_session_t *, uint32_t, uint16_t);
 static void
-rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
+rtp_source_destroy (demux_t *, rtp_session_t *, rtp_source_t *);
 
 static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
 
@@ -65,8 +143,13 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    for (unsigned i = 0; i < (1 << RTP_SRC_HASH_BITS); i++)
+        session->srch[i] = NULL;
+    session->next_tick = VLC_TS_INVALID;
+    memset (&session->stats, 0, sizeof (session->stats));
 
-    (void)demux;
+    /* Reception statistics, refreshed by rtp_queue() */
+    rtp_stats_create (demux, NULL);
     return session;
 }
 
@@ -76,13 +159,12 @@ rtp_session_create (demux_t *demux)
  */
 void rtp_session_destroy (demux_t *demux, rtp_session_t *session)
 {
-    for (unsigned i = 0; i < session->srcc; i++)
-        rtp_source_destroy (demux, session, session->srcv[i]);
+    while (session->srcc > 0)
+        rtp_source_destroy (demux, session, session->srcv[0]);
 
     free (session->srcv);
     free (session->ptv);
     free (session);
-    (void)demux;
 }
 
 static void *no_init (demux_t *demux)
@@ -136,8 +218,12 @@ int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt)
 /** State for an RTP source */
 struct rtp_source_t
 {
+    rtp_source_t *hnext; /* next source in the same SSRC hash bucket */
+    unsigned index; /* position within the session sources table */
+
     uint32_t ssrc;
     uint32_t jitter;  /* interarrival delay jitter estimate */
+    uint32_t frequency; /* RTP clock rate of the jitter estimate */
     mtime_t  last_rx; /* last received packet local timestamp */
     uint32_t last_ts; /* last received packet RTP timestamp */
 
@@ -147,11 +233,21 @@ struct rtp_source_t
     uint16_t bad_seq; /* tentatively next expected sequence for resync */
     uint16_t max_seq; /* next expected sequence */
 
-    uint16_t last_seq; /* sequence of the next dequeued packet */
-    block_t *blocks; /* re-ordered blocks queue */
+    uint16_t last_seq; /* sequence of the last dequeued packet */
+    bool     discontinuity; /* flag the next dequeued packet */
+    uint16_t ring_mask; /* re-ordering ring size minus one */
+    unsigned pending; /* number of blocks in the re-ordering ring */
+    block_t **ring; /* re-ordering ring, indexed by sequence number */
+    rtp_stats_t stats;
     void    *opaque[]; /* Per-source private payload data */
 };
 
+static inline unsigned rtp_ssrc_hash (uint32_t ssrc)
+{
+    /* SSRCs are supposed to be random, but some senders are lazy... */
+    return (ssrc * UINT32_C(0x9E3779B1)) >> (32 - RTP_SRC_HASH_BITS);
+}
+
 /**
  * Initializes a new RTP source within an RTP session.
  */
@@ -159,45 +255,174 @@ static rtp_source_t *
 rtp_source_create (demux_t *demux, const rtp_session_t *session,
                    uint32_t ssrc, uint16_t init_seq)
 {
+    const demux_sys_t *p_sys = demux->p_sys;
     rtp_source_t *source;
 
     source = malloc (sizeof (*source) + (sizeof (void *) * session->ptc));
     if (source == NULL)
         return NULL;
 
+    /* The re-ordering ring must hold any packet up to the maximum dropout
+     * ahead of the next expected one. */
+    unsigned size = 64;
+    while (size <= p_sys->max_dropout && size < 0x8000)
+        size <<= 1;
+
+    source->ring = calloc (size, sizeof (*source->ring));
+    if (source->ring == NULL)
+    {
+        free (source);
+        return NULL;
+    }
+
+    source->hnext = NULL;
     source->ssrc = ssrc;
     source->jitter = 0;
+    source->frequency = 0;
     source->ref_rtp = 0;
     /* TODO: use VLC_TS_0, but VLC does not like negative PTS at the moment */
     source->ref_ntp = UINT64_C (1) << 62;
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
-    source->blocks = NULL;
+    source->discontinuity = false;
+    source->ring_mask = size - 1;
+    source->pending = 0;
+    memset (&source->stats, 0, sizeof (source->stats));
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
         source->opaque[i] = session->ptv[i].init (demux);
 
+    rtp_stats_create (demux, &ssrc);
     msg_Dbg (demux, "added RTP source (%08x)", ssrc);
     return source;
 }
 
+/**
+ * Releases all blocks pending in the re-ordering ring of an RTP source.
+ */
+static void rtp_source_flush (rtp_source_t *source)
+{
+    for (unsigned i = 0; source->pending > 0; i++)
+    {
+        assert (i <= source->ring_mask);
+        if (source->ring[i] != NULL)
+        {
+            block_Release (source->ring[i]);
+            source->ring[i] = NULL;
+            source->pending--;
+        }
+    }
+}
 
 /**
- * Destroys an RTP source and its associated streams.
+ * Destroys an RTP source and its associated streams,
+ * and removes it from its RTP session.
  */
 static void
-rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
+rtp_source_destroy (demux_t *demux, rtp_session_t *session,
                     rtp_source_t *source)
 {
-    msg_Dbg (demux, "removing RTP source (%08x)", source->ssrc);
+    msg_Dbg (demux, "removing RTP source (%08x): %"PRIu64" received, "
+             "%"PRIu64" lost, %"PRIu64" late, %"PRIu64" duplicate packet(s)",
+             source->ssrc, source->stats.received, source->stats.lost,
+             source->stats.late, source->stats.duplicate);
+
+    /* Unlink from the hash table and the sources table */
+    rtp_source_t **pp = &session->srch[rtp_ssrc_hash (source->ssrc)];
+    while (*pp != source)
+        pp = &(*pp)->hnext;
+    *pp = source->hnext;
+
+    assert (session->srcv[source->index] == source);
+    if (--session->srcc > source->index)
+    {
+        rtp_source_t *last = session->srcv[session->srcc];
+        last->index = source->index;
+        session->srcv[source->index] = last;
+    }
+
+    session->stats.received += source->stats.received;
+    session->stats.lost += source->stats.lost;
+    session->stats.late += source->stats.late;
+    session->stats.duplicate += source->stats.duplicate;
+    rtp_stats_destroy (demux, &source->ssrc);
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
-    block_ChainRelease (source->blocks);
+    rtp_source_flush (source);
+    free (source->ring);
     free (source);
 }
 
+/**
+ * Looks an RTP source up by SSRC.
+ */
+static rtp_source_t *
+rtp_source_find (const rtp_session_t *session, uint32_t ssrc)
+{
+    rtp_source_t *src = session->srch[rtp_ssrc_hash (ssrc)];
+
+    while (src != NULL && src->ssrc != ssrc)
+        src = src->hnext;
+    return src;
+}
+
+/**
+ * Expires inactive RTP sources and publishes the per-source statistics and
+ * the session totals as demux object variables.
+ */
+static void rtp_session_tick (demux_t *demux, rtp_session_t *session,
+                              mtime_t now)
+{
+    demux_sys_t *p_sys = demux->p_sys;
+    rtp_stats_t total;
+    mtime_t jitter = 0;
+
+    /* RTP source garbage collection */
+    for (unsigned i = session->srcc; i-- > 0;)
+    {
+        rtp_source_t *src = session->srcv[i];
+
+        if ((src->last_rx + p_sys->timeout) < now)
+            rtp_source_destroy (demux, session, src);
+    }
+    total = session->stats;
+
+    for (unsigned i = 0; i < session->srcc; i++)
+    {
+        const rtp_source_t *src = session->srcv[i];
+
+        total.received += src->stats.received;
+        total.lost += src->stats.lost;
+        total.late += src->stats.late;
+        total.duplicate += src->stats.duplicate;
+
+        mtime_t d = 0;
+        if (src->frequency != 0)
+            d = CLOCK_FREQ * (mtime_t)src->jitter / src->frequency;
+        if (d > jitter)
+            jitter = d;
+        rtp_stats_publish (demux, &src->ssrc, &src->stats, d);
+    }
+
+    rtp_stats_publish (demux, NULL, &total, jitter);
+}
+
+/**
+ * Returns the slot of the first queued block of an RTP source
+ * in sequence order.
+ */
+static block_t **rtp_source_head (rtp_source_t *src)
+{
+    uint16_t seq = src->last_seq + 1;
+
+    assert (src->pending > 0);
+    while (src->ring[seq & src->ring_mask] == NULL)
+        seq++;
+    return &src->ring[seq & src->ring_mask];
+}
+
 static inline uint16_t rtp_seq (const block_t *block)
 {
     assert (block->i_buffer >= 4);
@@ -257,29 +482,18 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     }
 
     mtime_t        now = mdate ();
-    rtp_source_t  *src  = NULL;
     const uint16_t seq  = rtp_seq (block);
     const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
 
-    /* In most case, we know this source already */
-    for (unsigned i = 0, max = session->srcc; i < max; i++)
+    if (now >= session->next_tick)
     {
-        rtp_source_t *tmp = session->srcv[i];
-        if (tmp->ssrc == ssrc)
-        {
-            src = tmp;
-            break;
-        }
-
-        /* RTP source garbage collection */
-        if ((tmp->last_rx + p_sys->timeout) < now)
-        {
-            rtp_source_destroy (demux, session, tmp);
-            if (--session->srcc > 0)
-                session->srcv[i] = session->srcv[session->srcc - 1];
-        }
+        rtp_session_tick (demux, session, now);
+        session->next_tick = now + CLOCK_FREQ;
     }
 
+    /* In most case, we know this source already */
+    rtp_source_t *src = rtp_source_find (session, ssrc);
+
     if (src == NULL)
     {
         /* New source */
@@ -299,7 +513,12 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (src == NULL)
             goto drop;
 
+        src->index = session->srcc;
         tab[session->srcc++] = src;
+
+        rtp_source_t **bucket = &session->srch[rtp_ssrc_hash (ssrc)];
+        src->hnext = *bucket;
+        *bucket = src;
         /* Cannot compute jitter yet */
     }
     else
@@ -317,6 +536,7 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
             d        -=    ts - src->last_ts;
             if (d < 0) d = -d;
             src->jitter += ((d - src->jitter) + 8) >> 4;
+            src->frequency = freq;
         }
     }
     src->last_rx = now;
@@ -335,10 +555,10 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (seq == src->bad_seq)
         {
             src->max_seq = src->bad_seq = seq + 1;
-            src->last_seq = seq - 0x7fffe; /* hack for rtp_decode() */
+            src->last_seq = seq - 1;
+            src->discontinuity = true;
             msg_Warn (demux, "sequence resynchronized");
-            block_ChainRelease (src->blocks);
-            src->blocks = NULL;
+            rtp_source_flush (src);
         }
         else
         {
@@ -350,23 +570,44 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     if (delta_seq >= 0)
         src->max_seq = seq + 1;
 
+    /* Trash too late packets (and PIM Assert duplicates) */
+    if ((int16_t)(seq - (src->last_seq + 1)) < 0)
+    {
+        msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")", seq);
+        src->stats.late++;
+        goto drop;
+    }
+
+    /* Make room in the re-ordering ring: give up on missing packets that
+     * are too far behind. */
+    while (src->pending > 0
+        && (uint16_t)(seq - (src->last_seq + 1)) > src->ring_mask)
+        rtp_decode (demux, session, src);
+
     /* Queues the block in sequence order,
      * hence there is a single queue for all payload types. */
-    block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    block_t **slot = &src->ring[seq & src->ring_mask];
+    if (*slot != NULL)
     {
-        int16_t delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
-            break;
-        if (delta_seq == 0)
+        if (rtp_seq (*slot) == seq)
         {
             msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+            src->stats.duplicate++;
             goto drop; /* duplicate */
         }
-        pp = &prev->p_next;
+
+        /* Different packet in the same slot: the ring has wrapped around,
+         * so the queued packets cannot be ordered anymore. */
+        msg_Warn (demux, "re-ordering ring overflow"
+                  " (got: %"PRIu16", queued: %"PRIu16")", seq, rtp_seq (*slot));
+        rtp_source_flush (src);
+        src->last_seq = seq - 1;
+        src->discontinuity = true;
     }
-    block->p_next = *pp;
-    *pp = block;
+    block->p_next = NULL;
+    *slot = block;
+    src->pending++;
+    src->stats.received++;
 
     /*rtp_decode (demux, session, src);*/
     return;
@@ -401,7 +642,6 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
         /* Because of IP packet delay variation (IPDV), we need to guesstimate
          * how long to wait for a missing packet in the RTP sequence
@@ -419,10 +659,12 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
          * LibVLC E/S-out clock synchronization. Here, we need to bother about
          * re-ordering packets, as decoders can't cope with mis-ordered data.
          */
-        while (((block = src->blocks)) != NULL)
+        while (src->pending > 0)
         {
-            if ((int16_t)(rtp_seq (block) - (src->last_seq + 1)) <= 0)
-            {   /* Next (or earlier) block ready, no need to wait */
+            block_t *block = *rtp_source_head (src);
+
+            if (rtp_seq (block) == (uint16_t)(src->last_seq + 1))
+            {   /* Next block ready, no need to wait */
                 rtp_decode (demux, session, src);
                 continue;
             }
@@ -470,9 +712,8 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
-        while (((block = src->blocks)) != NULL)
+        while (src->pending > 0)
             rtp_decode (demux, session, src);
     }
 }
@@ -483,24 +724,24 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
 static void
 rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
 {
-    block_t *block = src->blocks;
+    block_t **slot = rtp_source_head (src);
+    block_t *block = *slot;
 
-    assert (block);
-    src->blocks = block->p_next;
-    block->p_next = NULL;
+    *slot = NULL;
+    src->pending--;
 
     /* Discontinuity detection */
     uint16_t delta_seq = rtp_seq (block) - (src->last_seq + 1);
     if (delta_seq != 0)
     {
-        if (delta_seq >= 0x8000)
-        {   /* Trash too late packets (and PIM Assert duplicates) */
-            msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
-                      rtp_seq (block));
-            goto drop;
-        }
         msg_Warn (demux, "%"PRIu16" packet(s) lost", delta_seq);
+        src->stats.lost += delta_seq;
+        block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    }
+    if (src->discontinuity)
+    {
         block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        src->discontinuity = false;
     }
     src->last_seq = rtp_seq (block);
 
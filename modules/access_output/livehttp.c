@@ -43,6 +43,8 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
+#include <vlc_memstream.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -105,6 +107,13 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define HTTPD_TEXT N_("Serve from memory")
+#define HTTPD_LONGTEXT N_("Keep the segments in memory and serve them and "\
+                          "the index with the built-in HTTP server instead of "\
+                          "writing files. The segment and index paths are "\
+                          "then URL paths (see --http-host and --http-port). "\
+                          "Segments are available while they are written.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +144,8 @@ vlc_module_begin ()
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "httpd", false,
+              HTTPD_TEXT, HTTPD_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,6 +167,7 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "httpd",
     NULL
 };
 
@@ -172,6 +184,7 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    httpd_segment_t *p_httpd;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -206,6 +219,14 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t segments_t;
+
+    /* In-memory mode */
+    bool b_httpd;
+    httpd_host_t *p_httpd_host;
+    httpd_file_t *p_httpd_index;
+    httpd_segment_t *p_cursegment;
+    vlc_mutex_t lock; /* protects psz_index */
+    char *psz_index;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -213,6 +234,8 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static int IndexCallback( httpd_file_sys_t *, httpd_file_t *, uint8_t *,
+                          uint8_t **, int * );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -250,6 +273,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_ratecontrol = var_GetBool( p_access, SOUT_CFG_PREFIX "ratecontrol") ;
     p_sys->b_caching = var_GetBool( p_access, SOUT_CFG_PREFIX "caching") ;
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
+    p_sys->b_httpd = var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" );
     p_sys->b_segment_has_data = false;
 
     vlc_array_init( &p_sys->segments_t );
@@ -271,7 +295,7 @@ static int Open( vlc_object_t *p_this )
             return VLC_ENOMEM;
         }
         p_sys->psz_indexPath = psz_tmp;
-        if( p_sys->i_initial_segment != 1 )
+        if( p_sys->i_initial_segment != 1 && !p_sys->b_httpd )
             vlc_unlink( p_sys->psz_indexPath );
     }
 
@@ -301,6 +325,42 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = -1;
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
+    p_sys->p_cursegment = NULL;
+    p_sys->psz_index = NULL;
+    vlc_mutex_init( &p_sys->lock );
+
+    if( p_sys->b_httpd )
+    {
+        p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+        if( p_sys->p_httpd_host && p_sys->psz_indexPath )
+        {
+            p_sys->p_httpd_index = httpd_FileNew( p_sys->p_httpd_host,
+                                        p_sys->psz_indexPath,
+                                        "application/vnd.apple.mpegurl",
+                                        NULL, NULL, IndexCallback,
+                                        (httpd_file_sys_t *)p_sys );
+            if( p_sys->p_httpd_index == NULL )
+            {
+                httpd_HostDelete( p_sys->p_httpd_host );
+                p_sys->p_httpd_host = NULL;
+            }
+        }
+
+        if( p_sys->p_httpd_host == NULL )
+        {
+            msg_Err( p_access, "cannot start HTTP server" );
+            if( p_sys->key_uri )
+            {
+                gcry_cipher_close( p_sys->aes_ctx );
+                free( p_sys->key_uri );
+            }
+            vlc_mutex_destroy( &p_sys->lock );
+            free( p_sys->psz_indexUrl );
+            free( p_sys->psz_indexPath );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
 
     p_access->pf_write = Write;
     p_access->pf_seek  = Seek;
@@ -508,6 +568,8 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg )
 
 static void destroySegment( output_segment_t *segment )
 {
+    if( segment->p_httpd )
+        httpd_SegmentDelete( segment->p_httpd );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -558,131 +620,162 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
 }
 
 /************************************************************************
- * updateIndexAndDel: If necessary, update index file & delete old segments
+ * getFirstSegment: number of the first segment of the index, and index of
+ * that segment in p_sys->segments_t
  ************************************************************************/
-static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static uint32_t getFirstSegment( sout_access_out_sys_t *p_sys, unsigned *pi_index_offset )
 {
-
-    uint32_t i_firstseg;
-    unsigned i_index_offset = 0;
+    *pi_index_offset = 0;
 
     if ( p_sys->i_numsegs == 0 ||
          p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_initial_segment ) )
-    {
-        i_firstseg = p_sys->i_initial_segment;
-    }
-    else
-    {
-        unsigned numsegs = segmentAmountNeeded( p_sys );
-        i_firstseg = ( p_sys->i_segment - numsegs ) + 1;
-        i_index_offset = vlc_array_count( &p_sys->segments_t ) - numsegs;
-    }
+        return p_sys->i_initial_segment;
 
-    // First update index
-    if ( p_sys->psz_indexPath )
-    {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
-            return -1;
+    unsigned numsegs = segmentAmountNeeded( p_sys );
+    *pi_index_offset = vlc_array_count( &p_sys->segments_t ) - numsegs;
+    return ( p_sys->i_segment - numsegs ) + 1;
+}
 
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
-            return -1;
-        }
+/************************************************************************
+ * formatIndex: generate the playlist
+ ************************************************************************/
+static char *formatIndex( sout_access_out_sys_t *p_sys, uint32_t i_firstseg,
+                          unsigned i_index_offset, bool b_isend )
+{
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) )
+        return NULL;
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+    vlc_memstream_printf( &ms, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
                           "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
                           p_sys->b_caching ? "YES" : "NO",
                           p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
                           i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
-        char *psz_current_uri=NULL;
+                          );
 
+    const char *psz_current_uri = NULL;
 
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            //scale to i_index_offset..numsegs + i_index_offset
-            uint32_t index = i - i_firstseg + i_index_offset;
+    for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
+    {
+        //scale to i_index_offset..numsegs + i_index_offset
+        uint32_t index = i - i_firstseg + i_index_offset;
 
-            output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, index );
-            if( p_sys->key_uri &&
-                ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
-              )
+        output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, index );
+        if( p_sys->key_uri &&
+            ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
+          )
+        {
+            psz_current_uri = segment->psz_key_uri;
+            if( p_sys->b_generate_iv )
             {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
-                if( p_sys->b_generate_iv )
-                {
-                    unsigned long long iv_hi = segment->aes_ivs[0];
-                    unsigned long long iv_lo = segment->aes_ivs[8];
-                    for( unsigned short i = 1; i < 8; i++ )
-                    {
-                        iv_hi <<= 8;
-                        iv_hi |= segment->aes_ivs[i] & 0xff;
-                        iv_lo <<= 8;
-                        iv_lo |= segment->aes_ivs[8+i] & 0xff;
-                    }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
-
-                } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
-                }
-                if( ret < 0 )
+                unsigned long long iv_hi = segment->aes_ivs[0];
+                unsigned long long iv_lo = segment->aes_ivs[8];
+                for( unsigned short i = 1; i < 8; i++ )
                 {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
+                    iv_hi <<= 8;
+                    iv_hi |= segment->aes_ivs[i] & 0xff;
+                    iv_lo <<= 8;
+                    iv_lo |= segment->aes_ivs[8+i] & 0xff;
                 }
-            }
+                vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                                      segment->psz_key_uri, iv_hi, iv_lo );
 
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
+            } else {
+                vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
             }
         }
-        free( psz_current_uri );
 
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
+        if( segment->psz_duration )
+            vlc_memstream_printf( &ms, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri );
+        else if( segment->p_httpd )
+            /* Segment being written: it can already be requested */
+            vlc_memstream_printf( &ms, "#EXT-X-PREFETCH:%s\n", segment->psz_uri );
+    }
 
-        }
-        fclose( fp );
+    if ( b_isend )
+        vlc_memstream_puts( &ms, STR_ENDLIST );
 
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+    if( vlc_memstream_close( &ms ) )
+        return NULL;
+    return ms.ptr;
+}
 
-        if ( val < 0 )
-        {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
-        }
-        else
-            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+/************************************************************************
+ * updateIndex: publish the index
+ ************************************************************************/
+static int updateIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                        uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    if ( !p_sys->psz_indexPath )
+        return 0;
 
+    char *psz_index = formatIndex( p_sys, i_firstseg, i_index_offset, b_isend );
+    if( unlikely( psz_index == NULL ) )
+        return -1;
+
+    if( p_sys->b_httpd )
+    {
+        vlc_mutex_lock( &p_sys->lock );
+        free( p_sys->psz_index );
+        p_sys->psz_index = psz_index;
+        vlc_mutex_unlock( &p_sys->lock );
+        return 0;
+    }
+
+    int val;
+    FILE *fp;
+    char *psz_idxTmp;
+    if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
+    {
+        free( psz_index );
+        return -1;
+    }
+
+    fp = vlc_fopen( psz_idxTmp, "wt");
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
         free( psz_idxTmp );
+        free( psz_index );
+        return -1;
+    }
+
+    val = fputs( psz_index, fp );
+    free( psz_index );
+    if ( val < 0 )
+    {
+        free( psz_idxTmp );
+        fclose( fp );
+        return -1;
     }
+    fclose( fp );
+
+    val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+
+    if ( val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        msg_Err( p_access, "Error moving LiveHttp index file" );
+    }
+    else
+        msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+
+    free( psz_idxTmp );
+    return 0;
+}
+
+/************************************************************************
+ * updateIndexAndDel: If necessary, update index file & delete old segments
+ ************************************************************************/
+static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+    unsigned i_index_offset;
+    uint32_t i_firstseg = getFirstSegment( p_sys, &i_index_offset );
+
+    // First update index
+    if ( updateIndex( p_access, p_sys, i_firstseg, i_index_offset, b_isend ) )
+        return -1;
 
     // Then take care of deletion
     // Try to follow pantos draft 11 section 6.2.2
@@ -694,7 +787,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
          msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( &p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
+         if ( segment->psz_filename && !segment->p_httpd )
          {
              vlc_unlink( segment->psz_filename );
          }
@@ -707,12 +800,36 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+static bool segmentIsOpen( sout_access_out_sys_t *p_sys )
+{
+    if( p_sys->b_httpd )
+        return p_sys->p_cursegment != NULL;
+    return p_sys->i_handle >= 0;
+}
+
+/*****************************************************************************
+ * segmentWrite: write data to the current segment
+ *****************************************************************************/
+static ssize_t segmentWrite( sout_access_out_sys_t *p_sys, const void *p_data, size_t i_data )
+{
+    if( p_sys->b_httpd )
+    {
+        if( httpd_SegmentAppend( p_sys->p_cursegment, p_data, i_data ) )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        return i_data;
+    }
+    return vlc_write( p_sys->i_handle, p_data, i_data );
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( segmentIsOpen( p_sys ) )
     {
         output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, vlc_array_count( &p_sys->segments_t ) - 1 );
 
@@ -726,7 +843,7 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
                msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
             } else {
 
-            int ret = vlc_write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
+            ssize_t ret = segmentWrite( p_sys, p_sys->stuffing_bytes, 16 );
             if( ret != 16 )
                 msg_Err( p_access, "Couldn't write 16 bytes" );
             }
@@ -734,8 +851,16 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
         }
 
 
-        vlc_close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        if( p_sys->b_httpd )
+        {
+            httpd_SegmentEnd( p_sys->p_cursegment );
+            p_sys->p_cursegment = NULL;
+        }
+        else
+        {
+            vlc_close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
 
         if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
         {
@@ -810,7 +935,8 @@ static void Close( vlc_object_t * p_this )
     {
         output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, 0 );
         vlc_array_remove( &p_sys->segments_t, 0 );
-        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename )
+        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename
+         && !segment->p_httpd )
         {
             msg_Dbg( p_access, "Removing segment number %d name %s", segment->i_segment_number, segment->psz_filename );
             vlc_unlink( segment->psz_filename );
@@ -819,6 +945,13 @@ static void Close( vlc_object_t * p_this )
         destroySegment( segment );
     }
 
+    if( p_sys->p_httpd_index )
+        httpd_FileDelete( p_sys->p_httpd_index );
+    if( p_sys->p_httpd_host )
+        httpd_HostDelete( p_sys->p_httpd_host );
+    free( p_sys->psz_index );
+    vlc_mutex_destroy( &p_sys->lock );
+
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -851,7 +984,7 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
  *****************************************************************************/
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
 {
-    int fd;
+    int fd = -1;
 
     uint32_t i_newseg = p_sys->i_segment + 1;
 
@@ -872,9 +1005,20 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
-    if ( fd == -1 )
+    if( p_sys->b_httpd )
+    {
+        segment->p_httpd = httpd_SegmentNew( p_sys->p_httpd_host,
+                                             segment->psz_filename,
+                                             "video/mp2t", NULL, NULL );
+        if( segment->p_httpd == NULL )
+        {
+            msg_Err( p_access, "cannot serve `%s'", segment->psz_filename );
+            destroySegment( segment );
+            return -1;
+        }
+    }
+    else if ( ( fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT |
+                               O_LARGEFILE | O_TRUNC, 0666 ) ) == -1 )
     {
         msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
                  vlc_strerror_c(errno) );
@@ -900,8 +1044,19 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
 
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
     p_sys->i_handle = fd;
+    p_sys->p_cursegment = segment->p_httpd;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
+
+    if( p_sys->b_httpd )
+    {
+        /* Advertise the segment right away */
+        unsigned i_index_offset;
+        uint32_t i_firstseg = getFirstSegment( p_sys, &i_index_offset );
+
+        updateIndex( p_access, p_sys, i_firstseg, i_index_offset, false );
+        return 0;
+    }
     return fd;
 }
 /*****************************************************************************
@@ -912,7 +1067,7 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t writevalue = 0;
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
+    if( segmentIsOpen( p_sys ) && p_sys->b_segment_has_data &&
        (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm ) )
     {
         writevalue = writeSegment( p_access );
@@ -925,7 +1080,7 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
         return writevalue;
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    if ( unlikely( !segmentIsOpen( p_sys ) ) )
     {
         p_sys->i_opendts = p_buffer->i_dts;
 
@@ -992,7 +1147,7 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
 
         }
 
-        ssize_t val = vlc_write( p_sys->i_handle, output->p_buffer, output->i_buffer );
+        ssize_t val = segmentWrite( p_sys, output->p_buffer, output->i_buffer );
         if ( val == -1 )
         {
            if ( errno == EINTR )
@@ -1050,6 +1205,20 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         }
         i_write += ret;
 
+        /* In memory, complete GOPs are made available to the clients
+         * without waiting for the end of the segment */
+        if( p_sys->b_httpd && p_sys->full_segments && segmentIsOpen( p_sys ) )
+        {
+            ret = writeSegment( p_access );
+            if( ret < 0 )
+            {
+                msg_Err( p_access, "Error in write loop");
+                block_ChainRelease( p_buffer );
+                return ret;
+            }
+            i_write += ret;
+        }
+
         block_t *p_temp = p_buffer->p_next;
         p_buffer->p_next = NULL;
         block_ChainLastAppend( &p_sys->ongoing_segment_end, p_buffer );
@@ -1068,3 +1237,27 @@ static int Seek( sout_access_out_t *p_access, off_t i_pos )
     msg_Err( p_access, "livehttp sout access cannot seek" );
     return -1;
 }
+
+/*****************************************************************************
+ * IndexCallback: serve the index from memory
+ *****************************************************************************/
+static int IndexCallback( httpd_file_sys_t *p_args, httpd_file_t *f,
+                          uint8_t *p_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(f); VLC_UNUSED(p_request);
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)p_args;
+
+    *pp_data = NULL;
+    *pi_data = 0;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->psz_index )
+    {
+        *pp_data = (uint8_t *)strdup( p_sys->psz_index );
+        if( *pp_data )
+            *pi_data = strlen( p_sys->psz_index );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
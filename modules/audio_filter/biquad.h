@@ -0,0 +1,643 @@
+/*****************************************************************************
+ * biquad.h: vectorized IIR filters for the equalizers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_BIQUAD_H_
+#define VLC_AUDIO_BIQUAD_H_
+
+#include <math.h>
+#include <vlc_cpu.h>
+
+/* Two kinds of second order IIR filters are provided:
+ *  - banks of band-pass filters fed with the same input, whose outputs are
+ *    mixed (graphic equalizer), vectorized across the bands;
+ *  - cascades of biquads in direct form 1 (parametric equalizer),
+ *    vectorized across the channels.
+ * The C versions are the reference: the vector versions only differ by the
+ * order of the floating point additions. */
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# define BIQUAD_SSE
+# include <xmmintrin.h>
+# if VLC_GCC_VERSION(4, 9) || defined(__clang__)
+/* Newer compilers expose every intrinsic regardless of -m flags */
+#  define BIQUAD_AVX
+#  include <immintrin.h>
+# endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define BIQUAD_NEON
+# include <arm_neon.h>
+#endif
+
+/** Maximum number of bands in a bank (a multiple of the vector sizes) */
+#define BIQUAD_BANDS_MAX 16
+/** Maximum number of biquads in a cascade */
+#define BIQUAD_STAGES_MAX 8
+
+/**
+ * Band-pass filters bank:
+ * y[n] = alpha * (x[n] - x[n-2]) + gamma * y[n-1] - beta * y[n-2]
+ * out[n] = gain * (in * x[n] + sum(amp * y[n]))
+ *
+ * Unused bands must have null coefficients.
+ */
+typedef struct
+{
+    float alpha[BIQUAD_BANDS_MAX];
+    float beta[BIQUAD_BANDS_MAX];
+    float gamma[BIQUAD_BANDS_MAX];
+    float amp[BIQUAD_BANDS_MAX];
+    unsigned bands;
+} biquad_bank_t;
+
+/** Per channel state of a bank */
+typedef struct
+{
+    float y1[BIQUAD_BANDS_MAX]; /**< y[n-1] */
+    float y2[BIQUAD_BANDS_MAX]; /**< y[n-2] */
+    float x1; /**< x[n-1] */
+    float x2; /**< x[n-2] */
+} biquad_bank_state_t;
+
+typedef void (*biquad_bank_fn)(const biquad_bank_t *, biquad_bank_state_t *,
+                               float *dst, const float *src, unsigned stride,
+                               unsigned count, float in, float gain);
+
+/**
+ * Biquad cascade, coefficients are b0, b1, b2, a1 and a2 for each stage.
+ *
+ * The state is transposed so that the channels are contiguous:
+ * state[(4 * stage + k) * channels + channel] with k being respectively
+ * x[n-1], x[n-2], y[n-1] and y[n-2].
+ */
+typedef void (*biquad_cascade_fn)(const float *coeffs, unsigned stages,
+                                  float *state, float *dst, const float *src,
+                                  unsigned channels, unsigned count);
+
+/*****************************************************************************
+ * Denormal numbers
+ *****************************************************************************/
+/* IIR states decay into denormal numbers once the sound stops, and those are
+ * dreadfully slow to compute with on most CPUs. The FPU is told to flush them
+ * to zero while filtering where possible, and the states are cleaned up after
+ * each buffer anyway. */
+
+static inline float biquad_undenormalise(float f)
+{
+    return (fpclassify(f) == FP_SUBNORMAL) ? 0.f : f;
+}
+
+#if defined(BIQUAD_SSE)
+__attribute__ ((__target__ ("sse")))
+static inline unsigned biquad_DenormalsOff(void)
+{
+    if (!vlc_CPU_SSE())
+        return 0;
+
+    unsigned csr = _mm_getcsr();
+    /* Flush-to-zero, and denormals-are-zero which the first SSE CPUs
+     * do not support (setting it faults) */
+    _mm_setcsr(csr | (vlc_CPU_SSE2() ? 0x8040 : 0x8000));
+    return csr;
+}
+
+__attribute__ ((__target__ ("sse")))
+static inline void biquad_DenormalsRestore(unsigned csr)
+{
+    if (vlc_CPU_SSE())
+        _mm_setcsr(csr);
+}
+#elif defined(__aarch64__)
+static inline unsigned biquad_DenormalsOff(void)
+{
+    uint64_t fpcr;
+
+    __asm__ volatile ("mrs %0, fpcr" : "=r" (fpcr));
+    __asm__ volatile ("msr fpcr, %0" : : "r" (fpcr | (UINT64_C(1) << 24)));
+    return fpcr;
+}
+
+static inline void biquad_DenormalsRestore(unsigned fpcr)
+{
+    __asm__ volatile ("msr fpcr, %0" : : "r" ((uint64_t)fpcr));
+}
+#else
+/* 32-bits ARM NEON always flushes denormals */
+static inline unsigned biquad_DenormalsOff(void)
+{
+    return 0;
+}
+
+static inline void biquad_DenormalsRestore(unsigned csr)
+{
+    (void) csr;
+}
+#endif
+
+static inline void biquad_bank_Flush(biquad_bank_state_t *st)
+{
+    for (unsigned i = 0; i < BIQUAD_BANDS_MAX; i++)
+    {
+        st->y1[i] = biquad_undenormalise(st->y1[i]);
+        st->y2[i] = biquad_undenormalise(st->y2[i]);
+    }
+    st->x1 = biquad_undenormalise(st->x1);
+    st->x2 = biquad_undenormalise(st->x2);
+}
+
+static inline void biquad_cascade_Flush(float *state, unsigned stages,
+                                        unsigned channels)
+{
+    for (unsigned i = 0; i < 4 * stages * channels; i++)
+        state[i] = biquad_undenormalise(state[i]);
+}
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static inline void biquad_bank_C(const biquad_bank_t *bank,
+                                 biquad_bank_state_t *st, float *dst,
+                                 const float *src, unsigned stride,
+                                 unsigned count, float in, float gain)
+{
+    float x1 = st->x1, x2 = st->x2;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const float x = src[i * stride];
+        float o = 0.f;
+
+        for (unsigned j = 0; j < bank->bands; j++)
+        {
+            float y = bank->alpha[j] * (x - x2) + bank->gamma[j] * st->y1[j]
+                    - bank->beta[j] * st->y2[j];
+
+            st->y2[j] = st->y1[j];
+            st->y1[j] = y;
+            o += y * bank->amp[j];
+        }
+        x2 = x1;
+        x1 = x;
+        dst[i * stride] = gain * (in * x + o);
+    }
+    st->x1 = x1;
+    st->x2 = x2;
+}
+
+static inline float biquad_stage_C(const float *c, float *s0, float *s1,
+                                   float *s2, float *s3, float x)
+{
+    float y = x * c[0] + *s0 * c[1] + *s1 * c[2] - *s2 * c[3] - *s3 * c[4];
+
+    *s1 = *s0;
+    *s0 = x;
+    *s3 = *s2;
+    *s2 = y;
+    return y;
+}
+
+/* Filters the channels [first, channels[ */
+static inline void biquad_cascade_channels_C(const float *coeffs,
+                                             unsigned stages, float *state,
+                                             float *dst, const float *src,
+                                             unsigned channels, unsigned count,
+                                             unsigned first)
+{
+    for (unsigned i = 0; i < count; i++)
+        for (unsigned ch = first; ch < channels; ch++)
+        {
+            float x = src[i * channels + ch];
+
+            for (unsigned s = 0; s < stages; s++)
+            {
+                float *st = &state[4 * s * channels + ch];
+
+                x = biquad_stage_C(&coeffs[5 * s], &st[0], &st[channels],
+                                   &st[2 * channels], &st[3 * channels], x);
+            }
+            dst[i * channels + ch] = x;
+        }
+}
+
+static inline void biquad_cascade_C(const float *coeffs, unsigned stages,
+                                    float *state, float *dst, const float *src,
+                                    unsigned channels, unsigned count)
+{
+    biquad_cascade_channels_C(coeffs, stages, state, dst, src, channels,
+                              count, 0);
+}
+
+#ifdef BIQUAD_SSE
+/*****************************************************************************
+ * SSE
+ *****************************************************************************/
+__attribute__ ((__target__ ("sse")))
+static inline float biquad_hsum_SSE(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__ ((__target__ ("sse")))
+static inline void biquad_bank_SSE(const biquad_bank_t *bank,
+                                   biquad_bank_state_t *st, float *dst,
+                                   const float *src, unsigned stride,
+                                   unsigned count, float in, float gain)
+{
+    if (bank->bands > 12)
+    {
+        biquad_bank_C(bank, st, dst, src, stride, count, in, gain);
+        return;
+    }
+
+    /* Up to 12 bands, kept in registers */
+    __m128 y1[3], y2[3], a[3], b[3], g[3], amp[3];
+    float x1 = st->x1, x2 = st->x2;
+
+    for (unsigned k = 0; k < 3; k++)
+    {
+        y1[k] = _mm_loadu_ps(&st->y1[4 * k]);
+        y2[k] = _mm_loadu_ps(&st->y2[4 * k]);
+        a[k] = _mm_loadu_ps(&bank->alpha[4 * k]);
+        b[k] = _mm_loadu_ps(&bank->beta[4 * k]);
+        g[k] = _mm_loadu_ps(&bank->gamma[4 * k]);
+        amp[k] = _mm_loadu_ps(&bank->amp[4 * k]);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const float x = src[i * stride];
+        const __m128 d = _mm_set1_ps(x - x2);
+        __m128 o = _mm_setzero_ps();
+
+        for (unsigned k = 0; k < 3; k++)
+        {
+            __m128 y = _mm_add_ps(_mm_mul_ps(a[k], d),
+                                  _mm_mul_ps(g[k], y1[k]));
+            y = _mm_sub_ps(y, _mm_mul_ps(b[k], y2[k]));
+            y2[k] = y1[k];
+            y1[k] = y;
+            o = _mm_add_ps(o, _mm_mul_ps(y, amp[k]));
+        }
+        x2 = x1;
+        x1 = x;
+        dst[i * stride] = gain * (in * x + biquad_hsum_SSE(o));
+    }
+
+    for (unsigned k = 0; k < 3; k++)
+    {
+        _mm_storeu_ps(&st->y1[4 * k], y1[k]);
+        _mm_storeu_ps(&st->y2[4 * k], y2[k]);
+    }
+    st->x1 = x1;
+    st->x2 = x2;
+}
+
+__attribute__ ((__target__ ("sse")))
+static inline __m128 biquad_load_SSE(const float *p, bool half)
+{
+    return half ? _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)p)
+                : _mm_loadu_ps(p);
+}
+
+__attribute__ ((__target__ ("sse")))
+static inline void biquad_store_SSE(float *p, __m128 v, bool half)
+{
+    if (half)
+        _mm_storel_pi((__m64 *)p, v);
+    else
+        _mm_storeu_ps(p, v);
+}
+
+/* Filters 4 (or 2 if half) channels starting with ch */
+__attribute__ ((__target__ ("sse")))
+static inline void biquad_cascade_group_SSE(const float *coeffs,
+                                            unsigned stages, float *state,
+                                            float *dst, const float *src,
+                                            unsigned channels, unsigned count,
+                                            unsigned ch, bool half)
+{
+    __m128 s[BIQUAD_STAGES_MAX][4];
+
+    for (unsigned i = 0; i < stages; i++)
+        for (unsigned k = 0; k < 4; k++)
+            s[i][k] = biquad_load_SSE(&state[(4 * i + k) * channels + ch],
+                                      half);
+
+    for (unsigned n = 0; n < count; n++)
+    {
+        __m128 x = biquad_load_SSE(&src[n * channels + ch], half);
+
+        for (unsigned i = 0; i < stages; i++)
+        {
+            const float *c = &coeffs[5 * i];
+            __m128 y = _mm_mul_ps(x, _mm_set1_ps(c[0]));
+
+            y = _mm_add_ps(y, _mm_mul_ps(s[i][0], _mm_set1_ps(c[1])));
+            y = _mm_add_ps(y, _mm_mul_ps(s[i][1], _mm_set1_ps(c[2])));
+            y = _mm_sub_ps(y, _mm_mul_ps(s[i][2], _mm_set1_ps(c[3])));
+            y = _mm_sub_ps(y, _mm_mul_ps(s[i][3], _mm_set1_ps(c[4])));
+            s[i][1] = s[i][0];
+            s[i][0] = x;
+            s[i][3] = s[i][2];
+            s[i][2] = y;
+            x = y;
+        }
+        biquad_store_SSE(&dst[n * channels + ch], x, half);
+    }
+
+    for (unsigned i = 0; i < stages; i++)
+        for (unsigned k = 0; k < 4; k++)
+            biquad_store_SSE(&state[(4 * i + k) * channels + ch], s[i][k],
+                             half);
+}
+
+__attribute__ ((__target__ ("sse")))
+static inline void biquad_cascade_SSE(const float *coeffs, unsigned stages,
+                                      float *state, float *dst,
+                                      const float *src, unsigned channels,
+                                      unsigned count)
+{
+    unsigned ch = 0;
+
+    if (stages > BIQUAD_STAGES_MAX)
+    {
+        biquad_cascade_C(coeffs, stages, state, dst, src, channels, count);
+        return;
+    }
+
+    for (; ch + 4 <= channels; ch += 4)
+        biquad_cascade_group_SSE(coeffs, stages, state, dst, src, channels,
+                                 count, ch, false);
+    if (ch + 2 <= channels)
+    {
+        biquad_cascade_group_SSE(coeffs, stages, state, dst, src, channels,
+                                 count, ch, true);
+        ch += 2;
+    }
+    if (ch < channels)
+        biquad_cascade_channels_C(coeffs, stages, state, dst, src, channels,
+                                  count, ch);
+}
+#endif
+
+#ifdef BIQUAD_AVX
+/*****************************************************************************
+ * AVX
+ *****************************************************************************/
+__attribute__ ((__target__ ("avx")))
+static inline void biquad_bank_AVX(const biquad_bank_t *bank,
+                                   biquad_bank_state_t *st, float *dst,
+                                   const float *src, unsigned stride,
+                                   unsigned count, float in, float gain)
+{
+    __m256 y1[2], y2[2], a[2], b[2], g[2], amp[2];
+    float x1 = st->x1, x2 = st->x2;
+
+    for (unsigned k = 0; k < 2; k++)
+    {
+        y1[k] = _mm256_loadu_ps(&st->y1[8 * k]);
+        y2[k] = _mm256_loadu_ps(&st->y2[8 * k]);
+        a[k] = _mm256_loadu_ps(&bank->alpha[8 * k]);
+        b[k] = _mm256_loadu_ps(&bank->beta[8 * k]);
+        g[k] = _mm256_loadu_ps(&bank->gamma[8 * k]);
+        amp[k] = _mm256_loadu_ps(&bank->amp[8 * k]);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const float x = src[i * stride];
+        const __m256 d = _mm256_set1_ps(x - x2);
+        __m256 o = _mm256_setzero_ps();
+
+        for (unsigned k = 0; k < 2; k++)
+        {
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(a[k], d),
+                                     _mm256_mul_ps(g[k], y1[k]));
+            y = _mm256_sub_ps(y, _mm256_mul_ps(b[k], y2[k]));
+            y2[k] = y1[k];
+            y1[k] = y;
+            o = _mm256_add_ps(o, _mm256_mul_ps(y, amp[k]));
+        }
+
+        __m128 o4 = _mm_add_ps(_mm256_castps256_ps128(o),
+                               _mm256_extractf128_ps(o, 1));
+        o4 = _mm_add_ps(o4, _mm_movehl_ps(o4, o4));
+        o4 = _mm_add_ss(o4, _mm_shuffle_ps(o4, o4, 1));
+
+        x2 = x1;
+        x1 = x;
+        dst[i * stride] = gain * (in * x + _mm_cvtss_f32(o4));
+    }
+
+    for (unsigned k = 0; k < 2; k++)
+    {
+        _mm256_storeu_ps(&st->y1[8 * k], y1[k]);
+        _mm256_storeu_ps(&st->y2[8 * k], y2[k]);
+    }
+    st->x1 = x1;
+    st->x2 = x2;
+}
+#endif
+
+#ifdef BIQUAD_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static inline float biquad_hsum_NEON(float32x4_t v)
+{
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+static inline void biquad_bank_NEON(const biquad_bank_t *bank,
+                                    biquad_bank_state_t *st, float *dst,
+                                    const float *src, unsigned stride,
+                                    unsigned count, float in, float gain)
+{
+    if (bank->bands > 12)
+    {
+        biquad_bank_C(bank, st, dst, src, stride, count, in, gain);
+        return;
+    }
+
+    float32x4_t y1[3], y2[3], a[3], b[3], g[3], amp[3];
+    float x1 = st->x1, x2 = st->x2;
+
+    for (unsigned k = 0; k < 3; k++)
+    {
+        y1[k] = vld1q_f32(&st->y1[4 * k]);
+        y2[k] = vld1q_f32(&st->y2[4 * k]);
+        a[k] = vld1q_f32(&bank->alpha[4 * k]);
+        b[k] = vld1q_f32(&bank->beta[4 * k]);
+        g[k] = vld1q_f32(&bank->gamma[4 * k]);
+        amp[k] = vld1q_f32(&bank->amp[4 * k]);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const float x = src[i * stride];
+        const float32x4_t d = vdupq_n_f32(x - x2);
+        float32x4_t o = vdupq_n_f32(0.f);
+
+        for (unsigned k = 0; k < 3; k++)
+        {
+            float32x4_t y = vmulq_f32(a[k], d);
+
+            y = vmlaq_f32(y, g[k], y1[k]);
+            y = vmlsq_f32(y, b[k], y2[k]);
+            y2[k] = y1[k];
+            y1[k] = y;
+            o = vmlaq_f32(o, y, amp[k]);
+        }
+        x2 = x1;
+        x1 = x;
+        dst[i * stride] = gain * (in * x + biquad_hsum_NEON(o));
+    }
+
+    for (unsigned k = 0; k < 3; k++)
+    {
+        vst1q_f32(&st->y1[4 * k], y1[k]);
+        vst1q_f32(&st->y2[4 * k], y2[k]);
+    }
+    st->x1 = x1;
+    st->x2 = x2;
+}
+
+static inline float32x4_t biquad_load_NEON(const float *p, bool half)
+{
+    return half ? vcombine_f32(vld1_f32(p), vdup_n_f32(0.f)) : vld1q_f32(p);
+}
+
+static inline void biquad_store_NEON(float *p, float32x4_t v, bool half)
+{
+    if (half)
+        vst1_f32(p, vget_low_f32(v));
+    else
+        vst1q_f32(p, v);
+}
+
+static inline void biquad_cascade_group_NEON(const float *coeffs,
+                                             unsigned stages, float *state,
+                                             float *dst, const float *src,
+                                             unsigned channels, unsigned count,
+                                             unsigned ch, bool half)
+{
+    float32x4_t s[BIQUAD_STAGES_MAX][4];
+
+    for (unsigned i = 0; i < stages; i++)
+        for (unsigned k = 0; k < 4; k++)
+            s[i][k] = biquad_load_NEON(&state[(4 * i + k) * channels + ch],
+                                       half);
+
+    for (unsigned n = 0; n < count; n++)
+    {
+        float32x4_t x = biquad_load_NEON(&src[n * channels + ch], half);
+
+        for (unsigned i = 0; i < stages; i++)
+        {
+            const float *c = &coeffs[5 * i];
+            float32x4_t y = vmulq_n_f32(x, c[0]);
+
+            y = vmlaq_n_f32(y, s[i][0], c[1]);
+            y = vmlaq_n_f32(y, s[i][1], c[2]);
+            y = vmlsq_n_f32(y, s[i][2], c[3]);
+            y = vmlsq_n_f32(y, s[i][3], c[4]);
+            s[i][1] = s[i][0];
+            s[i][0] = x;
+            s[i][3] = s[i][2];
+            s[i][2] = y;
+            x = y;
+        }
+        biquad_store_NEON(&dst[n * channels + ch], x, half);
+    }
+
+    for (unsigned i = 0; i < stages; i++)
+        for (unsigned k = 0; k < 4; k++)
+            biquad_store_NEON(&state[(4 * i + k) * channels + ch], s[i][k],
+                              half);
+}
+
+static inline void biquad_cascade_NEON(const float *coeffs, unsigned stages,
+                                       float *state, float *dst,
+                                       const float *src, unsigned channels,
+                                       unsigned count)
+{
+    unsigned ch = 0;
+
+    if (stages > BIQUAD_STAGES_MAX)
+    {
+        biquad_cascade_C(coeffs, stages, state, dst, src, channels, count);
+        return;
+    }
+
+    for (; ch + 4 <= channels; ch += 4)
+        biquad_cascade_group_NEON(coeffs, stages, state, dst, src, channels,
+                                  count, ch, false);
+    if (ch + 2 <= channels)
+    {
+        biquad_cascade_group_NEON(coeffs, stages, state, dst, src, channels,
+                                  count, ch, true);
+        ch += 2;
+    }
+    if (ch < channels)
+        biquad_cascade_channels_C(coeffs, stages, state, dst, src, channels,
+                                  count, ch);
+}
+#endif
+
+/**
+ * Selects the best bank filter for the running CPU.
+ */
+static inline biquad_bank_fn biquad_bank_Get(void)
+{
+#ifdef BIQUAD_AVX
+    if (vlc_CPU_AVX())
+        return biquad_bank_AVX;
+#endif
+#ifdef BIQUAD_SSE
+    if (vlc_CPU_SSE())
+        return biquad_bank_SSE;
+#endif
+#ifdef BIQUAD_NEON
+    /* Only built when the compiler targets NEON in the first place */
+    return biquad_bank_NEON;
+#endif
+    return biquad_bank_C;
+}
+
+/**
+ * Selects the best biquad cascade for the running CPU.
+ */
+static inline biquad_cascade_fn biquad_cascade_Get(void)
+{
+#ifdef BIQUAD_SSE
+    if (vlc_CPU_SSE())
+        return biquad_cascade_SSE;
+#endif
+#ifdef BIQUAD_NEON
+    return biquad_cascade_NEON;
+#endif
+    return biquad_cascade_C;
+}
+
+#endif
@@ -0,0 +1,333 @@
+/*****************************************************************************
+ * mix_matrix.h: vectorized channel mixing matrices
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MIX_MATRIX_H_
+#define VLC_MIX_MATRIX_H_ 1
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <vlc_cpu.h>
+
+/* Each output frame is the product of the mixing matrix by the input frame:
+ *   out[o] = sum(coeff[o][i] * in[i])
+ *
+ * The C version is the reference and handles any matrix. The vector kernels
+ * are specialized for the downmixes of common layouts: each one handles the
+ * matrices whose non-null coefficients fit its pattern, whatever their
+ * values, with the input channels of a frame (or of two frames) loaded and
+ * shuffled in place rather than gathered one by one. They only differ from
+ * the C version by the order of the floating point additions. */
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# define MIX_SSE
+# include <xmmintrin.h>
+#endif
+
+/** Maximum number of input or output channels */
+#define MIX_CHANNELS_MAX 9
+
+typedef struct
+{
+    unsigned in;
+    unsigned out;
+    /** Coefficients of each input, repeated when the output width divides
+     * a vector */
+    float cols[MIX_CHANNELS_MAX][8];
+    /** Non-null coefficients of each output, by increasing input */
+    struct
+    {
+        unsigned count;
+        uint8_t in[MIX_CHANNELS_MAX];
+        float coeff[MIX_CHANNELS_MAX];
+    } terms[MIX_CHANNELS_MAX];
+} mix_matrix_t;
+
+typedef void (*mix_fn)(const mix_matrix_t *, float *restrict dst,
+                       const float *restrict src, unsigned frames);
+
+/**
+ * Initializes a null matrix.
+ */
+static inline void mix_matrix_Init(mix_matrix_t *m, unsigned in, unsigned out)
+{
+    memset(m, 0, sizeof (*m));
+    m->in = in;
+    m->out = out;
+}
+
+/**
+ * Sets the coefficient of an input channel in an output channel.
+ */
+static inline void mix_matrix_Set(mix_matrix_t *m, unsigned out, unsigned in,
+                                  float coeff)
+{
+    /* Repeated when the output width divides a vector */
+    const unsigned step = (8 % m->out) ? 8 : m->out;
+
+    /* Only 8 lanes are kept per column */
+    assert(out < m->out && m->out <= 8);
+    assert(in < m->in);
+
+    for (unsigned lane = out; lane < 8; lane += step)
+        m->cols[in][lane] = coeff;
+
+    /* Rebuild the terms of that output */
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < m->in; i++)
+        if (m->cols[i][out] != 0.f)
+        {
+            m->terms[out].in[count] = i;
+            m->terms[out].coeff[count] = m->cols[i][out];
+            count++;
+        }
+    m->terms[out].count = count;
+}
+
+/* Null coefficients are skipped: most mixes are sparse */
+static inline void mix_C(const mix_matrix_t *m, float *restrict dst,
+                         const float *restrict src, unsigned frames)
+{
+    for (unsigned f = 0; f < frames; f++)
+    {
+        for (unsigned o = 0; o < m->out; o++)
+        {
+            float sum = 0.f;
+
+            for (unsigned t = 0; t < m->terms[o].count; t++)
+                sum += m->terms[o].coeff[t] * src[m->terms[o].in[t]];
+            dst[o] = sum;
+        }
+        src += m->in;
+        dst += m->out;
+    }
+}
+
+/**
+ * Checks that the non-null coefficients of a matrix fit a pattern.
+ *
+ * \param masks bit mask of the inputs allowed in each output
+ */
+static inline bool mix_matrix_Fits(const mix_matrix_t *m,
+                                   const uint16_t *masks)
+{
+    for (unsigned o = 0; o < m->out; o++)
+        for (unsigned t = 0; t < m->terms[o].count; t++)
+            if (!(masks[o] & (1 << m->terms[o].in[t])))
+                return false;
+    return true;
+}
+
+#ifdef MIX_SSE
+/* Loads two channels of two frames: a0 a1 b0 b1 */
+__attribute__ ((__target__ ("sse")))
+static inline __m128 mix_load_pairs_SSE(const float *a, const float *b)
+{
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)a),
+                        (const __m64 *)b);
+}
+
+/* Surround (5.x or 7.x) to stereo: the left and right channels of each pair
+ * only go to the left and right outputs, the center goes to both.
+ * Two frames per vector. */
+__attribute__ ((__target__ ("sse"), __always_inline__))
+static inline void mix_to_2_0_SSE_n(const mix_matrix_t *m, float *restrict dst,
+                                    const float *restrict src,
+                                    unsigned frames, const unsigned in)
+{
+    const unsigned pairs = (in >= 7) ? 3 : 2, center = 2 * pairs;
+    __m128 coeffs[3];
+    unsigned f = 0;
+
+    for (unsigned k = 0; k < pairs; k++)
+        coeffs[k] = _mm_setr_ps(m->cols[2 * k][0], m->cols[2 * k + 1][1],
+                                m->cols[2 * k][0], m->cols[2 * k + 1][1]);
+    const __m128 coeff_c = _mm_loadu_ps(m->cols[center]);
+
+    for (; f + 2 <= frames; f += 2)
+    {
+        __m128 acc = _mm_mul_ps(_mm_shuffle_ps(_mm_load_ss(src + center),
+                                               _mm_load_ss(src + in + center),
+                                               _MM_SHUFFLE(0, 0, 0, 0)),
+                                coeff_c);
+
+        for (unsigned k = 0; k < pairs; k++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(
+                             mix_load_pairs_SSE(src + 2 * k, src + in + 2 * k),
+                             coeffs[k]));
+        _mm_storeu_ps(dst, acc);
+        src += 2 * in;
+        dst += 4;
+    }
+    mix_C(m, dst, src, frames - f);
+}
+
+__attribute__ ((__target__ ("sse")))
+static void mix_to_2_0_SSE(const mix_matrix_t *m, float *restrict dst,
+                           const float *restrict src, unsigned frames)
+{
+    switch (m->in)
+    {
+        case 5: mix_to_2_0_SSE_n(m, dst, src, frames, 5); break;
+        case 6: mix_to_2_0_SSE_n(m, dst, src, frames, 6); break;
+        case 7: mix_to_2_0_SSE_n(m, dst, src, frames, 7); break;
+        case 8: mix_to_2_0_SSE_n(m, dst, src, frames, 8); break;
+        default: vlc_assert_unreachable();
+    }
+}
+
+/* 7.x to 4.0: the front outputs take the front, middle and center channels,
+ * the rear outputs the middle and rear channels. One frame per vector. */
+__attribute__ ((__target__ ("sse")))
+static void mix_7_x_to_4_0_SSE(const mix_matrix_t *m, float *restrict dst,
+                               const float *restrict src, unsigned frames)
+{
+    const unsigned in = m->in;
+    const __m128 coeff_f = _mm_setr_ps(m->cols[0][0], m->cols[1][1],
+                                       m->cols[4][2], m->cols[5][3]);
+    const __m128 coeff_m = _mm_setr_ps(m->cols[2][0], m->cols[3][1],
+                                       m->cols[2][2], m->cols[3][3]);
+    const __m128 coeff_c = _mm_loadu_ps(m->cols[6]);
+    /* Without LFE, the last frame cannot be loaded as two vectors */
+    const unsigned vframes = (in == 8 || frames == 0) ? frames : frames - 1;
+
+    for (unsigned f = 0; f < vframes; f++)
+    {
+        __m128 lo = _mm_loadu_ps(src), hi = _mm_loadu_ps(src + 4);
+        __m128 acc = _mm_mul_ps(_mm_movelh_ps(lo, hi), coeff_f);
+
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_movehl_ps(lo, lo), coeff_m));
+        acc = _mm_add_ps(acc, _mm_mul_ps(
+                         _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 2, 2, 2)),
+                         coeff_c));
+        _mm_storeu_ps(dst, acc);
+        src += in;
+        dst += 4;
+    }
+    mix_C(m, dst, src, frames - vframes);
+}
+
+/* 7.x to 5.x: the middle and rear channels are mixed, the others are
+ * copied. One frame per vector. */
+__attribute__ ((__target__ ("sse"), __always_inline__))
+static inline void mix_7_x_to_5_0_SSE_n(const mix_matrix_t *m,
+                                        float *restrict dst,
+                                        const float *restrict src,
+                                        unsigned frames, const unsigned in)
+{
+    const __m128 coeff_lo = _mm_setr_ps(m->cols[0][0], m->cols[1][1],
+                                        m->cols[2][2], m->cols[3][3]);
+    const __m128 coeff_r = _mm_setr_ps(0.f, 0.f, m->cols[4][2], m->cols[5][3]);
+    const __m128 coeff_c = _mm_set_ss(m->cols[6][4]);
+    /* Without LFE, the last frame cannot be loaded as two vectors */
+    const unsigned vframes = (in == 8 || frames == 0) ? frames : frames - 1;
+
+    for (unsigned f = 0; f < vframes; f++)
+    {
+        __m128 lo = _mm_loadu_ps(src), hi = _mm_loadu_ps(src + 4);
+
+        lo = _mm_add_ps(_mm_mul_ps(lo, coeff_lo),
+                        _mm_mul_ps(_mm_movelh_ps(hi, hi), coeff_r));
+        _mm_storeu_ps(dst, lo);
+        _mm_store_ss(dst + 4, _mm_mul_ss(_mm_movehl_ps(hi, hi), coeff_c));
+        src += in;
+        dst += 5;
+    }
+    mix_C(m, dst, src, frames - vframes);
+}
+
+/* 7.1 to 5.1: two frames make three whole output vectors */
+__attribute__ ((__target__ ("sse")))
+static void mix_7_1_to_5_1_SSE(const mix_matrix_t *m, float *restrict dst,
+                               const float *restrict src, unsigned frames)
+{
+    const __m128 coeff_lo = _mm_setr_ps(m->cols[0][0], m->cols[1][1],
+                                        m->cols[2][2], m->cols[3][3]);
+    const __m128 coeff_r = _mm_setr_ps(0.f, 0.f, m->cols[4][2], m->cols[5][3]);
+    const __m128 coeff_hi = _mm_setr_ps(0.f, 0.f,
+                                        m->cols[6][4], m->cols[7][5]);
+    unsigned f = 0;
+
+    for (; f + 2 <= frames; f += 2)
+    {
+        __m128 a_hi = _mm_loadu_ps(src + 4), b_hi = _mm_loadu_ps(src + 12);
+        __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src), coeff_lo),
+                              _mm_mul_ps(_mm_movelh_ps(a_hi, a_hi), coeff_r));
+        __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + 8), coeff_lo),
+                              _mm_mul_ps(_mm_movelh_ps(b_hi, b_hi), coeff_r));
+
+        a_hi = _mm_mul_ps(a_hi, coeff_hi);
+        b_hi = _mm_mul_ps(b_hi, coeff_hi);
+        _mm_storeu_ps(dst, a);
+        _mm_storeu_ps(dst + 4, _mm_shuffle_ps(a_hi, b, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_ps(dst + 8, _mm_shuffle_ps(b, b_hi, _MM_SHUFFLE(3, 2, 3, 2)));
+        src += 16;
+        dst += 12;
+    }
+    mix_C(m, dst, src, frames - f);
+}
+
+__attribute__ ((__target__ ("sse")))
+static void mix_7_x_to_5_0_SSE(const mix_matrix_t *m, float *restrict dst,
+                               const float *restrict src, unsigned frames)
+{
+    if (m->in == 8)
+        mix_7_x_to_5_0_SSE_n(m, dst, src, frames, 8);
+    else
+        mix_7_x_to_5_0_SSE_n(m, dst, src, frames, 7);
+}
+#endif
+
+/**
+ * Selects the best mixing function for a matrix and the running CPU.
+ */
+static inline mix_fn mix_Get(const mix_matrix_t *m)
+{
+#ifdef MIX_SSE
+    if (vlc_CPU_SSE())
+    {
+        static const uint16_t to_2_0_5_x[] = { 0x15, 0x1A };
+        static const uint16_t to_2_0_7_x[] = { 0x55, 0x6A };
+        static const uint16_t to_4_0_7_x[] = { 0x45, 0x4A, 0x54, 0x68 };
+        static const uint16_t to_5_x_7_x[] = {
+            0x01, 0x02, 0x14, 0x28, 0x40, 0x80
+        };
+
+        if (m->out == 2 && (m->in == 5 || m->in == 6)
+         && mix_matrix_Fits(m, to_2_0_5_x))
+            return mix_to_2_0_SSE;
+        if (m->out == 2 && (m->in == 7 || m->in == 8)
+         && mix_matrix_Fits(m, to_2_0_7_x))
+            return mix_to_2_0_SSE;
+        if (m->out == 4 && (m->in == 7 || m->in == 8)
+         && mix_matrix_Fits(m, to_4_0_7_x))
+            return mix_7_x_to_4_0_SSE;
+        if (m->out == 5 && (m->in == 7 || m->in == 8)
+         && mix_matrix_Fits(m, to_5_x_7_x))
+            return mix_7_x_to_5_0_SSE;
+        if (m->out == 6 && m->in == 8 && mix_matrix_Fits(m, to_5_x_7_x))
+            return mix_7_1_to_5_1_SSE;
+    }
+#endif
+    return mix_C;
+}
+
+#endif
@@ -34,21 +34,32 @@
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
+#include "mix_matrix.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  OpenFilter( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
 
 vlc_module_begin ()
     set_description( N_("Audio filter for simple channel mixing") )
     set_category( CAT_AUDIO )
     set_subcategory( SUBCAT_AUDIO_MISC )
     set_capability( "audio converter", 10 )
-    set_callbacks( OpenFilter, NULL );
+    set_callbacks( OpenFilter, CloseFilter );
 vlc_module_end ()
 
 static block_t *Filter( filter_t *, block_t * );
 
+struct filter_sys_t
+{
+    void (*do_work)(filter_t *, block_t *, block_t *);
+    /* Vector version of the mix, if any */
+    mix_matrix_t matrix;
+    mix_fn pf_mix;
+};
+
 static void DoWork_7_x_to_2_0( filter_t * p_filter,  block_t * p_in_buf, block_t * p_out_buf ) {
     float *p_dest = (float *)p_out_buf->p_buffer;
     const float *p_src = (const float *)p_in_buf->p_buffer;
@@ -258,6 +269,85 @@ static void DoWork_6_1_to_5_x( filter_t * p_filter,  block_t * p_in_buf, block_t
     }
 }
 
+/* Same mixes as above, as matrices for the vector kernels. The LFE channels
+ * are not listed: they are always last, and copied if both sides have one. */
+static const struct
+{
+    void (*do_work)(filter_t *, block_t *, block_t *);
+    unsigned i_in, i_out;
+    struct
+    {
+        uint8_t out, in;
+        float coeff;
+    } terms[10];
+} matrices[] = {
+    { DoWork_7_x_to_2_0, 7, 2, {
+        { 0, 0, 1.f }, { 0, 2, .25f }, { 0, 4, .25f }, { 0, 6, .7071f },
+        { 1, 1, 1.f }, { 1, 3, .25f }, { 1, 5, .25f }, { 1, 6, .7071f },
+    } },
+    { DoWork_5_x_to_2_0, 5, 2, {
+        { 0, 0, 1.f }, { 0, 2, .7071f }, { 0, 4, .7071f },
+        { 1, 1, 1.f }, { 1, 3, .7071f }, { 1, 4, .7071f },
+    } },
+    { DoWork_7_x_to_4_0, 7, 4, {
+        { 0, 0, .5f }, { 0, 2, 1.f / 6 }, { 0, 6, 1.f },
+        { 1, 1, .5f }, { 1, 3, 1.f / 6 }, { 1, 6, 1.f },
+        { 2, 2, 1.f / 6 }, { 2, 4, 1.f },
+        { 3, 3, 1.f / 6 }, { 3, 5, 1.f },
+    } },
+    { DoWork_7_x_to_5_x, 7, 5, {
+        { 0, 0, 1.f }, { 1, 1, 1.f },
+        { 2, 2, .5f }, { 2, 4, .5f }, { 3, 3, .5f }, { 3, 5, .5f },
+        { 4, 6, 1.f },
+    } },
+};
+
+static void DoWork_Matrix( filter_t *p_filter, block_t *p_in_buf,
+                           block_t *p_out_buf )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->pf_mix( &p_sys->matrix, (float *)p_out_buf->p_buffer,
+                   (const float *)p_in_buf->p_buffer,
+                   p_in_buf->i_nb_samples );
+}
+
+static void SetupMatrix( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const bool b_in_lfe =
+        p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE;
+    const bool b_out_lfe =
+        p_filter->fmt_out.audio.i_physical_channels & AOUT_CHAN_LFE;
+
+    /* The mixes do not create an LFE channel */
+    if( b_out_lfe && !b_in_lfe )
+        return;
+
+    for( size_t i = 0; i < ARRAY_SIZE(matrices); i++ )
+    {
+        if( matrices[i].do_work != p_sys->do_work )
+            continue;
+
+        unsigned i_in = matrices[i].i_in + b_in_lfe;
+        unsigned i_out = matrices[i].i_out + b_out_lfe;
+
+        mix_matrix_Init( &p_sys->matrix, i_in, i_out );
+        for( unsigned j = 0; j < ARRAY_SIZE(matrices[i].terms)
+                          && matrices[i].terms[j].coeff != 0.f; j++ )
+            mix_matrix_Set( &p_sys->matrix, matrices[i].terms[j].out,
+                            matrices[i].terms[j].in,
+                            matrices[i].terms[j].coeff );
+        if( b_out_lfe )
+            mix_matrix_Set( &p_sys->matrix, i_out - 1, i_in - 1, 1.f );
+
+        p_sys->pf_mix = mix_Get( &p_sys->matrix );
+        if( p_sys->pf_mix != mix_C )
+            p_sys->do_work = DoWork_Matrix;
+        return;
+    }
+}
+
 #if defined (CAN_COMPILE_ARM)
 #include "simple_neon.h"
 #define GET_WORK(in, out) GET_WORK_##in##_to_##out##_neon()
@@ -348,17 +438,31 @@ static int OpenFilter( vlc_object_t *p_this )
     if( do_work == NULL )
         return VLC_EGENERIC;
 
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    p_sys->do_work = do_work;
+    p_filter->p_sys = p_sys;
+    SetupMatrix( p_filter );
+
     p_filter->pf_audio_filter = Filter;
-    p_filter->p_sys = (void *)do_work;
     return VLC_SUCCESS;
 }
 
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
 /*****************************************************************************
  * Filter:
  *****************************************************************************/
 static block_t *Filter( filter_t *p_filter, block_t *p_block )
 {
-    void (*work)(filter_t *, block_t *, block_t *) = (void *)p_filter->p_sys;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
     if( !p_block || !p_block->i_nb_samples )
     {
@@ -371,7 +475,7 @@ static block_t *Filter( filter_t *p_filter, block_t *p_block )
       p_filter->fmt_out.audio.i_bitspersample *
         p_filter->fmt_out.audio.i_channels / 8;
 
-    block_t *p_out = block_Alloc( i_out_size );
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_out_size );
     if( !p_out )
     {
         msg_Warn( p_filter, "can't get output buffer" );
@@ -389,7 +493,7 @@ static block_t *Filter( filter_t *p_filter, block_t *p_block )
     p_out->i_nb_samples = p_block->i_nb_samples;
     p_out->i_buffer = p_block->i_buffer * i_output_nb / i_input_nb;
 
-    work( p_filter, p_block, p_out );
+    p_sys->do_work( p_filter, p_block, p_out );
 
     block_Release( p_block );
 
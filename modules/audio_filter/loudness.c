@@ -0,0 +1,517 @@
+/*****************************************************************************
+ * loudness.c: EBU R 128 loudness meter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Measures the loudness of the audio passing through, as defined by
+ * ITU-R BS.1770-4 and EBU R 128 / Tech 3341:
+ *  - the signal is K-weighted (high shelf then high pass),
+ *  - the weighted mean square of the channels is computed over 100 ms blocks,
+ *  - momentary and short-term loudness are the mean over the last 400 ms and
+ *    3 s respectively,
+ *  - integrated loudness is gated: absolute gate at -70 LUFS, then relative
+ *    gate 10 LU below the absolutely gated loudness,
+ *  - true peak is the sample peak of the signal oversampled 4 times.
+ *
+ * Integrated loudness must not depend on the stream duration, so the 400 ms
+ * gating blocks are not stored but counted in a histogram of 0.1 LU bins.
+ * The relative gate is thus applied with a 0.1 LU resolution.
+ *
+ * The audio is not modified. The measures are published as float variables
+ * on the parent object (the audio output, or the transcoder), updated every
+ * 100 ms.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#include "biquad.h"
+
+static int  Open(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin()
+    set_shortname(N_("Loudness meter"))
+    set_description(N_("EBU R 128 loudness meter"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    set_capability("audio filter", 0)
+    add_shortcut("loudness", "ebur128")
+    set_callbacks(Open, Close)
+vlc_module_end()
+
+#define BLOCK_PER_SEC 10           /* 100 ms */
+#define MOMENTARY_BLOCKS 4         /* 400 ms */
+#define SHORT_TERM_BLOCKS 30       /* 3 s */
+#define ABSOLUTE_GATE (-70.)       /* LUFS */
+#define RELATIVE_GATE (-10.)       /* LU */
+
+#define HIST_STEP 10               /* bins per LU */
+#define HIST_BINS (100 * HIST_STEP) /* from -70 to +30 LUFS */
+
+#define SCRATCH_FRAMES 1024
+
+/* Polyphase interpolator for the true peak */
+#define TP_PHASES 4
+#define TP_TAPS 12
+
+typedef float (*peak_fn)(const float coeffs[][TP_PHASES], float *hist,
+                         unsigned pos, const float *src, unsigned stride,
+                         unsigned count, float peak);
+
+struct filter_sys_t
+{
+    vlc_object_t *obj; /**< Object carrying the measure variables */
+    unsigned channels;
+    float *weights;
+
+    /* K-weighting */
+    biquad_cascade_fn pf_cascade;
+    float coeffs[2 * 5];
+    float *state;
+    float *scratch;
+
+    /* Current 100 ms block */
+    unsigned block_frames;
+    unsigned block_pos;
+    double block_energy;
+
+    /* Last blocks mean squares */
+    double energies[SHORT_TERM_BLOCKS];
+    unsigned energy_pos;
+    unsigned energy_count;
+
+    /* Gating blocks for the integrated loudness */
+    uint32_t hist_count[HIST_BINS];
+    double hist_energy[HIST_BINS];
+
+    /* True peak */
+    peak_fn pf_peak;
+    float *tp_hist; /**< 2 * TP_TAPS samples per channel */
+    unsigned tp_pos;
+    float true_peak;
+    float tp_coeffs[TP_TAPS][TP_PHASES];
+};
+
+static double Loudness(double energy)
+{
+    return -0.691 + 10. * log10(energy);
+}
+
+/*****************************************************************************
+ * True peak kernels
+ *****************************************************************************/
+/* The history is doubled, so that the last TP_TAPS samples are always
+ * contiguous: hist[pos + 1] (oldest) to hist[pos + TP_TAPS] (newest). */
+static float Peak_C(const float coeffs[][TP_PHASES], float *hist,
+                    unsigned pos, const float *src, unsigned stride,
+                    unsigned count, float peak)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        pos = (pos + 1) % TP_TAPS;
+        hist[pos] = hist[pos + TP_TAPS] = src[i * stride];
+
+        const float *x = hist + pos + 1;
+        float y[TP_PHASES] = { 0.f };
+
+        for (unsigned t = 0; t < TP_TAPS; t++)
+            for (unsigned p = 0; p < TP_PHASES; p++)
+                y[p] += coeffs[t][p] * x[t];
+        for (unsigned p = 0; p < TP_PHASES; p++)
+            peak = fmaxf(peak, fabsf(y[p]));
+    }
+    return peak;
+}
+
+#ifdef BIQUAD_SSE
+__attribute__ ((__target__ ("sse")))
+static float Peak_SSE(const float coeffs[][TP_PHASES], float *hist,
+                      unsigned pos, const float *src, unsigned stride,
+                      unsigned count, float peak)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 vpeak = _mm_set1_ps(peak);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        pos = (pos + 1) % TP_TAPS;
+        hist[pos] = hist[pos + TP_TAPS] = src[i * stride];
+
+        const float *x = hist + pos + 1;
+        __m128 y = _mm_setzero_ps();
+
+        /* All phases at once */
+        for (unsigned t = 0; t < TP_TAPS; t++)
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(coeffs[t]),
+                                         _mm_set1_ps(x[t])));
+        vpeak = _mm_max_ps(vpeak, _mm_andnot_ps(sign, y));
+    }
+
+    vpeak = _mm_max_ps(vpeak, _mm_movehl_ps(vpeak, vpeak));
+    vpeak = _mm_max_ss(vpeak, _mm_shuffle_ps(vpeak, vpeak, 1));
+    return _mm_cvtss_f32(vpeak);
+}
+#endif
+
+#ifdef BIQUAD_NEON
+static float Peak_NEON(const float coeffs[][TP_PHASES], float *hist,
+                       unsigned pos, const float *src, unsigned stride,
+                       unsigned count, float peak)
+{
+    float32x4_t vpeak = vdupq_n_f32(peak);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        pos = (pos + 1) % TP_TAPS;
+        hist[pos] = hist[pos + TP_TAPS] = src[i * stride];
+
+        const float *x = hist + pos + 1;
+        float32x4_t y = vdupq_n_f32(0.f);
+
+        for (unsigned t = 0; t < TP_TAPS; t++)
+            y = vmlaq_n_f32(y, vld1q_f32(coeffs[t]), x[t]);
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(y));
+    }
+
+    float32x2_t p = vmax_f32(vget_low_f32(vpeak), vget_high_f32(vpeak));
+    p = vpmax_f32(p, p);
+    return vget_lane_f32(p, 0);
+}
+#endif
+
+static peak_fn Peak_Get(void)
+{
+#ifdef BIQUAD_SSE
+    if (vlc_CPU_SSE())
+        return Peak_SSE;
+#endif
+#ifdef BIQUAD_NEON
+    return Peak_NEON;
+#endif
+    return Peak_C;
+}
+
+/*****************************************************************************
+ * Filters design
+ *****************************************************************************/
+/* BS.1770 gives the coefficients at 48 kHz only: these are the analog
+ * prototypes matching them, so that any sample rate can be supported. */
+static void KWeightingCoeffs(float *c, double rate)
+{
+    /* High shelf (head effect) */
+    double k = tan(M_PI * 1681.974450955533 / rate);
+    double q = 0.7071752369554196;
+    double vh = pow(10., 3.999843853973347 / 20.);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1. + k / q + k * k;
+
+    c[0] = (vh + vb * k / q + k * k) / a0;
+    c[1] = 2. * (k * k - vh) / a0;
+    c[2] = (vh - vb * k / q + k * k) / a0;
+    c[3] = 2. * (k * k - 1.) / a0;
+    c[4] = (1. - k / q + k * k) / a0;
+
+    /* RLB high pass */
+    k = tan(M_PI * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1. + k / q + k * k;
+
+    c[5] = 1.;
+    c[6] = -2.;
+    c[7] = 1.;
+    c[8] = 2. * (k * k - 1.) / a0;
+    c[9] = (1. - k / q + k * k) / a0;
+}
+
+/* Hann-windowed sinc, the phase 0 being the sample itself */
+static void TruePeakCoeffs(float coeffs[][TP_PHASES])
+{
+    const double half = TP_TAPS / 2 + .5;
+
+    for (unsigned p = 0; p < TP_PHASES; p++)
+        for (unsigned t = 0; t < TP_TAPS; t++)
+        {
+            double u = (double)t - (TP_TAPS / 2 - 1) - (double)p / TP_PHASES;
+            double sinc = (u == 0.) ? 1. : sin(M_PI * u) / (M_PI * u);
+
+            coeffs[t][p] = sinc * .5 * (1. + cos(M_PI * u / half));
+        }
+}
+
+/* ITU-R BS.1770-4 channel weights: surround channels count for +1.5 dB and
+ * the LFE is ignored. */
+static void ChannelWeights(float *weights, const audio_format_t *fmt,
+                           unsigned channels)
+{
+    unsigned ch = 0;
+
+    for (unsigned i = 0; pi_vlc_chan_order_wg4[i] && ch < channels; i++)
+    {
+        uint32_t chan = pi_vlc_chan_order_wg4[i];
+
+        if (!(fmt->i_physical_channels & chan))
+            continue;
+        switch (chan)
+        {
+            case AOUT_CHAN_LFE:
+                weights[ch] = 0.f;
+                break;
+            case AOUT_CHAN_MIDDLELEFT:
+            case AOUT_CHAN_MIDDLERIGHT:
+            case AOUT_CHAN_REARLEFT:
+            case AOUT_CHAN_REARRIGHT:
+            case AOUT_CHAN_REARCENTER:
+                weights[ch] = 1.41f;
+                break;
+            default:
+                weights[ch] = 1.f;
+        }
+        ch++;
+    }
+    while (ch < channels)
+        weights[ch++] = 1.f;
+}
+
+/*****************************************************************************
+ * Measures
+ *****************************************************************************/
+static double Integrated(const filter_sys_t *sys)
+{
+    double energy = 0.;
+    uint64_t count = 0;
+
+    for (unsigned i = 0; i < HIST_BINS; i++)
+    {
+        energy += sys->hist_energy[i];
+        count += sys->hist_count[i];
+    }
+    if (count == 0)
+        return -INFINITY;
+
+    double gate = Loudness(energy / count) + RELATIVE_GATE;
+    int first = ceil((gate - ABSOLUTE_GATE) * HIST_STEP);
+
+    if (first < 0)
+        first = 0;
+    energy = 0.;
+    count = 0;
+    for (unsigned i = first; i < HIST_BINS; i++)
+    {
+        energy += sys->hist_energy[i];
+        count += sys->hist_count[i];
+    }
+    return count ? Loudness(energy / count) : -INFINITY;
+}
+
+static double MeanEnergy(const filter_sys_t *sys, unsigned blocks)
+{
+    double energy = 0.;
+
+    if (blocks > sys->energy_count)
+        blocks = sys->energy_count;
+    for (unsigned i = 1; i <= blocks; i++)
+        energy += sys->energies[(sys->energy_pos + SHORT_TERM_BLOCKS - i)
+                                % SHORT_TERM_BLOCKS];
+    return energy / blocks;
+}
+
+static void EndBlock(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    sys->energies[sys->energy_pos] = sys->block_energy / sys->block_frames;
+    sys->energy_pos = (sys->energy_pos + 1) % SHORT_TERM_BLOCKS;
+    if (sys->energy_count < SHORT_TERM_BLOCKS)
+        sys->energy_count++;
+    sys->block_pos = 0;
+    sys->block_energy = 0.;
+
+    double momentary = MeanEnergy(sys, MOMENTARY_BLOCKS);
+    double m = Loudness(momentary);
+
+    /* Gating blocks overlap by 75%: one every 100 ms */
+    if (sys->energy_count >= MOMENTARY_BLOCKS && m >= ABSOLUTE_GATE)
+    {
+        unsigned bin = (m - ABSOLUTE_GATE) * HIST_STEP;
+
+        if (bin >= HIST_BINS)
+            bin = HIST_BINS - 1;
+        sys->hist_count[bin]++;
+        sys->hist_energy[bin] += momentary;
+    }
+
+    var_SetFloat(sys->obj, "loudness-momentary", m);
+    var_SetFloat(sys->obj, "loudness-short-term",
+                 Loudness(MeanEnergy(sys, SHORT_TERM_BLOCKS)));
+    var_SetFloat(sys->obj, "loudness-integrated", Integrated(sys));
+    var_SetFloat(sys->obj, "loudness-true-peak", 20.f * log10f(sys->true_peak));
+}
+
+static block_t *Process(filter_t *filter, block_t *block)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = sys->channels;
+    const float *src = (const float *)block->p_buffer;
+    unsigned frames = block->i_nb_samples;
+    unsigned fpu = biquad_DenormalsOff();
+
+    while (frames > 0)
+    {
+        unsigned count = sys->block_frames - sys->block_pos;
+
+        if (count > frames)
+            count = frames;
+        if (count > SCRATCH_FRAMES)
+            count = SCRATCH_FRAMES;
+
+        /* Weighted mean square */
+        sys->pf_cascade(sys->coeffs, 2, sys->state, sys->scratch, src,
+                        channels, count);
+        for (unsigned ch = 0; ch < channels; ch++)
+        {
+            float sum = 0.f;
+
+            if (sys->weights[ch] == 0.f)
+                continue;
+            for (unsigned i = 0; i < count; i++)
+            {
+                float x = sys->scratch[i * channels + ch];
+
+                sum += x * x;
+            }
+            sys->block_energy += sys->weights[ch] * sum;
+        }
+
+        /* True peak */
+        for (unsigned ch = 0; ch < channels; ch++)
+            sys->true_peak = sys->pf_peak(sys->tp_coeffs,
+                                          sys->tp_hist + 2 * TP_TAPS * ch,
+                                          sys->tp_pos, src + ch, channels,
+                                          count, sys->true_peak);
+        sys->tp_pos = (sys->tp_pos + count) % TP_TAPS;
+
+        src += count * channels;
+        frames -= count;
+        sys->block_pos += count;
+        if (sys->block_pos == sys->block_frames)
+            EndBlock(filter);
+    }
+
+    biquad_cascade_Flush(sys->state, 2, channels);
+    biquad_DenormalsRestore(fpu);
+    return block;
+}
+
+/* Discontinuity: the statistics are kept, the filters and windows reset */
+static void Flush(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    memset(sys->state, 0, 4 * 2 * sys->channels * sizeof (float));
+    memset(sys->tp_hist, 0, 2 * TP_TAPS * sys->channels * sizeof (float));
+    sys->block_pos = 0;
+    sys->block_energy = 0.;
+    sys->energy_pos = 0;
+    sys->energy_count = 0;
+}
+
+static const char *const measures[] = {
+    "loudness-momentary", "loudness-short-term", "loudness-integrated",
+    "loudness-true-peak",
+};
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const unsigned channels = aout_FormatNbChannels(&filter->fmt_in.audio);
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+
+    if (channels == 0 || rate < BLOCK_PER_SEC)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->weights = malloc(channels * sizeof (float));
+    sys->state = calloc(4 * 2 * channels, sizeof (float));
+    sys->scratch = malloc(SCRATCH_FRAMES * channels * sizeof (float));
+    sys->tp_hist = calloc(2 * TP_TAPS * channels, sizeof (float));
+    if (unlikely(sys->weights == NULL || sys->state == NULL
+              || sys->scratch == NULL || sys->tp_hist == NULL))
+    {
+        free(sys->tp_hist);
+        free(sys->scratch);
+        free(sys->state);
+        free(sys->weights);
+        free(sys);
+        return VLC_ENOMEM;
+    }
+
+    sys->obj = obj->obj.parent;
+    sys->channels = channels;
+    sys->block_frames = rate / BLOCK_PER_SEC;
+    sys->pf_cascade = biquad_cascade_Get();
+    sys->pf_peak = Peak_Get();
+    ChannelWeights(sys->weights, &filter->fmt_in.audio, channels);
+    KWeightingCoeffs(sys->coeffs, rate);
+    TruePeakCoeffs(sys->tp_coeffs);
+
+    for (size_t i = 0; i < ARRAY_SIZE(measures); i++)
+    {
+        var_Create(sys->obj, measures[i], VLC_VAR_FLOAT);
+        var_SetFloat(sys->obj, measures[i], -INFINITY);
+    }
+
+    filter->p_sys = sys;
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_out.audio = filter->fmt_in.audio;
+    filter->pf_audio_filter = Process;
+    filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    msg_Dbg(obj, "integrated loudness %.1f LUFS, true peak %.1f dBTP",
+            Integrated(sys), 20. * log10(sys->true_peak));
+
+    for (size_t i = 0; i < ARRAY_SIZE(measures); i++)
+        var_Destroy(sys->obj, measures[i]);
+
+    free(sys->tp_hist);
+    free(sys->scratch);
+    free(sys->state);
+    free(sys->weights);
+    free(sys);
+}
@@ -37,6 +37,8 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -44,8 +46,6 @@ static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 static void CalcPeakEQCoeffs( float, float, float, float, float * );
 static void CalcShelfEQCoeffs( float, float, float, int, float, float * );
-static void ProcessEQ( const float *, float *, float *, unsigned, unsigned,
-                       const float *, unsigned );
 static block_t *DoWork( filter_t *, block_t * );
 
 vlc_module_begin ()
@@ -93,8 +93,9 @@ struct filter_sys_t
     float   f_highf, f_highgain;
     /* Filter computed coeffs */
     float   coeffs[5*5];
-    /* State */
+    /* State (see biquad_cascade_fn) */
     float  *p_state;
+    biquad_cascade_fn pf_cascade;
 };
 
 
@@ -148,6 +149,7 @@ static int Open( vlc_object_t *p_this )
                       i_samplerate, p_sys->coeffs+4*5);
     p_sys->p_state = (float*)calloc( p_filter->fmt_in.audio.i_channels*5*4,
                                      sizeof(float) );
+    p_sys->pf_cascade = biquad_cascade_Get();
 
     return VLC_SUCCESS;
 }
@@ -166,10 +168,16 @@ static void Close( vlc_object_t *p_this )
  *****************************************************************************/
 static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
-    ProcessEQ( (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
-               p_filter->p_sys->p_state,
-               p_filter->fmt_in.audio.i_channels, p_in_buf->i_nb_samples,
-               p_filter->p_sys->coeffs, 5 );
+    filter_sys_t *p_sys = p_filter->p_sys;
+    unsigned i_fpu = biquad_DenormalsOff();
+
+    p_sys->pf_cascade( p_sys->coeffs, 5, p_sys->p_state,
+                       (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
+                       p_filter->fmt_in.audio.i_channels,
+                       p_in_buf->i_nb_samples );
+    biquad_cascade_Flush( p_sys->p_state, 5,
+                          p_filter->fmt_in.audio.i_channels );
+    biquad_DenormalsRestore( i_fpu );
     return p_in_buf;
 }
 
@@ -274,49 +282,3 @@ static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
     coeffs[4] = a2/a0;
 }
 
-/*
-  src is assumed to be interleaved
-  dest is assumed to be interleaved
-  size of state is 4*channels*eqCount
-  samples is not premultiplied by channels
-  size of coeffs is 5*eqCount
-*/
-void ProcessEQ( const float *src, float *dest, float *state,
-                unsigned channels, unsigned samples, const float *coeffs,
-                unsigned eqCount )
-{
-    unsigned i, chn, eq;
-    float   b0, b1, b2, a1, a2;
-    float   x, y = 0;
-    const float *src1 = src;
-    float *dest1 = dest;
-
-    for (i = 0; i < samples; i++)
-    {
-        float *state1 = state;
-        for (chn = 0; chn < channels; chn++)
-        {
-            const float *coeffs1 = coeffs;
-            x = *src1++;
-            /* Direct form 1 IIRs */
-            for (eq = 0; eq < eqCount; eq++)
-            {
-                b0 = coeffs1[0];
-                b1 = coeffs1[1];
-                b2 = coeffs1[2];
-                a1 = coeffs1[3];
-                a2 = coeffs1[4];
-                coeffs1 += 5;
-                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
-                state1[1] = state1[0];
-                state1[0] = x;
-                state1[3] = state1[2];
-                state1[2] = y;
-                x = y;
-                state1 += 4;
-            }
-            *dest1++ = y;
-        }
-    }
-}
-
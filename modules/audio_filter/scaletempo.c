@@ -32,6 +32,7 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
@@ -111,8 +112,144 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    void    (*corr)( const float *a, const float *b, unsigned n,
+                     unsigned step, float *out );
 };
 
+/*****************************************************************************
+ * corr: correlate the pre-correlation buffer with 4 consecutive positions
+ *****************************************************************************
+ * Each sample of the pre-correlation buffer is loaded once for the 4 search
+ * positions, which also keeps 4 independent sums in flight.
+ */
+static float corr_one( const float *a, const float *b, unsigned n )
+{
+    float sum = 0.f;
+
+    for( unsigned i = 0; i < n; i++ )
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static void corr_C( const float *a, const float *b, unsigned n,
+                    unsigned step, float *out )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i] * b[step + i];
+        s2 += a[i] * b[2 * step + i];
+        s3 += a[i] * b[3 * step + i];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <xmmintrin.h>
+
+__attribute__ ((__target__ ("sse")))
+static void corr_SSE( const float *a, const float *b, unsigned n,
+                      unsigned step, float *out )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    unsigned i = 0;
+
+    for( ; i + 4 <= n; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( a + i );
+
+        s0 = _mm_add_ps( s0, _mm_mul_ps( x, _mm_loadu_ps( b + i ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( x, _mm_loadu_ps( b + step + i ) ) );
+        s2 = _mm_add_ps( s2, _mm_mul_ps( x, _mm_loadu_ps( b + 2 * step + i ) ) );
+        s3 = _mm_add_ps( s3, _mm_mul_ps( x, _mm_loadu_ps( b + 3 * step + i ) ) );
+    }
+    _MM_TRANSPOSE4_PS( s0, s1, s2, s3 );
+    _mm_storeu_ps( out, _mm_add_ps( _mm_add_ps( s0, s1 ),
+                                    _mm_add_ps( s2, s3 ) ) );
+
+    for( ; i < n; i++ )
+        for( unsigned k = 0; k < 4; k++ )
+            out[k] += a[i] * b[k * step + i];
+}
+
+# if VLC_GCC_VERSION(4, 9) || defined(__clang__)
+#  define CORR_AVX
+#  include <immintrin.h>
+
+__attribute__ ((__target__ ("avx")))
+static void corr_AVX( const float *a, const float *b, unsigned n,
+                      unsigned step, float *out )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        __m256 x = _mm256_loadu_ps( a + i );
+
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( x,
+                            _mm256_loadu_ps( b + i ) ) );
+        s1 = _mm256_add_ps( s1, _mm256_mul_ps( x,
+                            _mm256_loadu_ps( b + step + i ) ) );
+        s2 = _mm256_add_ps( s2, _mm256_mul_ps( x,
+                            _mm256_loadu_ps( b + 2 * step + i ) ) );
+        s3 = _mm256_add_ps( s3, _mm256_mul_ps( x,
+                            _mm256_loadu_ps( b + 3 * step + i ) ) );
+    }
+
+    /* Sum each accumulator into lane k of the result */
+    __m256 h = _mm256_hadd_ps( _mm256_hadd_ps( s0, s1 ),
+                               _mm256_hadd_ps( s2, s3 ) );
+    _mm_storeu_ps( out, _mm_add_ps( _mm256_castps256_ps128( h ),
+                                    _mm256_extractf128_ps( h, 1 ) ) );
+
+    for( ; i < n; i++ )
+        for( unsigned k = 0; k < 4; k++ )
+            out[k] += a[i] * b[k * step + i];
+}
+# endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+
+static void corr_NEON( const float *a, const float *b, unsigned n,
+                       unsigned step, float *out )
+{
+    float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = s0, s2 = s0, s3 = s0;
+    unsigned i = 0;
+
+    for( ; i + 4 <= n; i += 4 )
+    {
+        float32x4_t x = vld1q_f32( a + i );
+
+        s0 = vmlaq_f32( s0, x, vld1q_f32( b + i ) );
+        s1 = vmlaq_f32( s1, x, vld1q_f32( b + step + i ) );
+        s2 = vmlaq_f32( s2, x, vld1q_f32( b + 2 * step + i ) );
+        s3 = vmlaq_f32( s3, x, vld1q_f32( b + 3 * step + i ) );
+    }
+
+    float32x2_t h01 = vpadd_f32( vadd_f32( vget_low_f32( s0 ),
+                                           vget_high_f32( s0 ) ),
+                                 vadd_f32( vget_low_f32( s1 ),
+                                           vget_high_f32( s1 ) ) );
+    float32x2_t h23 = vpadd_f32( vadd_f32( vget_low_f32( s2 ),
+                                           vget_high_f32( s2 ) ),
+                                 vadd_f32( vget_low_f32( s3 ),
+                                           vget_high_f32( s3 ) ) );
+    vst1q_f32( out, vcombine_f32( h01, h23 ) );
+
+    for( ; i < n; i++ )
+        for( unsigned k = 0; k < 4; k++ )
+            out[k] += a[i] * b[k * step + i];
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -123,6 +260,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     float best_corr = INT_MIN;
     unsigned best_off = 0;
     unsigned i, off;
+    const unsigned samples_corr = p->samples_overlap - p->samples_per_frame;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -133,13 +271,20 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     }
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
-    for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
+    for( off = 0; off + 4 <= p->frames_search; off += 4 ) {
+      float corr[4];
+      p->corr( p->buf_pre_corr, search_start, samples_corr,
+               p->samples_per_frame, corr );
+      for( i = 0; i < 4; i++ ) {
+        if( corr[i] > best_corr ) {
+          best_corr = corr[i];
+          best_off  = off + i;
+        }
       }
+      search_start += 4 * p->samples_per_frame;
+    }
+    for( ; off < p->frames_search; off++ ) {
+      float corr = corr_one( p->buf_pre_corr, search_start, samples_corr );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -338,6 +483,20 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+
+        p->corr = corr_C;
+#if defined(HAVE_SSE2_INTRINSICS)
+# ifdef CORR_AVX
+        if( vlc_CPU_AVX() )
+            p->corr = corr_AVX;
+        else
+# endif
+        if( vlc_CPU_SSE() )
+            p->corr = corr_SSE;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        p->corr = corr_NEON;
+#endif
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -70,8 +70,6 @@ struct decoder_sys_t
     uint64_t i_previous_layout;
 };
 
-#define BLOCK_FLAG_PRIVATE_REALLOCATED (1 << BLOCK_FLAG_PRIVATE_SHIFT)
-
 static void SetupOutputFormat( decoder_t *p_dec, bool b_trust );
 static block_t * ConvertAVFrame( decoder_t *p_dec, AVFrame *frame );
 static int  DecodeAudio( decoder_t *, block_t * );
@@ -355,17 +353,10 @@ static block_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error )
         if( p_block->i_buffer <= 0 )
             goto drop;
 
-        if( (p_block->i_flags & BLOCK_FLAG_PRIVATE_REALLOCATED) == 0 )
-        {
-            p_block = block_Realloc( p_block, 0, p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
-            if( !p_block )
-                return NULL;
-            *pp_block = p_block;
-            p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
-            memset( &p_block->p_buffer[p_block->i_buffer], 0, FF_INPUT_BUFFER_PADDING_SIZE );
-
-            p_block->i_flags |= BLOCK_FLAG_PRIVATE_REALLOCATED;
-        }
+        p_block = ffmpeg_WrapBlock( p_block );
+        if( !p_block )
+            return NULL;
+        *pp_block = p_block;
     }
 
     frame = av_frame_alloc();
@@ -379,9 +370,9 @@ static block_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error )
         {
             AVPacket pkt;
             av_init_packet( &pkt );
-            pkt.data = p_block->p_buffer;
-            pkt.size = p_block->i_buffer;
+            ffmpeg_PacketFromBlock( &pkt, p_block );
             ret = avcodec_send_packet( ctx, &pkt );
+            av_packet_unref( &pkt );
             if( ret == 0 ) /* Block has been consumed */
             {
                 /* Only set new pts from input block if it has been used,
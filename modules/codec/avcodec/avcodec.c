@@ -29,6 +29,8 @@
 # include "config.h"
 #endif
 
+#include <limits.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_codec.h>
@@ -403,3 +405,81 @@ void ffmpeg_CloseCodec( decoder_t *p_dec )
     vlc_avcodec_unlock();
     msg_Dbg( p_dec, "ffmpeg codec (%s) stopped", p_sys->p_codec->name );
 }
+
+/*****************************************************************************
+ * ffmpeg_WrapBlock: lets libavcodec reference a block payload
+ *****************************************************************************
+ * libavcodec copies the payload of packets that are not reference counted.
+ * The wrapper below exposes the block as an AVBufferRef instead, the original
+ * block being released once both VLC and libavcodec are done with it.
+ *****************************************************************************/
+typedef struct
+{
+    block_t      self;
+    AVBufferRef *p_buf;
+} vlc_av_block_t;
+
+static void ffmpeg_ReleaseBufferBlock( void *opaque, uint8_t *data )
+{
+    VLC_UNUSED( data );
+    block_Release( opaque );
+}
+
+static void ffmpeg_ReleaseWrappedBlock( block_t *p_block )
+{
+    vlc_av_block_t *b = (vlc_av_block_t *) p_block;
+
+    av_buffer_unref( &b->p_buf );
+    free( b );
+}
+
+block_t *ffmpeg_WrapBlock( block_t *p_block )
+{
+    if( p_block->pf_release == ffmpeg_ReleaseWrappedBlock )
+        return p_block; /* already padded and wrapped */
+
+    /* Don't forget that libavcodec requires a little more bytes
+     * that the real frame size */
+    p_block = block_Realloc( p_block, 0,
+                             p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+    p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
+    memset( &p_block->p_buffer[p_block->i_buffer], 0,
+            FF_INPUT_BUFFER_PADDING_SIZE );
+
+    if( p_block->i_size > INT_MAX )
+        return p_block;
+
+    vlc_av_block_t *b = malloc( sizeof( *b ) );
+    if( unlikely(b == NULL) )
+        return p_block; /* libavcodec will copy the payload */
+
+    b->p_buf = av_buffer_create( p_block->p_start, p_block->i_size,
+                                 ffmpeg_ReleaseBufferBlock, p_block, 0 );
+    if( unlikely(b->p_buf == NULL) )
+    {
+        free( b );
+        return p_block;
+    }
+
+    block_Init( &b->self, p_block->p_start, p_block->i_size );
+    b->self.p_buffer = p_block->p_buffer;
+    b->self.i_buffer = p_block->i_buffer;
+    block_CopyProperties( &b->self, p_block );
+    b->self.pf_release = ffmpeg_ReleaseWrappedBlock;
+    return &b->self;
+}
+
+void ffmpeg_PacketFromBlock( AVPacket *p_pkt, block_t *p_block )
+{
+    p_pkt->data = p_block->p_buffer;
+    p_pkt->size = p_block->i_buffer;
+
+    if( p_block->pf_release == ffmpeg_ReleaseWrappedBlock )
+    {
+        vlc_av_block_t *b = (vlc_av_block_t *) p_block;
+        /* On failure, libavcodec falls back to copying the data */
+        p_pkt->buf = av_buffer_ref( b->p_buf );
+    }
+}
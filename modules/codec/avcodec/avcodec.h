@@ -50,6 +50,10 @@ int InitSubtitleDec( decoder_t *, AVCodecContext *, const AVCodec * );
 int ffmpeg_OpenCodec( decoder_t *p_dec );
 void ffmpeg_CloseCodec( decoder_t *p_dec );
 
+/* Zero-copy packets */
+block_t *ffmpeg_WrapBlock( block_t * );
+void ffmpeg_PacketFromBlock( AVPacket *, block_t * );
+
 /*****************************************************************************
  * Module descriptor help strings
  *****************************************************************************/
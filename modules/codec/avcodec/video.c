@@ -786,20 +786,15 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
     /*
      * Do the actual decoding now */
 
-    /* Don't forget that libavcodec requires a little more bytes
-     * that the real frame size */
+    /* Pad the block and let libavcodec reference it rather than copy it */
     if( p_block && p_block->i_buffer > 0 )
     {
         eos_spotted = ( p_block->i_flags & BLOCK_FLAG_END_OF_SEQUENCE ) != 0;
 
-        p_block = block_Realloc( p_block, 0,
-                            p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
+        p_block = ffmpeg_WrapBlock( p_block );
         if( !p_block )
             return NULL;
-        p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
         *pp_block = p_block;
-        memset( p_block->p_buffer + p_block->i_buffer, 0,
-                FF_INPUT_BUFFER_PADDING_SIZE );
     }
 
     while( !p_block || p_block->i_buffer > 0 || eos_spotted )
@@ -812,8 +807,7 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
         av_init_packet( &pkt );
         if( p_block )
         {
-            pkt.data = p_block->p_buffer;
-            pkt.size = p_block->i_buffer;
+            ffmpeg_PacketFromBlock( &pkt, p_block );
             pkt.pts = p_block->i_pts > VLC_TS_INVALID ? p_block->i_pts : AV_NOPTS_VALUE;
             pkt.dts = p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : AV_NOPTS_VALUE;
         }
@@ -1733,6 +1733,12 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             p_item->p_stats->i_demux_corrupted );
     msg_rc(_("| discontinuities  :    %5"PRIi64),
             p_item->p_stats->i_demux_discontinuity );
+    msg_rc(_("| clock latency    :    %5"PRIi64" ms"),
+            p_item->p_stats->i_clock_latency / 1000 );
+    msg_rc(_("| clock jitter     :    %5"PRIi64" ms"),
+            p_item->p_stats->i_clock_jitter / 1000 );
+    msg_rc(_("| late references  :    %5"PRIi64),
+            p_item->p_stats->i_clock_late );
     msg_rc("|");
     /* Video */
     msg_rc("%s", _("+-[Video Decoding]"));
@@ -78,7 +78,11 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, mtime_t duration)
 SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
 {
     first = true;
+    deferring = false;
+    prefetched = false;
     curNumber = next = 0;
+    playingNumber = playingNext = 0;
+    playingRepresentation = NULL;
     initializing = true;
     index_sent = false;
     init_sent = false;
@@ -136,6 +140,46 @@ void SegmentTracker::reset()
 
 SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
                                             AbstractConnectionManager *connManager)
+{
+    return fetchNextChunk(switch_allowed, connManager);
+}
+
+SegmentChunk * SegmentTracker::prefetchNextChunk(bool switch_allowed,
+                                                 AbstractConnectionManager *connManager)
+{
+    /* Until the prefetched chunk becomes current, positions are
+     * reported for the chunk being read */
+    playingNext = next;
+    playingNumber = curNumber;
+    playingRepresentation = curRepresentation;
+
+    deferring = true;
+    SegmentChunk *chunk = fetchNextChunk(switch_allowed, connManager);
+    deferring = false;
+    prefetched = true;
+    return chunk;
+}
+
+void SegmentTracker::notifyPrefetchedChunk()
+{
+    prefetched = false;
+    std::list<SegmentTrackerEvent> events;
+    events.swap(deferredEvents);
+    while(!events.empty())
+    {
+        notify(events.front());
+        events.pop_front();
+    }
+}
+
+void SegmentTracker::dropPrefetchedChunk()
+{
+    prefetched = false;
+    deferredEvents.clear();
+}
+
+SegmentChunk * SegmentTracker::fetchNextChunk(bool switch_allowed,
+                                              AbstractConnectionManager *connManager)
 {
     BaseRepresentation *rep = NULL, *prevRep = NULL;
     ISegment *segment;
@@ -304,18 +348,26 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         init_sent = false;
     }
     curNumber = next = segnumber;
+    prefetched = false;
 }
 
-mtime_t SegmentTracker::getPlaybackTime() const
+BaseRepresentation * SegmentTracker::getPlayingRepresentation() const
 {
-    mtime_t time, duration;
-
-    BaseRepresentation *rep = curRepresentation;
+    BaseRepresentation *rep = prefetched ? playingRepresentation
+                                         : curRepresentation;
     if(!rep)
         rep = logic->getNextRepresentation(adaptationSet, NULL);
+    return rep;
+}
 
+mtime_t SegmentTracker::getPlaybackTime() const
+{
+    mtime_t time, duration;
+
+    BaseRepresentation *rep = getPlayingRepresentation();
     if(rep &&
-       rep->getPlaybackTimeDurationBySegmentNumber(next, &time, &duration))
+       rep->getPlaybackTimeDurationBySegmentNumber(prefetched ? playingNext : next,
+                                                   &time, &duration))
     {
         return time;
     }
@@ -324,11 +376,9 @@ mtime_t SegmentTracker::getPlaybackTime() const
 
 mtime_t SegmentTracker::getMinAheadTime() const
 {
-    BaseRepresentation *rep = curRepresentation;
-    if(!rep)
-        rep = logic->getNextRepresentation(adaptationSet, NULL);
+    BaseRepresentation *rep = getPlayingRepresentation();
     if(rep)
-        return rep->getMinAheadTime(curNumber);
+        return rep->getMinAheadTime(prefetched ? playingNumber : curNumber);
     return 0;
 }
 
@@ -351,13 +401,25 @@ void SegmentTracker::updateSelected()
 {
     if(curRepresentation && curRepresentation->needsUpdate())
     {
-        curRepresentation->runLocalUpdates(getPlaybackTime(), curNumber, true);
-        curRepresentation->scheduleNextUpdate(curNumber);
+        /* Don't prune the segment being read */
+        const uint64_t number = (prefetched &&
+                                 playingRepresentation == curRepresentation)
+                              ? playingNumber : curNumber;
+        curRepresentation->runLocalUpdates(getPlaybackTime(), number, true);
+        curRepresentation->scheduleNextUpdate(number);
     }
 }
 
 void SegmentTracker::notify(const SegmentTrackerEvent &event) const
 {
+    /* Neither the stream nor the logic must see the events of a prefetched
+     * chunk while the current one is still being demuxed */
+    if(deferring)
+    {
+        deferredEvents.push_back(event);
+        return;
+    }
+
     std::list<SegmentTrackerListenerInterface *>::const_iterator it;
     for(it=listeners.begin();it != listeners.end(); ++it)
         (*it)->trackerEvent(event);
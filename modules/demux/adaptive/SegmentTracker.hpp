@@ -118,6 +118,11 @@ namespace adaptive
             bool segmentsListReady() const;
             void reset();
             SegmentChunk* getNextChunk(bool, AbstractConnectionManager *);
+            /* Same as getNextChunk, but the events about the chunk are held
+             * back until it becomes current (see notifyPrefetchedChunk) */
+            SegmentChunk* prefetchNextChunk(bool, AbstractConnectionManager *);
+            void notifyPrefetchedChunk();
+            void dropPrefetchedChunk();
             bool setPositionByTime(mtime_t, bool, bool);
             void setPositionByNumber(uint64_t, bool);
             mtime_t getPlaybackTime() const; /* Current segment start time if selected */
@@ -130,6 +135,16 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk* fetchNextChunk(bool, AbstractConnectionManager *);
+            bool deferring;
+            mutable std::list<SegmentTrackerEvent> deferredEvents;
+            /* Position of the chunk being read while the next one is
+             * prefetched, as the tracker has already moved past it */
+            bool prefetched;
+            uint64_t playingNext;
+            uint64_t playingNumber;
+            BaseRepresentation *playingRepresentation;
+            BaseRepresentation * getPlayingRepresentation() const;
             bool first;
             bool initializing;
             bool index_sent;
@@ -43,6 +43,8 @@ AbstractStream::AbstractStream(demux_t * demux_)
     p_realdemux = demux_;
     format = StreamFormat::UNSUPPORTED;
     currentChunk = NULL;
+    prefetchedChunk = NULL;
+    prefetched = false;
     eof = false;
     dead = false;
     disabled = false;
@@ -102,6 +104,7 @@ bool AbstractStream::init(const StreamFormat &format_, SegmentTracker *tracker,
 AbstractStream::~AbstractStream()
 {
     delete currentChunk;
+    delete prefetchedChunk;
     if(segmentTracker)
         segmentTracker->notifyBufferingState(false);
     delete segmentTracker;
@@ -304,6 +307,7 @@ AbstractStream::buffering_status AbstractStream::doBufferize(mtime_t nz_deadline
     if(esCount() && !isSelected() && !fakeesout->restarting())
     {
         setDisabled(true);
+        dropPrefetchedChunk();
         segmentTracker->reset();
         commandsqueue->Abort(false);
         msg_Dbg(p_realdemux, "deactivating stream %s", format.str().c_str());
@@ -431,10 +435,49 @@ AbstractStream::status AbstractStream::dequeue(mtime_t nz_deadline, mtime_t *pi_
     return AbstractStream::status_buffering;
 }
 
+void AbstractStream::prefetchNextChunk()
+{
+    if(prefetched || eof || discontinuity || needrestart ||
+       fakeesout->restarting())
+        return;
+
+    /* Don't outrun live playlists */
+    if(segmentTracker->getMinAheadTime() == 0)
+        return;
+
+    /* Start the next download right away if starving, otherwise
+     * once the current segment has been downloaded */
+    if(last_buffer_status != AbstractStream::buffering_lessthanmin &&
+       currentChunk->isDownloading())
+        return;
+
+    /* Tracker events relate to the next chunk, not the one being read */
+    prefetchedChunk = segmentTracker->prefetchNextChunk(true, connManager);
+    prefetched = true;
+}
+
+void AbstractStream::dropPrefetchedChunk()
+{
+    delete prefetchedChunk;
+    prefetchedChunk = NULL;
+    prefetched = false;
+    segmentTracker->dropPrefetchedChunk();
+}
+
 block_t * AbstractStream::readNextBlock()
 {
     if (currentChunk == NULL && !eof)
-        currentChunk = segmentTracker->getNextChunk(!fakeesout->restarting(), connManager);
+    {
+        if(prefetched)
+        {
+            currentChunk = prefetchedChunk;
+            prefetchedChunk = NULL;
+            prefetched = false;
+            segmentTracker->notifyPrefetchedChunk();
+        }
+        else
+            currentChunk = segmentTracker->getNextChunk(!fakeesout->restarting(), connManager);
+    }
 
     if(discontinuity || needrestart)
     {
@@ -464,6 +507,10 @@ block_t * AbstractStream::readNextBlock()
         delete currentChunk;
         currentChunk = NULL;
     }
+    else
+    {
+        prefetchNextChunk();
+    }
 
     block = checkBlock(block, b_segment_head_chunk);
 
@@ -478,6 +525,7 @@ bool AbstractStream::setPosition(mtime_t time, bool tryonly)
     bool ret = segmentTracker->setPositionByTime(time, demuxer->needsRestartOnSeek(), tryonly);
     if(!tryonly && ret)
     {
+        dropPrefetchedChunk();
         if(demuxer->needsRestartOnSeek())
         {
             if(currentChunk)
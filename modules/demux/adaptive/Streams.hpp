@@ -118,6 +118,12 @@ namespace adaptive
 
         SegmentChunk *currentChunk;
         bool eof;
+
+        /* Next chunk, requested ahead while the current one is read */
+        void prefetchNextChunk();
+        void dropPrefetchedChunk();
+        SegmentChunk *prefetchedChunk;
+        bool prefetched;
         std::string language;
         std::string description;
 
@@ -59,6 +59,11 @@ const BytesRange & AbstractChunkSource::getBytesRange() const
     return bytesRange;
 }
 
+bool AbstractChunkSource::isDownloading() const
+{
+    return false;
+}
+
 AbstractChunk::AbstractChunk(AbstractChunkSource *source_)
 {
     bytesRead = 0;
@@ -106,6 +111,11 @@ bool AbstractChunk::isEmpty() const
     return !source->hasMoreData();
 }
 
+bool AbstractChunk::isDownloading() const
+{
+    return source && source->isDownloading();
+}
+
 block_t * AbstractChunk::readBlock()
 {
     return doRead(0, true);
@@ -133,7 +143,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
 HTTPChunkSource::~HTTPChunkSource()
 {
     if(connection)
-        connection->setUsed(false);
+        connManager->recycleConnection(connection);
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -348,6 +358,11 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     vlc_cond_signal(&avail);
 }
 
+bool HTTPChunkBufferedSource::isDownloading() const
+{
+    return !isDone();
+}
+
 bool HTTPChunkBufferedSource::prepare()
 {
     if(!prepared)
@@ -26,36 +26,42 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
 Downloader::Downloader()
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
 }
 
-bool Downloader::start()
+bool Downloader::start(unsigned count)
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < count)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
+    vlc_mutex_lock(&lock);
     killed = true;
-    vlc_cond_signal(&waitcond);
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+    for(size_t i = 0; i < threads.size(); i++)
+        vlc_join(threads[i], NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -69,6 +75,9 @@ void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     chunks.remove(source);
+    /* Source can't go away while a thread is still reading into it */
+    while(isRunning(source))
+        vlc_cond_wait(&updatedcond, &lock);
     vlc_mutex_unlock(&lock);
 }
 
@@ -87,31 +96,46 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+bool Downloader::isRunning(const HTTPChunkBufferedSource *source) const
 {
-    while(1)
+    return std::find(running.begin(), running.end(), source) != running.end();
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    /* Sources are served in scheduling order, so that the oldest segments,
+     * which are the first ones to be demuxed, get the first threads. */
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
     {
-        vlc_mutex_lock(&lock);
-        if(killed)
-            break;
+        if(!isRunning(*it))
+            return *it;
+    }
+    return NULL;
+}
 
-        while(chunks.empty() && !killed)
+void Downloader::Run()
+{
+    vlc_mutex_lock(&lock);
+    while(!killed)
+    {
+        HTTPChunkBufferedSource *source = getNextSource();
+        if(source == NULL)
         {
             vlc_cond_wait(&waitcond, &lock);
+            continue;
         }
 
-        if(killed)
-            break;
+        running.push_back(source);
+        vlc_mutex_unlock(&lock);
 
-        if(!chunks.empty())
-        {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-                chunks.pop_front();
-        }
+        DownloadSource(source);
 
-        vlc_mutex_unlock(&lock);
+        vlc_mutex_lock(&lock);
+        if(source->isDone())
+            chunks.remove(source);
+        running.remove(source);
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
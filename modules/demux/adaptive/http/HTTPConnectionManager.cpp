@@ -62,7 +62,13 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
 {
     vlc_mutex_init(&lock);
     downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    if(downloader)
+    {
+        /* Each thread uses its own connection: segments from different
+         * streams, or prefetched ones, are fetched concurrently */
+        int64_t i_threads = var_InheritInteger(p_object, "adaptive-downloads");
+        downloader->start(i_threads > 0 ? i_threads : 1);
+    }
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
@@ -138,6 +144,13 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
+void HTTPConnectionManager::recycleConnection(AbstractConnection *conn)
+{
+    vlc_mutex_lock(&lock);
+    conn->setUsed(false);
+    vlc_mutex_unlock(&lock);
+}
+
 void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
@@ -2615,6 +2615,80 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+#define AVI_INDEX_CACHE_NAME "avi"
+
+/* Rebuilds the track indexes from a previous scan of the same file */
+static int AVI_IndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    demux_index_entry_t *p_entries;
+    size_t i_count;
+
+    if( demux_IndexLoad( p_demux, AVI_INDEX_CACHE_NAME, &p_entries, &i_count ) )
+        return VLC_EGENERIC;
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        const demux_index_entry_t *p_entry = &p_entries[i];
+        if( p_entry->i_stream >= p_sys->i_track )
+        {
+            msg_Warn( p_demux, "discarding invalid cached index" );
+            for( unsigned j = 0; j < p_sys->i_track; j++ )
+            {
+                avi_index_Clean( &p_sys->track[j]->idx );
+                avi_index_Init( &p_sys->track[j]->idx );
+            }
+            free( p_entries );
+            return VLC_EGENERIC;
+        }
+
+        avi_entry_t index;
+        index.i_id      = 0;
+        index.i_flags   = p_entry->i_flags;
+        index.i_pos     = p_entry->i_offset;
+        index.i_length  = p_entry->i_size;
+        index.i_lengthtotal = p_entry->i_size;
+        avi_index_Append( &p_sys->track[p_entry->i_stream]->idx,
+                          &p_sys->i_movi_lastchunk_pos, &index );
+    }
+    free( p_entries );
+    return VLC_SUCCESS;
+}
+
+static void AVI_IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_count = 0;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_count += p_sys->track[i]->idx.i_size;
+    if( i_count == 0 )
+        return;
+
+    demux_index_entry_t *p_entries = malloc( i_count * sizeof( *p_entries ) );
+    if( !p_entries )
+        return;
+
+    /* AVI chunks have no timestamps: they follow from the chunk rank */
+    size_t i_entry = 0;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+        for( unsigned j = 0; j < p_index->i_size; j++ )
+        {
+            demux_index_entry_t *p_entry = &p_entries[i_entry++];
+            p_entry->i_time   = j;
+            p_entry->i_offset = p_index->p_entry[j].i_pos;
+            p_entry->i_size   = p_index->p_entry[j].i_length;
+            p_entry->i_stream = i;
+            p_entry->i_flags  = p_index->p_entry[j].i_flags;
+        }
+    }
+
+    demux_IndexSave( p_demux, AVI_INDEX_CACHE_NAME, p_entries, i_count );
+    free( p_entries );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2627,6 +2701,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2640,6 +2715,12 @@ static void AVI_IndexCreate( demux_t *p_demux )
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    if( AVI_IndexCacheLoad( p_demux ) == VLC_SUCCESS )
+    {
+        msg_Dbg( p_demux, "using cached index" );
+        goto print_entries;
+    }
+
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2665,7 +2746,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2739,6 +2823,11 @@ print_stat:
     if( p_dialog_id != NULL )
         vlc_dialog_release( p_demux, p_dialog_id );
 
+    /* A partial index would be reused as is on the next opening */
+    if( !b_cancelled )
+        AVI_IndexCacheSave( p_demux );
+
+print_entries:
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
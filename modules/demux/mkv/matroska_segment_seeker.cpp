@@ -47,6 +47,283 @@ namespace {
 
     template<class It> It prev_( It it ) { return --it; }
     template<class It> It next_( It it ) { return ++it; }
+
+    // seekpoints are stored as variable length deltas, the file position
+    // delta being combined with the trust level
+
+    void put_varint( std::vector<uint8_t>& buf, uint64_t value )
+    {
+        for( ; value >= 0x80; value >>= 7 )
+            buf.push_back( uint8_t( value | 0x80 ) );
+
+        buf.push_back( uint8_t( value ) );
+    }
+
+    uint64_t get_varint( uint8_t const*& p )
+    {
+        uint64_t value = 0;
+
+        for( unsigned shift = 0; ; shift += 7 )
+        {
+            uint8_t const byte = *p++;
+
+            value |= uint64_t( byte & 0x7f ) << shift;
+            if( !( byte & 0x80 ) )
+                return value;
+        }
+    }
+
+    uint64_t zigzag( int64_t value )   { return ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 ); }
+    int64_t  unzigzag( uint64_t value ) { return int64_t( value >> 1 ) ^ -int64_t( value & 1 ); }
+
+    unsigned trust_to_code( int trust_level )
+    {
+        switch( trust_level )
+        {
+            case SegmentSeeker::Seekpoint::TRUSTED:      return 2;
+            case SegmentSeeker::Seekpoint::QUESTIONABLE: return 1;
+            default:                                     return 0;
+        }
+    }
+
+    int code_to_trust( unsigned code )
+    {
+        switch( code )
+        {
+            case 2:  return SegmentSeeker::Seekpoint::TRUSTED;
+            case 1:  return SegmentSeeker::Seekpoint::QUESTIONABLE;
+            default: return SegmentSeeker::Seekpoint::DISABLED;
+        }
+    }
+
+    // sparse scan of files without cues: stop bisecting once the remaining
+    // area is small enough to be indexed linearly
+
+    SegmentSeeker::fptr_t const BISECT_SPAN = 1 << 22;
+    int const BISECT_MAX_PROBES = 32;
+}
+
+SegmentSeeker::SeekpointIndex::SeekpointIndex()
+    : _count( 0 ), _min_interval( 0 )
+{ }
+
+void
+SegmentSeeker::SeekpointIndex::decode( Block const& block, seekpoints_t& seekpoints )
+{
+    seekpoints.clear();
+
+    uint8_t const* p   = block.data.empty() ? NULL : &block.data[0];
+    uint8_t const* end = p + block.data.size();
+
+    fptr_t  fpos = 0;
+    mtime_t pts  = 0;
+
+    while( p < end )
+    {
+        pts += unzigzag( get_varint( p ) );
+
+        uint64_t const value = get_varint( p );
+        fpos += unzigzag( value >> 2 );
+
+        seekpoints.push_back( Seekpoint( code_to_trust( value & 3 ), fpos, pts ) );
+    }
+}
+
+void
+SegmentSeeker::SeekpointIndex::encode( Block& block, seekpoints_t const& seekpoints, size_t start, size_t end )
+{
+    std::vector<uint8_t> buf;
+
+    fptr_t  fpos = 0;
+    mtime_t pts  = 0;
+
+    for( size_t i = start; i < end; ++i )
+    {
+        Seekpoint const& sp = seekpoints[i];
+
+        put_varint( buf, zigzag( sp.pts - pts ) );
+        put_varint( buf, zigzag( int64_t( sp.fpos - fpos ) ) << 2 | trust_to_code( sp.trust_level ) );
+
+        fpos = sp.fpos;
+        pts  = sp.pts;
+    }
+
+    block.pts = seekpoints[start].pts;
+    block.data.assign( buf.begin(), buf.end() );
+}
+
+size_t
+SegmentSeeker::SeekpointIndex::find_block( mtime_t pts ) const
+{
+    // last block starting at or before pts, or the first one
+
+    size_t lo = 0, hi = _blocks.size();
+
+    while( lo < hi )
+    {
+        size_t const mid = lo + ( hi - lo ) / 2;
+
+        if( _blocks[mid].pts <= pts ) lo = mid + 1;
+        else                          hi = mid;
+    }
+
+    return lo ? lo - 1 : 0;
+}
+
+void
+SegmentSeeker::SeekpointIndex::insert( Seekpoint const& sp )
+{
+    if( _blocks.empty() )
+    {
+        _blocks.push_back( Block() );
+        encode( _blocks.back(), seekpoints_t( 1, sp ), 0, 1 );
+        _count = 1;
+        return;
+    }
+
+    size_t const block_idx = find_block( sp.pts );
+
+    seekpoints_t seekpoints;
+    decode( _blocks[block_idx], seekpoints );
+
+    seekpoints_t::iterator it = std::lower_bound( seekpoints.begin(), seekpoints.end(), sp );
+
+    if( it != seekpoints.end() && it->pts == sp.pts )
+    {
+        *it = sp;
+    }
+    else
+    {
+        // once thinned out, do not fill the gaps again
+
+        if( it != seekpoints.begin() &&
+            sp.pts - prev_( it )->pts < _min_interval &&
+            prev_( it )->trust_level >= sp.trust_level )
+            return;
+
+        seekpoints.insert( it, sp );
+        _count++;
+    }
+
+    if( seekpoints.size() > 2 * BLOCK_SIZE )
+    {
+        Block block;
+
+        encode( block, seekpoints, BLOCK_SIZE, seekpoints.size() );
+        encode( _blocks[block_idx], seekpoints, 0, BLOCK_SIZE );
+        _blocks.insert( _blocks.begin() + block_idx + 1, block );
+    }
+    else
+    {
+        encode( _blocks[block_idx], seekpoints, 0, seekpoints.size() );
+    }
+
+    if( _count > MAX_SEEKPOINTS )
+        thin_out();
+}
+
+void
+SegmentSeeker::SeekpointIndex::thin_out()
+{
+    seekpoints_t seekpoints, block_seekpoints;
+
+    for( blocks_t::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it )
+    {
+        decode( *it, block_seekpoints );
+        seekpoints.insert( seekpoints.end(), block_seekpoints.begin(), block_seekpoints.end() );
+    }
+
+    do
+    {
+        _min_interval = _min_interval ? 2 * _min_interval : CLOCK_FREQ / 10;
+
+        seekpoints_t kept;
+
+        for( seekpoints_t::const_iterator it = seekpoints.begin(); it != seekpoints.end(); ++it )
+        {
+            if( kept.empty() ||
+                it->pts - kept.back().pts >= _min_interval ||
+                it->trust_level > kept.back().trust_level )
+                kept.push_back( *it );
+        }
+
+        seekpoints.swap( kept );
+    }
+    while( seekpoints.size() > MAX_SEEKPOINTS / 2 );
+
+    _blocks.clear();
+
+    for( size_t i = 0; i < seekpoints.size(); i += BLOCK_SIZE )
+    {
+        _blocks.push_back( Block() );
+        encode( _blocks.back(), seekpoints, i, std::min( i + BLOCK_SIZE, seekpoints.size() ) );
+    }
+
+    _count = seekpoints.size();
+}
+
+SegmentSeeker::seekpoint_pair_t
+SegmentSeeker::SeekpointIndex::get_around( mtime_t pts, int trust_level ) const
+{
+    if( _blocks.empty() )
+    {
+        return seekpoint_pair_t();
+    }
+
+    size_t const block_idx = find_block( pts );
+
+    seekpoints_t seekpoints;
+    decode( _blocks[block_idx], seekpoints );
+
+    Seekpoint const needle ( Seekpoint::DISABLED, -1, pts );
+
+    size_t const middle = greatest_lower_bound( seekpoints.begin(), seekpoints.end(), needle ) - seekpoints.begin();
+
+    Seekpoint before;
+
+    { // rewind to _previous_ seekpoint with appropriate trust, or the first one
+
+        seekpoints_t block_seekpoints = seekpoints;
+        size_t idx = block_idx;
+        size_t i   = middle + 1;
+
+        for( ;; )
+        {
+            while( i > 0 && block_seekpoints[i - 1].trust_level < trust_level )
+                --i;
+
+            if( i > 0 || idx == 0 )
+                break;
+
+            decode( _blocks[--idx], block_seekpoints );
+            i = block_seekpoints.size();
+        }
+
+        before = block_seekpoints[ i ? i - 1 : 0 ];
+    }
+
+    { // forward to following seekpoint with appropriate trust
+
+        size_t idx = block_idx;
+        size_t i   = middle + 1;
+
+        for( ;; )
+        {
+            for( ; i < seekpoints.size(); ++i )
+            {
+                if( seekpoints[i].trust_level >= trust_level )
+                    return seekpoint_pair_t( before, seekpoints[i] );
+            }
+
+            if( ++idx >= _blocks.size() )
+                break;
+
+            decode( _blocks[idx], seekpoints );
+            i = 0;
+        }
+    }
+
+    return seekpoint_pair_t( before, Seekpoint() );
 }
 
 SegmentSeeker::cluster_positions_t::iterator
@@ -61,7 +338,7 @@ SegmentSeeker::add_cluster_position( fptr_t fpos )
     return _cluster_positions.insert( insertion_point, fpos );
 }
 
-SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::clusters_t::iterator
 SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 {
     Cluster cinfo = {
@@ -75,15 +352,15 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 
     add_cluster_position( cinfo.fpos );
 
-    cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
+    clusters_t::iterator it = std::lower_bound( _clusters.begin(), _clusters.end(), cinfo );
 
-    if( it != _clusters.end() && it->second.pts == cinfo.pts )
+    if( it != _clusters.end() && it->pts == cinfo.pts )
     {
         // cluster already known
     }
     else
     {
-        it = _clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) ).first;
+        it = _clusters.insert( it, cinfo );
     }
 
     // ------------------------------------------------------------------
@@ -100,12 +377,12 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 
     if( it != _clusters.begin() )
     {
-        Duration::fix( prev_( it )->second, it->second );
+        Duration::fix( *prev_( it ), *it );
     }
 
     if( it != _clusters.end() && next_( it ) != _clusters.end() )
     {
-        Duration::fix( it->second, next_( it )->second );
+        Duration::fix( *it, *next_( it ) );
     }
 
     return it;
@@ -114,19 +391,7 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 void
 SegmentSeeker::add_seekpoint( track_id_t track_id, int trust_level, fptr_t fpos, mtime_t pts )
 {
-    Seekpoint sp ( trust_level, fpos, pts );
-
-    seekpoints_t&  seekpoints = _tracks_seekpoints[ track_id ];
-    seekpoints_t::iterator it = std::lower_bound( seekpoints.begin(), seekpoints.end(), sp );
-
-    if( it != seekpoints.end() && it->pts == sp.pts )
-    {
-        *it = sp;
-    }
-    else
-    {
-        seekpoints.insert( it, sp );
-    }
+    _tracks_seekpoints[ track_id ].insert( Seekpoint( trust_level, fpos, pts ) );
 }
 
 SegmentSeeker::tracks_seekpoint_t
@@ -153,39 +418,7 @@ SegmentSeeker::find_greatest_seekpoints_in_range( fptr_t start_fpos, mtime_t end
 SegmentSeeker::seekpoint_pair_t
 SegmentSeeker::get_seekpoints_around( mtime_t pts, seekpoints_t const& seekpoints, int trust_level )
 {
-    if( seekpoints.empty() )
-    {
-        return seekpoint_pair_t();
-    }
-
-    typedef seekpoints_t::const_iterator iterator;
-
-    Seekpoint const needle ( Seekpoint::DISABLED, -1, pts );
-
-    iterator const it_begin  = seekpoints.begin();
-    iterator const it_end    = seekpoints.end();
-    iterator const it_middle = greatest_lower_bound( it_begin, it_end, needle );
-
-    iterator it_before;
-    iterator it_after;
-
-    // rewrind to _previous_ seekpoint with appropriate trust
-    for( it_before = it_middle; it_before != it_begin; --it_before )
-    {
-        if( it_before->trust_level >= trust_level )
-            break;
-    }
-
-    // forward to following seekpoint with appropriate trust
-    for( it_after = next_( it_middle ); it_after != it_end; ++it_after )
-    {
-        if( it_after->trust_level >= trust_level )
-            break;
-    }
-
-    return seekpoint_pair_t( *it_before,
-      it_after == it_end ? Seekpoint() : *it_after
-    );
+    return seekpoints.get_around( pts, trust_level );
 }
 
 SegmentSeeker::seekpoint_pair_t
@@ -222,11 +455,13 @@ SegmentSeeker::get_seekpoints_around( mtime_t target_pts, track_ids_t const& pri
 
     { // check if we got a cluster which is closer to target_pts than the found cues //
 
-        cluster_map_t::iterator it = _clusters.lower_bound( target_pts );
+        Cluster const needle = { 0, target_pts, -1, 0 };
 
-        if( it != _clusters.begin() && --it != _clusters.end() )
+        clusters_t::iterator it = std::lower_bound( _clusters.begin(), _clusters.end(), needle );
+
+        if( it != _clusters.begin() )
         {
-            Cluster const& cluster = it->second;
+            Cluster const& cluster = *--it;
 
             if( cluster.fpos > points.first.fpos )
             {
@@ -264,6 +499,9 @@ SegmentSeeker::get_seekpoints( matroska_segment_c& ms, mtime_t target_pts, track
 
     for( mtime_t needle_pts = target_pts; ; )
     {
+        if( !ms.b_cues )
+            bisect_clusters( ms, needle_pts );
+
         seekpoint_pair_t seekpoints = get_seekpoints_around( needle_pts, priority_tracks );
 
         Seekpoint const& start = seekpoints.first;
@@ -284,6 +522,80 @@ SegmentSeeker::get_seekpoints( matroska_segment_c& ms, mtime_t target_pts, track
     vlc_assert_unreachable();
 }
 
+bool
+SegmentSeeker::probe_cluster( matroska_segment_c& ms, fptr_t start, fptr_t end, Cluster& cluster )
+{
+    ms.es.I_O().setFilePointer( start );
+
+    // the parser resynchronizes on the next known element of the segment
+
+    EbmlParser eparser ( &ms.es, ms.segment, &ms.sys.demuxer, false );
+
+    while( EbmlElement * el = eparser.Get() )
+    {
+        if( el->GetElementPosition() >= end )
+            break;
+
+        MKV_CHECKED_PTR_DECL( p_cluster, KaxCluster, el );
+
+        if( p_cluster == NULL )
+            continue;
+
+        eparser.Down();
+
+        while( EbmlElement * child = eparser.Get() )
+        {
+            if( MKV_CHECKED_PTR_DECL( p_tc, KaxClusterTimecode, child ) )
+            {
+                p_tc->ReadData( ms.es.I_O(), SCOPE_ALL_DATA );
+                p_cluster->InitTimecode( static_cast<uint64>( *p_tc ), ms.i_timescale );
+
+                cluster = *add_cluster( p_cluster );
+                return true;
+            }
+        }
+
+        break;
+    }
+
+    return false;
+}
+
+void
+SegmentSeeker::bisect_clusters( matroska_segment_c& ms, mtime_t target_pts )
+{
+    Cluster const needle = { 0, target_pts, -1, 0 };
+
+    clusters_t::const_iterator it = std::upper_bound( _clusters.begin(), _clusters.end(), needle );
+
+    if( it == _clusters.begin() )
+        return;
+
+    fptr_t lo = prev_( it )->fpos;
+    fptr_t hi;
+
+    if( it != _clusters.end() )
+        hi = it->fpos;
+    else if( ms.segment->IsFiniteSize() )
+        hi = ms.segment->GetEndPosition();
+    else
+        hi = stream_Size( ms.sys.demuxer.s );
+
+    for( int i = 0; i < BISECT_MAX_PROBES && lo < hi && hi - lo > BISECT_SPAN; ++i )
+    {
+        fptr_t const mid = lo + ( hi - lo ) / 2;
+
+        Cluster cluster;
+
+        if( !probe_cluster( ms, mid, hi, cluster ) )
+            hi = mid;
+        else if( cluster.pts <= target_pts )
+            lo = cluster.fpos;
+        else
+            hi = cluster.fpos;
+    }
+}
+
 void
 SegmentSeeker::index_range( matroska_segment_c& ms, Range search_area, mtime_t max_pts )
 {
@@ -83,19 +83,61 @@ class SegmentSeeker
             mtime_t pts;
             mtime_t duration;
             fptr_t  size;
+
+            bool operator<( Cluster const& rhs ) const
+            {
+                return pts < rhs.pts;
+            }
+        };
+
+        typedef std::pair<Seekpoint, Seekpoint> seekpoint_pair_t;
+
+        /* Seekpoints of a track sorted by pts, delta encoded by blocks.
+         * Once it holds MAX_SEEKPOINTS entries, it is thinned out by
+         * doubling the minimal interval between two seekpoints. */
+        class SeekpointIndex
+        {
+            public:
+                static size_t const BLOCK_SIZE = 64;
+                static size_t const MAX_SEEKPOINTS = 1 << 17;
+
+                SeekpointIndex();
+
+                void insert( Seekpoint const& );
+                seekpoint_pair_t get_around( mtime_t, int trust_level ) const;
+
+                bool   empty() const { return _count == 0; }
+                size_t size() const  { return _count; }
+
+            private:
+                struct Block
+                {
+                    mtime_t              pts; /* of the first seekpoint */
+                    std::vector<uint8_t> data;
+                };
+                typedef std::vector<Block> blocks_t;
+                typedef std::vector<Seekpoint> seekpoints_t;
+
+                static void decode( Block const&, seekpoints_t& );
+                static void encode( Block&, seekpoints_t const&, size_t start, size_t end );
+
+                size_t find_block( mtime_t ) const;
+                void thin_out();
+
+                blocks_t _blocks;
+                size_t   _count;
+                mtime_t  _min_interval;
         };
 
     public:
         typedef std::vector<track_id_t> track_ids_t;
         typedef std::vector<Range> ranges_t;
-        typedef std::vector<Seekpoint> seekpoints_t;
+        typedef SeekpointIndex seekpoints_t;
         typedef std::vector<fptr_t> cluster_positions_t;
 
         typedef std::map<track_id_t, Seekpoint> tracks_seekpoint_t;
         typedef std::map<track_id_t, seekpoints_t> tracks_seekpoints_t;
-        typedef std::map<mtime_t, Cluster> cluster_map_t;
-
-        typedef std::pair<Seekpoint, Seekpoint> seekpoint_pair_t;
+        typedef std::vector<Cluster> clusters_t;
 
         void add_seekpoint( track_id_t track_id, int level, fptr_t fpos, mtime_t pts );
 
@@ -106,7 +148,10 @@ class SegmentSeeker
         tracks_seekpoint_t find_greatest_seekpoints_in_range( fptr_t , mtime_t );
 
         cluster_positions_t::iterator add_cluster_position( fptr_t pos );
-        cluster_map_t      ::iterator add_cluster( KaxCluster * const );
+        clusters_t         ::iterator add_cluster( KaxCluster * const );
+
+        bool probe_cluster( matroska_segment_c&, fptr_t start, fptr_t end, Cluster& );
+        void bisect_clusters( matroska_segment_c&, mtime_t target_pts );
 
         void mkv_jump_to( matroska_segment_c&, fptr_t );
 
@@ -120,7 +165,7 @@ class SegmentSeeker
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
         cluster_positions_t _cluster_positions;
-        cluster_map_t       _clusters;
+        clusters_t          _clusters;
 };
 
 #endif /* include-guard */
@@ -176,9 +176,16 @@ struct demux_sys_t
     {
         subtitle_t *p_array;
         size_t      i_count;
+        size_t      i_max;
         size_t      i_current;
+        bool        b_sorted; /* by start time */
     } subtitles;
 
+    /* Cues are parsed on demand from the loaded lines */
+    text_t      txt;
+    int       (*pf_read)( vlc_object_t *, subs_properties_t *, text_t *, subtitle_t*, size_t );
+    bool        b_parsed;
+
     int64_t     i_length;
 
     /* */
@@ -243,6 +250,9 @@ static int Control( demux_t *, int, va_list );
 static void Fix( demux_t * );
 static char * get_language_from_filename( const char * );
 
+static void ParseAll( demux_t * );
+static void ParseUntil( demux_t *, int64_t );
+
 /*****************************************************************************
  * Module initializer
  *****************************************************************************/
@@ -253,7 +263,6 @@ static int Open ( vlc_object_t *p_this )
     es_format_t    fmt;
     float          f_fps;
     char           *psz_type;
-    int  (*pf_read)( vlc_object_t *, subs_properties_t *, text_t *, subtitle_t*, size_t );
     int            i;
 
     if( !p_demux->obj.force )
@@ -274,7 +283,15 @@ static int Open ( vlc_object_t *p_this )
 
     p_sys->subtitles.i_current= 0;
     p_sys->subtitles.i_count  = 0;
+    p_sys->subtitles.i_max    = 0;
     p_sys->subtitles.p_array  = NULL;
+    p_sys->subtitles.b_sorted = true;
+
+    p_sys->txt.i_line_count = 0;
+    p_sys->txt.i_line       = 0;
+    p_sys->txt.line         = NULL;
+    p_sys->b_parsed         = false;
+    p_sys->i_length         = 0;
 
     p_sys->props.psz_header         = NULL;
     p_sys->props.i_microsecperframe = 40000;
@@ -518,12 +535,12 @@ static int Open ( vlc_object_t *p_this )
         {
             msg_Dbg( p_demux, "detected %s format",
                      sub_read_subtitle_function[i].psz_name );
-            pf_read = sub_read_subtitle_function[i].pf_read;
+            p_sys->pf_read = sub_read_subtitle_function[i].pf_read;
             break;
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
+    msg_Dbg( p_demux, "loading subtitles..." );
 
     if( unicode && /* skip BOM */
         vlc_stream_Seek( p_demux->s, 3 ) != VLC_SUCCESS )
@@ -532,49 +549,16 @@ static int Open ( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
-    /* Load the whole file */
-    text_t txtlines;
-    TextLoad( &txtlines, p_demux->s );
-
-    /* Parse it */
-    for( size_t i_max = 0; i_max < SIZE_MAX - 500 * sizeof(subtitle_t); )
-    {
-        if( p_sys->subtitles.i_count >= i_max )
-        {
-            i_max += 500;
-            subtitle_t *p_realloc = realloc( p_sys->subtitles.p_array, sizeof(subtitle_t) * i_max );
-            if( p_realloc == NULL )
-            {
-                TextUnload( &txtlines );
-                Close( p_this );
-                return VLC_ENOMEM;
-            }
-            p_sys->subtitles.p_array = p_realloc;
-        }
-
-        if( pf_read( VLC_OBJECT(p_demux), &p_sys->props, &txtlines,
-                     &p_sys->subtitles.p_array[p_sys->subtitles.i_count],
-                     p_sys->subtitles.i_count ) )
-            break;
-
-        p_sys->subtitles.i_count++;
-    }
-    /* Unload */
-    TextUnload( &txtlines );
-
-    msg_Dbg(p_demux, "loaded %zu subtitles", p_sys->subtitles.i_count );
-
-    /* Fix subtitle (order and time) *** */
-    p_sys->subtitles.i_current = 0;
-    p_sys->i_length = 0;
-    if( p_sys->subtitles.i_count > 0 )
-        p_sys->i_length = p_sys->subtitles.p_array[p_sys->subtitles.i_count-1].i_stop;
+    /* Load the whole file, cues are parsed as playback goes */
+    TextLoad( &p_sys->txt, p_demux->s );
 
     /* *** add subtitle ES *** */
     if( p_sys->props.i_type == SUB_TYPE_SSA1 ||
              p_sys->props.i_type == SUB_TYPE_SSA2_4 ||
              p_sys->props.i_type == SUB_TYPE_ASS )
     {
+        /* Events are not necessarily in order */
+        ParseAll( p_demux );
         Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
     }
@@ -627,6 +611,7 @@ static void Close( vlc_object_t *p_this )
         free( p_sys->subtitles.p_array[i].psz_text );
     free( p_sys->subtitles.p_array );
     free( p_sys->props.psz_header );
+    TextUnload( &p_sys->txt );
 
     free( p_sys );
 }
@@ -648,6 +633,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_LENGTH:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            ParseAll( p_demux );
             *pi64 = p_sys->i_length;
             return VLC_SUCCESS;
 
@@ -659,21 +645,47 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return VLC_SUCCESS;
 
         case DEMUX_SET_TIME:
+        {
             i64 = (int64_t)va_arg( args, int64_t );
-            for( size_t i = 0; i + 1< p_sys->subtitles.i_count; i++ )
+            ParseUntil( p_demux, i64 );
+
+            /* Resume from the cue preceding the first one starting after
+             * the new time */
+            size_t i_first;
+            const subtitle_t *p_array = p_sys->subtitles.p_array;
+            if( p_sys->subtitles.b_sorted )
             {
-                if( p_sys->subtitles.p_array[i + 1].i_start >= i64 )
+                size_t i_low = 1, i_high = p_sys->subtitles.i_count;
+                while( i_low < i_high )
                 {
-                    p_sys->subtitles.i_current = i;
-                    p_sys->i_next_demux_date = i64;
-                    p_sys->b_first_time = true;
-                    return VLC_SUCCESS;
+                    size_t i_mid = i_low + (i_high - i_low) / 2;
+                    if( p_array[i_mid].i_start < i64 )
+                        i_low = i_mid + 1;
+                    else
+                        i_high = i_mid;
                 }
+                i_first = i_low;
+            }
+            else
+            {
+                for( i_first = 1; i_first < p_sys->subtitles.i_count; i_first++ )
+                    if( p_array[i_first].i_start >= i64 )
+                        break;
+            }
+
+            if( i_first < p_sys->subtitles.i_count )
+            {
+                p_sys->subtitles.i_current = i_first - 1;
+                p_sys->i_next_demux_date = i64;
+                p_sys->b_first_time = true;
+                return VLC_SUCCESS;
             }
             break;
+        }
 
         case DEMUX_GET_POSITION:
             pf = (double*)va_arg( args, double * );
+            ParseAll( p_demux );
             if( p_sys->subtitles.i_current >= p_sys->subtitles.i_count )
             {
                 *pf = 1.0;
@@ -693,6 +705,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_POSITION:
             f = (double)va_arg( args, double );
+            ParseAll( p_demux );
             if( p_sys->subtitles.i_count && p_sys->i_length )
             {
                 i64 = VLC_TS_0 + f * p_sys->i_length;
@@ -730,6 +743,8 @@ static int Demux( demux_t *p_demux )
     if( i_barrier < 0 )
         i_barrier = p_sys->i_next_demux_date;
 
+    ParseUntil( p_demux, i_barrier );
+
     while( p_sys->subtitles.i_current < p_sys->subtitles.i_count &&
            p_sys->subtitles.p_array[p_sys->subtitles.i_current].i_start <= i_barrier )
     {
@@ -774,12 +789,89 @@ static int Demux( demux_t *p_demux )
         p_sys->i_next_demux_date += CLOCK_FREQ / 8;
     }
 
-    if( p_sys->subtitles.i_current >= p_sys->subtitles.i_count )
+    if( p_sys->subtitles.i_current >= p_sys->subtitles.i_count &&
+        p_sys->b_parsed )
         return VLC_DEMUXER_EOF;
 
     return VLC_DEMUXER_SUCCESS;
 }
 
+/*****************************************************************************
+ * Incremental parsing
+ *****************************************************************************/
+/* Cues are parsed this far ahead of the requested time */
+#define SUB_PARSE_AHEAD (CLOCK_FREQ * 60)
+
+static void ParseEnd( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    TextUnload( &p_sys->txt );
+    p_sys->b_parsed = true;
+    msg_Dbg( p_demux, "loaded %zu subtitles", p_sys->subtitles.i_count );
+}
+
+static int ParseNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->b_parsed )
+        return VLC_EGENERIC;
+
+    if( p_sys->subtitles.i_count >= p_sys->subtitles.i_max )
+    {
+        size_t i_max = __MAX( 500, p_sys->subtitles.i_max * 2 );
+        subtitle_t *p_realloc = NULL;
+
+        if( i_max < SIZE_MAX / sizeof(subtitle_t) )
+            p_realloc = realloc( p_sys->subtitles.p_array,
+                                 sizeof(subtitle_t) * i_max );
+        if( p_realloc == NULL )
+        {
+            ParseEnd( p_demux );
+            return VLC_ENOMEM;
+        }
+        p_sys->subtitles.p_array = p_realloc;
+        p_sys->subtitles.i_max = i_max;
+    }
+
+    subtitle_t *p_subtitle = &p_sys->subtitles.p_array[p_sys->subtitles.i_count];
+    if( p_sys->pf_read( VLC_OBJECT(p_demux), &p_sys->props, &p_sys->txt,
+                        p_subtitle, p_sys->subtitles.i_count ) )
+    {
+        ParseEnd( p_demux );
+        return VLC_EGENERIC;
+    }
+
+    if( p_sys->subtitles.i_count > 0 &&
+        p_subtitle->i_start < p_subtitle[-1].i_start )
+        p_sys->subtitles.b_sorted = false;
+    if( p_subtitle->i_stop > p_sys->i_length )
+        p_sys->i_length = p_subtitle->i_stop;
+
+    p_sys->subtitles.i_count++;
+    return VLC_SUCCESS;
+}
+
+/* Parses the cues starting up to the parse ahead window after a time */
+static void ParseUntil( demux_t *p_demux, int64_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( p_sys->subtitles.i_count == 0 ||
+           p_sys->subtitles.p_array[p_sys->subtitles.i_count - 1].i_start
+               <= i_time + SUB_PARSE_AHEAD )
+    {
+        if( ParseNext( p_demux ) )
+            break;
+    }
+}
+
+static void ParseAll( demux_t *p_demux )
+{
+    while( ParseNext( p_demux ) == VLC_SUCCESS );
+}
+
 
 static int subtitle_cmp( const void *first, const void *second )
 {
@@ -797,6 +889,7 @@ static void Fix( demux_t *p_demux )
 
     /* *** fix order (to be sure...) *** */
     qsort( p_sys->subtitles.p_array, p_sys->subtitles.i_count, sizeof( p_sys->subtitles.p_array[0] ), subtitle_cmp);
+    p_sys->subtitles.b_sorted = true;
 }
 
 static int TextLoad( text_t *txt, stream_t *s )
@@ -834,6 +927,7 @@ static int TextLoad( text_t *txt, stream_t *s )
     if( txt->i_line_count == 0 )
     {
         free( txt->line );
+        txt->line = NULL;
         return VLC_EGENERIC;
     }
 
@@ -846,6 +940,7 @@ static void TextUnload( text_t *txt )
         free( txt->line[i] );
     }
     free( txt->line );
+    txt->line         = NULL;
     txt->i_line       = 0;
     txt->i_line_count = 0;
 }
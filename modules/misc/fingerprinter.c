@@ -42,23 +42,32 @@
 
 struct fingerprinter_sys_t
 {
-    vlc_thread_t thread;
+    vlc_thread_t *p_threads;
+    unsigned i_threads;
+    unsigned i_length;          /* seconds of audio to fingerprint */
 
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
-    } incoming, results;
+    } results;
 
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
         vlc_cond_t          cond;
-        bool                b_working;
     } processing;
 };
 
+/* State of one fingerprinting input */
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  cond;
+    bool        b_working;
+} fingerprint_input_t;
+
 static int  Open            (vlc_object_t *);
 static void Close           (vlc_object_t *);
 static void CleanSys        (fingerprinter_sys_t *);
@@ -67,12 +76,23 @@ static void *Run(void *);
 /*****************************************************************************
  * Module descriptor
  ****************************************************************************/
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of tracks fingerprinted in parallel " \
+                            "(0 means one per CPU).")
+#define LENGTH_TEXT N_("Fingerprinted length")
+#define LENGTH_LONGTEXT N_("Only this many seconds from the beginning of " \
+                           "each track are decoded and fingerprinted.")
+
 vlc_module_begin ()
     set_category(CAT_ADVANCED)
     set_subcategory(SUBCAT_ADVANCED_MISC)
     set_shortname(N_("acoustid"))
     set_description(N_("Track fingerprinter (based on Acoustid)"))
     set_capability("fingerprinter", 10)
+    add_integer_with_range("fingerprinter-threads", 0, 0, 64,
+                           THREADS_TEXT, THREADS_LONGTEXT, true)
+    add_integer_with_range("fingerprinter-length", 90, 10, 600,
+                           LENGTH_TEXT, LENGTH_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end ()
 
@@ -83,21 +103,10 @@ vlc_module_end ()
 static void EnqueueRequest( fingerprinter_thread_t *f, fingerprint_request_t *r )
 {
     fingerprinter_sys_t *p_sys = f->p_sys;
-    vlc_mutex_lock( &p_sys->incoming.lock );
-    vlc_array_append( &p_sys->incoming.queue, r );
-    vlc_mutex_unlock( &p_sys->incoming.lock );
-}
-
-static void QueueIncomingRequests( fingerprinter_sys_t *p_sys )
-{
-    vlc_mutex_lock( &p_sys->incoming.lock );
-    size_t i = vlc_array_count( &p_sys->incoming.queue );
-
-    while( i )
-        vlc_array_append( &p_sys->processing.queue,
-                          vlc_array_item_at_index( &p_sys->incoming.queue, --i ) );
-    vlc_array_clear( &p_sys->incoming.queue );
-    vlc_mutex_unlock(&p_sys->incoming.lock);
+    vlc_mutex_lock( &p_sys->processing.lock );
+    vlc_array_append( &p_sys->processing.queue, r );
+    vlc_cond_signal( &p_sys->processing.cond );
+    vlc_mutex_unlock( &p_sys->processing.lock );
 }
 
 static fingerprint_request_t * GetResult( fingerprinter_thread_t *f )
@@ -133,15 +142,15 @@ static int InputEventHandler( vlc_object_t *p_this, char const *psz_cmd,
     VLC_UNUSED( psz_cmd );
     VLC_UNUSED( oldval );
     input_thread_t *p_input = (input_thread_t *) p_this;
-    fingerprinter_sys_t *p_sys = (fingerprinter_sys_t *) p_data;
+    fingerprint_input_t *p_fi = (fingerprint_input_t *) p_data;
     if( newval.i_int == INPUT_EVENT_STATE )
     {
         if( var_GetInteger( p_input, "state" ) >= PAUSE_S )
         {
-            vlc_mutex_lock( &p_sys->processing.lock );
-            p_sys->processing.b_working = false;
-            vlc_cond_signal( &p_sys->processing.cond );
-            vlc_mutex_unlock( &p_sys->processing.lock );
+            vlc_mutex_lock( &p_fi->lock );
+            p_fi->b_working = false;
+            vlc_cond_signal( &p_fi->cond );
+            vlc_mutex_unlock( &p_fi->lock );
         }
     }
     return VLC_SUCCESS;
@@ -155,11 +164,14 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
     if ( unlikely(p_item == NULL) )
          return;
 
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
     char *psz_sout_option;
-    /* Note: need at -max- 2 channels, but we can't guess it before playing */
-    /* the stereo upmix could make the mono tracks fingerprint to differ :/ */
+    /* Convert to the format chromaprint works on (mono, 11025 Hz), so that
+     * it does not resample, and so that every track is downmixed the same
+     * way whatever its channels */
     if ( asprintf( &psz_sout_option,
-                   "sout=#transcode{acodec=%s,channels=2}:chromaprint",
+                   "sout=#transcode{acodec=%s,channels=1,samplerate=11025}"
+                   ":chromaprint",
                    ( VLC_CODEC_S16L == VLC_CODEC_S16N ) ? "s16l" : "s16b" )
          == -1 )
     {
@@ -169,18 +181,29 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
 
     input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
     free( psz_sout_option );
-    input_item_AddOption( p_item, "vout=dummy", VLC_INPUT_OPTION_TRUSTED );
+    input_item_AddOption( p_item, "no-video", VLC_INPUT_OPTION_TRUSTED );
+    input_item_AddOption( p_item, "no-spu", VLC_INPUT_OPTION_TRUSTED );
     input_item_AddOption( p_item, "aout=dummy", VLC_INPUT_OPTION_TRUSTED );
-    if ( fp->i_duration )
+    if ( asprintf( &psz_sout_option, "duration=%u", p_sys->i_length ) == -1 )
     {
-        if ( asprintf( &psz_sout_option, "stop-time=%u", fp->i_duration ) == -1 )
-        {
-            input_item_Release( p_item );
-            return;
-        }
-        input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
-        free( psz_sout_option );
+        input_item_Release( p_item );
+        return;
+    }
+    input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
+    free( psz_sout_option );
+
+    /* Only decode what is fingerprinted (with some margin for the
+     * decoder and converters delays), not the whole track */
+    unsigned i_stop = p_sys->i_length + 2;
+    if ( fp->i_duration && fp->i_duration < i_stop )
+        i_stop = fp->i_duration;
+    if ( asprintf( &psz_sout_option, "stop-time=%u", i_stop ) == -1 )
+    {
+        input_item_Release( p_item );
+        return;
     }
+    input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
+    free( psz_sout_option );
     input_item_SetURI( p_item, psz_uri ) ;
 
     input_thread_t *p_input = input_Create( p_fingerprinter, p_item, "fingerprinter", NULL );
@@ -190,36 +213,49 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
         return;
 
     chromaprint_fingerprint_t chroma_fingerprint;
+    fingerprint_input_t fi;
 
     chroma_fingerprint.psz_fingerprint = NULL;
     chroma_fingerprint.i_duration = fp->i_duration;
 
+    vlc_mutex_init( &fi.lock );
+    vlc_cond_init( &fi.cond );
+    fi.b_working = true;
+
     var_Create( p_input, "fingerprint-data", VLC_VAR_ADDRESS );
     var_SetAddress( p_input, "fingerprint-data", &chroma_fingerprint );
 
-    var_AddCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+    var_AddCallback( p_input, "intf-event", InputEventHandler, &fi );
 
     if( input_Start( p_input ) != VLC_SUCCESS )
     {
-        var_DelCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+        var_DelCallback( p_input, "intf-event", InputEventHandler, &fi );
         input_Close( p_input );
     }
     else
     {
-        p_fingerprinter->p_sys->processing.b_working = true;
-        while( p_fingerprinter->p_sys->processing.b_working )
-        {
-            vlc_cond_wait( &p_fingerprinter->p_sys->processing.cond,
-                           &p_fingerprinter->p_sys->processing.lock );
-        }
-        var_DelCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+        vlc_mutex_lock( &fi.lock );
+        while( fi.b_working )
+            vlc_cond_wait( &fi.cond, &fi.lock );
+        vlc_mutex_unlock( &fi.lock );
+
+        var_DelCallback( p_input, "intf-event", InputEventHandler, &fi );
+
+        /* The whole track was not decoded: get its length from the demuxer */
+        mtime_t i_length = input_item_GetDuration( input_GetItem( p_input ) );
+
         input_Stop( p_input );
         input_Close( p_input );
 
         fp->psz_fingerprint = chroma_fingerprint.psz_fingerprint;
-        if( !fp->i_duration ) /* had not given hint */
-            fp->i_duration = chroma_fingerprint.i_duration;
+        /* Without a hint nor a length from the demuxer, the length stays
+         * unknown: the decoded one stops at the fingerprinted length */
+        if( !fp->i_duration && i_length > 0 ) /* had not given hint */
+            fp->i_duration = i_length / CLOCK_FREQ;
     }
+
+    vlc_cond_destroy( &fi.cond );
+    vlc_mutex_destroy( &fi.lock );
 }
 
 /*****************************************************************************
@@ -235,9 +271,6 @@ static int Open(vlc_object_t *p_this)
 
     p_fingerprinter->p_sys = p_sys;
 
-    vlc_array_init( &p_sys->incoming.queue );
-    vlc_mutex_init( &p_sys->incoming.lock );
-
     vlc_array_init( &p_sys->processing.queue );
     vlc_mutex_init( &p_sys->processing.lock );
     vlc_cond_init( &p_sys->processing.cond );
@@ -250,12 +283,30 @@ static int Open(vlc_object_t *p_this)
     p_fingerprinter->pf_apply = ApplyResult;
 
     var_Create( p_fingerprinter, "results-available", VLC_VAR_BOOL );
-    if( vlc_clone( &p_sys->thread, Run, p_fingerprinter,
-                   VLC_THREAD_PRIORITY_LOW ) )
+
+    p_sys->i_length = var_InheritInteger( p_fingerprinter,
+                                          "fingerprinter-length" );
+    unsigned i_threads = var_InheritInteger( p_fingerprinter,
+                                             "fingerprinter-threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+
+    p_sys->p_threads = calloc( i_threads, sizeof( *p_sys->p_threads ) );
+    if( !p_sys->p_threads )
+        goto error;
+    for( ; p_sys->i_threads < i_threads; p_sys->i_threads++ )
+    {
+        if( vlc_clone( &p_sys->p_threads[p_sys->i_threads], Run,
+                       p_fingerprinter, VLC_THREAD_PRIORITY_LOW ) )
+            break;
+    }
+    if( p_sys->i_threads == 0 )
     {
         msg_Err( p_fingerprinter, "cannot spawn fingerprinter thread" );
         goto error;
     }
+    msg_Dbg( p_fingerprinter, "fingerprinting with %u threads",
+             p_sys->i_threads );
 
     return VLC_SUCCESS;
 
@@ -273,8 +324,10 @@ static void Close(vlc_object_t *p_this)
     fingerprinter_thread_t   *p_fingerprinter = (fingerprinter_thread_t*) p_this;
     fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
-    vlc_cancel( p_sys->thread );
-    vlc_join( p_sys->thread, NULL );
+    for( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_cancel( p_sys->p_threads[i] );
+    for( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_join( p_sys->p_threads[i], NULL );
 
     CleanSys( p_sys );
     free( p_sys );
@@ -282,10 +335,7 @@ static void Close(vlc_object_t *p_this)
 
 static void CleanSys( fingerprinter_sys_t *p_sys )
 {
-    for ( size_t i = 0; i < vlc_array_count( &p_sys->incoming.queue ); i++ )
-        fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->incoming.queue, i ) );
-    vlc_array_clear( &p_sys->incoming.queue );
-    vlc_mutex_destroy( &p_sys->incoming.lock );
+    free( p_sys->p_threads );
 
     for ( size_t i = 0; i < vlc_array_count( &p_sys->processing.queue ); i++ )
         fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->processing.queue, i ) );
@@ -319,70 +369,80 @@ static void fill_metas_with_results( fingerprint_request_t *p_r, acoustid_finger
     }
 }
 
-/*****************************************************************************
- * Run :
- *****************************************************************************/
-static void *Run( void *opaque )
+static void ProcessRequest( fingerprinter_thread_t *p_fingerprinter,
+                            fingerprint_request_t *p_data )
 {
-    fingerprinter_thread_t *p_fingerprinter = opaque;
-    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
+    char *psz_uri = input_item_GetURI( p_data->p_item );
+    if ( psz_uri == NULL )
+        return;
 
-    vlc_mutex_lock( &p_sys->processing.lock );
-    mutex_cleanup_push( &p_sys->processing.lock );
+    acoustid_fingerprint_t acoustid_print;
 
-    /* main loop */
-    for (;;)
-    {
-        msleep( CLOCK_FREQ );
-
-        QueueIncomingRequests( p_sys );
+    memset( &acoustid_print , 0, sizeof (acoustid_print) );
+    /* overwrite with hint, as in this case, fingerprint's session will be truncated */
+    if ( p_data->i_duration )
+         acoustid_print.i_duration = p_data->i_duration;
 
-        vlc_testcancel();
+    DoFingerprint( p_fingerprinter, &acoustid_print, psz_uri );
 
-        for ( size_t i = 0 ; i < vlc_array_count( &p_sys->processing.queue ); i++ )
+    if ( !p_data->b_fingerprint_only )
+    {
+        /* The lookup matches the length too: a wrong one gives wrong or
+         * no results, so don't submit the fingerprint without it */
+        if ( acoustid_print.i_duration == 0 )
+            msg_Warn( p_fingerprinter, "unknown length, skipping the lookup "
+                      "of %s", psz_uri );
+        else
         {
-            int canc = vlc_savecancel();
-            fingerprint_request_t *p_data = vlc_array_item_at_index( &p_sys->processing.queue, i );
-
-            char *psz_uri = input_item_GetURI( p_data->p_item );
-            if ( psz_uri != NULL )
-            {
-                 acoustid_fingerprint_t acoustid_print;
-
-                 memset( &acoustid_print , 0, sizeof (acoustid_print) );
-                /* overwrite with hint, as in this case, fingerprint's session will be truncated */
-                if ( p_data->i_duration )
-                     acoustid_print.i_duration = p_data->i_duration;
-
-                DoFingerprint( p_fingerprinter, &acoustid_print, psz_uri );
-                free( psz_uri );
-
-                DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), &acoustid_print );
-                fill_metas_with_results( p_data, &acoustid_print );
+            DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), &acoustid_print );
+            fill_metas_with_results( p_data, &acoustid_print );
+        }
+    }
+    free( psz_uri );
 
-                for( unsigned j = 0; j < acoustid_print.results.count; j++ )
-                     free_acoustid_result_t( &acoustid_print.results.p_results[j] );
-                if( acoustid_print.results.count )
-                    free( acoustid_print.results.p_results );
-                free( acoustid_print.psz_fingerprint );
-            }
-            vlc_restorecancel(canc);
+    for( unsigned j = 0; j < acoustid_print.results.count; j++ )
+         free_acoustid_result_t( &acoustid_print.results.p_results[j] );
+    if( acoustid_print.results.count )
+        free( acoustid_print.results.p_results );
 
-            /* copy results */
-            vlc_mutex_lock( &p_sys->results.lock );
-            vlc_array_append( &p_sys->results.queue, p_data );
-            vlc_mutex_unlock( &p_sys->results.lock );
+    p_data->results.psz_fingerprint = acoustid_print.psz_fingerprint;
+    if ( !p_data->i_duration )
+        p_data->i_duration = acoustid_print.i_duration;
+}
 
-            vlc_testcancel();
-        }
+/*****************************************************************************
+ * Run : each thread fingerprints one track at a time
+ *****************************************************************************/
+static void *Run( void *opaque )
+{
+    fingerprinter_thread_t *p_fingerprinter = opaque;
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
-        if ( vlc_array_count( &p_sys->processing.queue ) )
-        {
-            var_TriggerCallback( p_fingerprinter, "results-available" );
-            vlc_array_clear( &p_sys->processing.queue );
-        }
+    /* main loop */
+    for (;;)
+    {
+        fingerprint_request_t *p_data;
+
+        vlc_mutex_lock( &p_sys->processing.lock );
+        mutex_cleanup_push( &p_sys->processing.lock );
+        while( vlc_array_count( &p_sys->processing.queue ) == 0 )
+            vlc_cond_wait( &p_sys->processing.cond, &p_sys->processing.lock );
+        p_data = vlc_array_item_at_index( &p_sys->processing.queue, 0 );
+        vlc_array_remove( &p_sys->processing.queue, 0 );
+        vlc_cleanup_pop();
+        vlc_mutex_unlock( &p_sys->processing.lock );
+
+        int canc = vlc_savecancel();
+        ProcessRequest( p_fingerprinter, p_data );
+
+        /* copy results */
+        vlc_mutex_lock( &p_sys->results.lock );
+        vlc_array_append( &p_sys->results.queue, p_data );
+        vlc_mutex_unlock( &p_sys->results.lock );
+
+        var_TriggerCallback( p_fingerprinter, "results-available" );
+        vlc_restorecancel( canc );
     }
 
-    vlc_cleanup_pop();
     vlc_assert_unreachable();
 }
@@ -42,6 +42,9 @@
 
 #define BLANK_DELAY INT64_C(1000000)
 
+/* Maximum number of conversion threads */
+#define THREADS_MAX 64
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -52,6 +55,39 @@ static subpicture_t *Filter ( filter_t *, mtime_t );
 static int MosaicCallback   ( vlc_object_t *, char const *, vlc_value_t,
                               vlc_value_t, void * );
 
+/*****************************************************************************
+ * mosaic_tile_t : mosaic element, with its last converted picture
+ *****************************************************************************/
+typedef struct mosaic_tile_t mosaic_tile_t;
+struct mosaic_tile_t
+{
+    const bridged_es_t *p_es; /* Bridge slot, only compared */
+    char *psz_id;
+    bool b_present;
+
+    picture_t *p_source;      /* Last source picture (held) */
+    picture_t *p_converted;   /* Its conversion, or NULL */
+    video_format_t fmt_in, fmt_out;
+
+    /* Placement in the current subpicture */
+    int i_x, i_y, i_alpha;
+    mosaic_tile_t *p_next_shown;
+
+    /* Statistics */
+    unsigned i_converted;     /* Number of converted pictures */
+    unsigned i_reused;        /* Number of pictures shown again */
+    mtime_t i_convert_time;   /* Total conversion time */
+    mtime_t i_convert_peak;
+    mtime_t i_latency_peak;   /* Largest delay between picture and display */
+};
+
+typedef struct
+{
+    filter_t *p_filter;
+    vlc_thread_t thread;
+    image_handler_t *p_image;
+} mosaic_worker_t;
+
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
@@ -61,6 +97,20 @@ struct filter_sys_t
 
     image_handler_t *p_image;
 
+    mosaic_tile_t **pp_tiles; /* Known mosaic elements */
+    int i_tiles;
+
+    /* Conversion threads, the filter thread converts pictures as well */
+    mosaic_worker_t *p_workers;
+    int i_workers;
+    vlc_mutex_t work_lock;
+    vlc_cond_t work_wait;
+    vlc_cond_t done_wait;
+    mosaic_tile_t **pp_jobs;  /* Tiles to convert */
+    int i_queued, i_jobs_max; /* Owned by the filter thread */
+    int i_jobs, i_next_job, i_pending;
+    bool b_exit;
+
     int i_position;           /* Mosaic positioning method */
     bool b_ar;          /* Do we keep the aspect ratio ? */
     bool b_keep;        /* Do we keep the original picture format ? */
@@ -157,6 +207,11 @@ struct filter_sys_t
         "according to this value (in milliseconds). For high " \
         "values you will need to raise caching at input.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_( \
+        "Number of threads resizing the mosaic elements in parallel " \
+        "(0 means one per CPU)." )
+
 enum
 {
     position_auto = 0, position_fixed = 1, position_offsets = 2
@@ -223,13 +278,16 @@ vlc_module_begin ()
 
     add_integer( CFG_PREFIX "delay", 0, DELAY_TEXT, DELAY_LONGTEXT,
                  false )
+
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "alpha", "height", "width", "align", "xoffset", "yoffset",
     "borderw", "borderh", "position", "rows", "cols",
     "keep-aspect-ratio", "keep-picture", "order", "offsets",
-    "delay", NULL
+    "delay", "threads", NULL
 };
 
 /*****************************************************************************
@@ -272,6 +330,261 @@ static void mosaic_ParseSetOffsets( vlc_object_t *p_this,
 #define mosaic_ParseSetOffsets( a, b, c ) \
             mosaic_ParseSetOffsets( VLC_OBJECT( a ), b, c )
 
+/*****************************************************************************
+ * Tiles
+ *****************************************************************************/
+static void TileReset( filter_t *p_filter, mosaic_tile_t *p_tile )
+{
+    if( p_tile->i_converted > 0 )
+        msg_Dbg( p_filter, "element %s: %u pictures converted in %"PRId64
+                 " us on average (%"PRId64" us peak), %u reused, %"PRId64
+                 " ms peak latency",
+                 p_tile->psz_id ? p_tile->psz_id : "(unnamed)",
+                 p_tile->i_converted,
+                 p_tile->i_convert_time / p_tile->i_converted,
+                 p_tile->i_convert_peak, p_tile->i_reused,
+                 p_tile->i_latency_peak / 1000 );
+
+    if( p_tile->p_source )
+        picture_Release( p_tile->p_source );
+    if( p_tile->p_converted )
+        picture_Release( p_tile->p_converted );
+    free( p_tile->psz_id );
+    memset( p_tile, 0, sizeof( *p_tile ) );
+}
+
+static bool SameId( const char *psz_a, const char *psz_b )
+{
+    if( psz_a == NULL || psz_b == NULL )
+        return psz_a == psz_b;
+    return !strcmp( psz_a, psz_b );
+}
+
+static mosaic_tile_t *GetTile( filter_t *p_filter, const bridged_es_t *p_es )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    mosaic_tile_t *p_tile = NULL;
+
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+    {
+        if( p_sys->pp_tiles[i]->p_es == p_es )
+        {
+            p_tile = p_sys->pp_tiles[i];
+            /* The bridge reuses its slots for new elements */
+            if( SameId( p_tile->psz_id, p_es->psz_id ) )
+                return p_tile;
+            TileReset( p_filter, p_tile );
+            break;
+        }
+    }
+
+    if( p_tile == NULL )
+    {
+        p_tile = calloc( 1, sizeof( *p_tile ) );
+        if( p_tile == NULL )
+            return NULL;
+        TAB_APPEND( p_sys->i_tiles, p_sys->pp_tiles, p_tile );
+    }
+    p_tile->p_es = p_es;
+    if( p_es->psz_id != NULL )
+        p_tile->psz_id = strdup( p_es->psz_id );
+    return p_tile;
+}
+
+/* Forgets the elements that left the bridge */
+static void PurgeTiles( filter_t *p_filter, const bridge_t *p_bridge )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+        p_sys->pp_tiles[i]->b_present = false;
+    for( int i = 0; i < p_bridge->i_es_num; i++ )
+    {
+        const bridged_es_t *p_es = p_bridge->pp_es[i];
+        if( p_es->b_empty )
+            continue;
+        for( int j = 0; j < p_sys->i_tiles; j++ )
+            if( p_sys->pp_tiles[j]->p_es == p_es )
+                p_sys->pp_tiles[j]->b_present = true;
+    }
+
+    for( int i = 0; i < p_sys->i_tiles; )
+    {
+        mosaic_tile_t *p_tile = p_sys->pp_tiles[i];
+        if( p_tile->b_present )
+        {
+            i++;
+            continue;
+        }
+        TileReset( p_filter, p_tile );
+        free( p_tile );
+        TAB_ERASE( p_sys->i_tiles, p_sys->pp_tiles, i );
+    }
+}
+
+/*****************************************************************************
+ * Conversion of the elements pictures, in parallel
+ *****************************************************************************/
+static void ConvertTile( filter_t *p_filter, image_handler_t *p_image,
+                         mosaic_tile_t *p_tile )
+{
+    mtime_t i_start = mdate();
+
+    if( p_tile->p_converted )
+        picture_Release( p_tile->p_converted );
+    p_tile->p_converted = image_Convert( p_image, p_tile->p_source,
+                                         &p_tile->fmt_in, &p_tile->fmt_out );
+    if( !p_tile->p_converted )
+    {
+        msg_Warn( p_filter, "image resizing and chroma conversion failed" );
+        return;
+    }
+
+    mtime_t i_time = mdate() - i_start;
+    p_tile->i_converted++;
+    p_tile->i_convert_time += i_time;
+    if( i_time > p_tile->i_convert_peak )
+        p_tile->i_convert_peak = i_time;
+}
+
+/* Converts queued tiles until there are none left */
+static void ConvertJobs( filter_t *p_filter, image_handler_t *p_image )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->work_lock );
+    while( p_sys->i_next_job < p_sys->i_jobs )
+    {
+        mosaic_tile_t *p_tile = p_sys->pp_jobs[p_sys->i_next_job++];
+
+        vlc_mutex_unlock( &p_sys->work_lock );
+        ConvertTile( p_filter, p_image, p_tile );
+        vlc_mutex_lock( &p_sys->work_lock );
+
+        if( --p_sys->i_pending == 0 )
+            vlc_cond_signal( &p_sys->done_wait );
+    }
+    vlc_mutex_unlock( &p_sys->work_lock );
+}
+
+static void *Worker( void *data )
+{
+    mosaic_worker_t *p_worker = data;
+    filter_t *p_filter = p_worker->p_filter;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &p_sys->work_lock );
+        while( !p_sys->b_exit && p_sys->i_next_job >= p_sys->i_jobs )
+            vlc_cond_wait( &p_sys->work_wait, &p_sys->work_lock );
+        bool b_exit = p_sys->b_exit;
+        vlc_mutex_unlock( &p_sys->work_lock );
+
+        if( b_exit )
+            break;
+        ConvertJobs( p_filter, p_worker->p_image );
+    }
+    return NULL;
+}
+
+static void QueueTile( filter_t *p_filter, mosaic_tile_t *p_tile )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_queued == p_sys->i_jobs_max )
+    {
+        /* Each tile is queued at most once */
+        mosaic_tile_t **pp_jobs = realloc( p_sys->pp_jobs,
+                                    p_sys->i_tiles * sizeof( *pp_jobs ) );
+        if( pp_jobs == NULL )
+        {
+            ConvertTile( p_filter, p_sys->p_image, p_tile );
+            return;
+        }
+        p_sys->pp_jobs = pp_jobs;
+        p_sys->i_jobs_max = p_sys->i_tiles;
+    }
+    p_sys->pp_jobs[p_sys->i_queued++] = p_tile;
+}
+
+static void ConvertTiles( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_queued == 0 )
+        return;
+
+    vlc_mutex_lock( &p_sys->work_lock );
+    p_sys->i_jobs = p_sys->i_queued;
+    p_sys->i_next_job = 0;
+    p_sys->i_pending = p_sys->i_jobs;
+    if( p_sys->i_jobs > 1 )
+        vlc_cond_broadcast( &p_sys->work_wait );
+    vlc_mutex_unlock( &p_sys->work_lock );
+
+    ConvertJobs( p_filter, p_sys->p_image );
+
+    vlc_mutex_lock( &p_sys->work_lock );
+    while( p_sys->i_pending > 0 )
+        vlc_cond_wait( &p_sys->done_wait, &p_sys->work_lock );
+    p_sys->i_jobs = p_sys->i_next_job = 0;
+    vlc_mutex_unlock( &p_sys->work_lock );
+    p_sys->i_queued = 0;
+}
+
+static void StopWorkers( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->work_lock );
+    p_sys->b_exit = true;
+    vlc_cond_broadcast( &p_sys->work_wait );
+    vlc_mutex_unlock( &p_sys->work_lock );
+
+    for( int i = 0; i < p_sys->i_workers; i++ )
+    {
+        vlc_join( p_sys->p_workers[i].thread, NULL );
+        image_HandlerDelete( p_sys->p_workers[i].p_image );
+    }
+    free( p_sys->p_workers );
+    p_sys->p_workers = NULL;
+    p_sys->i_workers = 0;
+}
+
+static void StartWorkers( filter_t *p_filter, int i_threads )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    if( i_threads <= 1 )
+        return;
+
+    p_sys->p_workers = malloc( ( i_threads - 1 ) * sizeof( mosaic_worker_t ) );
+    if( p_sys->p_workers == NULL )
+        return;
+
+    for( int i = 0; i < i_threads - 1; i++ )
+    {
+        mosaic_worker_t *p_worker = &p_sys->p_workers[p_sys->i_workers];
+
+        p_worker->p_filter = p_filter;
+        p_worker->p_image = image_HandlerCreate( p_filter );
+        if( p_worker->p_image == NULL )
+            break;
+        if( vlc_clone( &p_worker->thread, Worker, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            image_HandlerDelete( p_worker->p_image );
+            break;
+        }
+        p_sys->i_workers++;
+    }
+    msg_Dbg( p_filter, "converting pictures with %d threads",
+             p_sys->i_workers + 1 );
+}
+
 /*****************************************************************************
  * CreateFiler: allocate mosaic video filter
  *****************************************************************************/
@@ -294,6 +607,18 @@ static int CreateFilter( vlc_object_t *p_this )
     vlc_mutex_init( &p_sys->lock );
     vlc_mutex_lock( &p_sys->lock );
 
+    TAB_INIT( p_sys->i_tiles, p_sys->pp_tiles );
+    p_sys->p_workers = NULL;
+    p_sys->i_workers = 0;
+    vlc_mutex_init( &p_sys->work_lock );
+    vlc_cond_init( &p_sys->work_wait );
+    vlc_cond_init( &p_sys->done_wait );
+    p_sys->pp_jobs = NULL;
+    p_sys->i_queued = p_sys->i_jobs_max = 0;
+    p_sys->i_jobs = 0;
+    p_sys->i_next_job = p_sys->i_pending = 0;
+    p_sys->b_exit = false;
+
     config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
                        p_filter->p_cfg );
 
@@ -331,6 +656,8 @@ static int CreateFilter( vlc_object_t *p_this )
     if ( !p_sys->b_keep )
     {
         p_sys->p_image = image_HandlerCreate( p_filter );
+        StartWorkers( p_filter,
+                      var_CreateGetInteger( p_filter, CFG_PREFIX "threads" ) );
     }
 
     p_sys->i_order_length = 0;
@@ -403,9 +730,21 @@ static void DestroyFilter( vlc_object_t *p_this )
 
     if( !p_sys->b_keep )
     {
+        StopWorkers( p_filter );
         image_HandlerDelete( p_sys->p_image );
     }
 
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+    {
+        TileReset( p_filter, p_sys->pp_tiles[i] );
+        free( p_sys->pp_tiles[i] );
+    }
+    TAB_CLEAN( p_sys->i_tiles, p_sys->pp_tiles );
+    free( p_sys->pp_jobs );
+    vlc_cond_destroy( &p_sys->done_wait );
+    vlc_cond_destroy( &p_sys->work_wait );
+    vlc_mutex_destroy( &p_sys->work_lock );
+
     if( p_sys->i_order_length )
     {
         for( int i_index = 0; i_index < p_sys->i_order_length; i_index++ )
@@ -440,6 +779,7 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
     subpicture_region_t *p_region;
     subpicture_region_t *p_region_prev = NULL;
+    mosaic_tile_t *p_shown = NULL, **pp_last_shown = &p_shown;
 
     /* Allocate the subpicture internal data. */
     subpicture_t *p_spu = filter_NewSubpicture( p_filter );
@@ -468,6 +808,8 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         return p_spu;
     }
 
+    PurgeTiles( p_filter, p_bridge );
+
     if ( p_sys->i_position == position_offsets )
     {
         /* If we have either too much or not enough offsets, fall-back
@@ -525,7 +867,7 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
     {
         bridged_es_t *p_es = p_bridge->pp_es[i_index];
         video_format_t fmt_in, fmt_out;
-        picture_t *p_converted;
+        mosaic_tile_t *p_tile;
 
         if ( p_es->b_empty )
             continue;
@@ -560,6 +902,12 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         if ( p_es->p_picture == NULL )
             continue;
 
+        p_tile = GetTile( p_filter, p_es );
+        if( p_tile == NULL )
+            continue;
+        if( date - p_es->p_picture->date > p_tile->i_latency_peak )
+            p_tile->i_latency_peak = date - p_es->p_picture->date;
+
         if ( p_sys->i_order_length == 0 )
         {
             i_real_index++;
@@ -618,54 +966,46 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
 
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
+            /* Unchanged elements are not converted again */
+            if( p_tile->p_source == p_es->p_picture
+             && p_tile->p_converted != NULL
+             && p_tile->fmt_out.i_width == fmt_out.i_width
+             && p_tile->fmt_out.i_height == fmt_out.i_height
+             && p_tile->fmt_out.i_chroma == fmt_out.i_chroma )
+                p_tile->i_reused++;
+            else
             {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                video_format_Clean( &fmt_in );
-                video_format_Clean( &fmt_out );
-                continue;
+                if( p_tile->p_source )
+                    picture_Release( p_tile->p_source );
+                p_tile->p_source = picture_Hold( p_es->p_picture );
+                p_tile->fmt_in = fmt_in;
+                p_tile->fmt_out = fmt_out;
+                QueueTile( p_filter, p_tile );
             }
         }
         else
         {
-            p_converted = p_es->p_picture;
-            fmt_in.i_width = fmt_out.i_width = p_converted->format.i_width;
-            fmt_in.i_height = fmt_out.i_height = p_converted->format.i_height;
-            fmt_in.i_chroma = fmt_out.i_chroma = p_converted->format.i_chroma;
+            fmt_in.i_width = fmt_out.i_width = p_es->p_picture->format.i_width;
+            fmt_in.i_height = fmt_out.i_height = p_es->p_picture->format.i_height;
+            fmt_in.i_chroma = fmt_out.i_chroma = p_es->p_picture->format.i_chroma;
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
-        }
-
-        p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
-        if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
-        if( !p_sys->b_keep )
-            picture_Release( p_converted );
 
-        if( !p_region )
-        {
-            video_format_Clean( &fmt_in );
-            video_format_Clean( &fmt_out );
-            msg_Err( p_filter, "cannot allocate SPU region" );
-            subpicture_Delete( p_spu );
-            vlc_global_unlock( VLC_MOSAIC_MUTEX );
-            vlc_mutex_unlock( &p_sys->lock );
-            return NULL;
+            if( p_tile->p_source )
+                picture_Release( p_tile->p_source );
+            p_tile->p_source = picture_Hold( p_es->p_picture );
+            p_tile->fmt_out = fmt_out;
         }
 
         if( p_es->i_x >= 0 && p_es->i_y >= 0 )
         {
-            p_region->i_x = p_es->i_x;
-            p_region->i_y = p_es->i_y;
+            p_tile->i_x = p_es->i_x;
+            p_tile->i_y = p_es->i_y;
         }
         else if( p_sys->i_position == position_offsets )
         {
-            p_region->i_x = p_sys->pi_x_offsets[i_real_index];
-            p_region->i_y = p_sys->pi_y_offsets[i_real_index];
+            p_tile->i_x = p_sys->pi_x_offsets[i_real_index];
+            p_tile->i_y = p_sys->pi_y_offsets[i_real_index];
         }
         else
         {
@@ -674,14 +1014,14 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's larger than the rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                p_tile->i_x = p_sys->i_xoffset
                             + i_col * ( p_sys->i_width / p_sys->i_cols )
                             + ( i_col * p_sys->i_borderw ) / p_sys->i_cols;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                p_tile->i_x = p_sys->i_xoffset
                         + i_col * ( p_sys->i_width / p_sys->i_cols )
                         + ( i_col * p_sys->i_borderw ) / p_sys->i_cols
                         + ( col_inner_width - fmt_out.i_width ) / 2;
@@ -692,21 +1032,65 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's taller than the rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                p_tile->i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                p_tile->i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows
                         + ( row_inner_height - fmt_out.i_height ) / 2;
             }
         }
+        p_tile->i_alpha = p_es->i_alpha;
+
+        *pp_last_shown = p_tile;
+        pp_last_shown = &p_tile->p_next_shown;
+        p_tile->p_next_shown = NULL;
+
+        video_format_Clean( &fmt_in );
+        video_format_Clean( &fmt_out );
+    }
+
+    /* The pictures are held: let the bridges push new ones meanwhile */
+    vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
+    ConvertTiles( p_filter );
+
+    for( mosaic_tile_t *p_tile = p_shown; p_tile != NULL;
+         p_tile = p_tile->p_next_shown )
+    {
+        if( !p_sys->b_keep && p_tile->p_converted == NULL )
+            continue;
+
+        p_region = subpicture_region_New( &p_tile->fmt_out );
+        if( !p_region )
+        {
+            msg_Err( p_filter, "cannot allocate SPU region" );
+            subpicture_Delete( p_spu );
+            vlc_mutex_unlock( &p_sys->lock );
+            return NULL;
+        }
+
+        if( p_sys->b_keep )
+        {
+            /* FIXME the copy is probably not needed anymore */
+            picture_Copy( p_region->p_picture, p_tile->p_source );
+        }
+        else
+        {
+            /* The converted picture is only read, and may be shown again */
+            picture_Release( p_region->p_picture );
+            p_region->p_picture = picture_Hold( p_tile->p_converted );
+        }
+
+        p_region->i_x = p_tile->i_x;
+        p_region->i_y = p_tile->i_y;
         p_region->i_align = p_sys->i_align;
-        p_region->i_alpha = p_es->i_alpha;
+        p_region->i_alpha = p_tile->i_alpha;
 
         if( p_region_prev == NULL )
         {
@@ -717,13 +1101,9 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             p_region_prev->p_next = p_region;
         }
 
-        video_format_Clean( &fmt_in );
-        video_format_Clean( &fmt_out );
-
         p_region_prev = p_region;
     }
 
-    vlc_global_unlock( VLC_MOSAIC_MUTEX );
     vlc_mutex_unlock( &p_sys->lock );
 
     return p_spu;
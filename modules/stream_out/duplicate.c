@@ -280,7 +280,12 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
             if( id->pp_ids[i_stream] )
             {
-                block_t *p_dup = block_Duplicate( p_buffer );
+                /* Outputs copy the payload before writing to it (see
+                 * block_Unshare()): share it rather than copy it for
+                 * every destination */
+                block_t *p_dup = block_Share( &p_buffer );
+                if( unlikely(p_dup == NULL) )
+                    p_dup = block_Duplicate( p_buffer );
 
                 if( p_dup )
                     sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
@@ -82,6 +82,50 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Parameters of a scaling context.
+ */
+typedef struct
+{
+    int i_src_w, i_src_h, i_src_fmt;
+    int i_dst_w, i_dst_h, i_dst_fmt;
+    int i_flags;
+} scaler_key_t;
+
+typedef struct
+{
+    struct SwsContext *ctx;
+    scaler_key_t key;
+} scaler_cache_t;
+
+/* Contexts kept across (re)initialisations, e.g. when the video size
+ * flips back and forth. A context leaves the cache when it is handed out,
+ * so bands of the same size each take their own entry. Each context holds
+ * its own line buffers, so only keep a few: bands beyond that get new
+ * contexts. */
+#define CACHE_SIZE (4)
+
+/**
+ * Horizontal band of the output picture, converted by its own context.
+ *
+ * When the vertical filter reaches across the band boundaries, the band is
+ * converted with a margin of extra lines into a temporary picture, and only
+ * the band itself is copied to the destination, so that the boundaries do
+ * not show.
+ */
+typedef struct
+{
+    struct SwsContext *ctx;
+    scaler_key_t key;
+    picture_t *p_tmp; /* NULL if converted in place */
+    unsigned i_src_y; /* first source line, including the margin */
+    unsigned i_dst_y; /* first destination line, excluding the margin */
+    unsigned i_skip; /* lines of margin at the top of p_tmp */
+    unsigned i_lines; /* lines of the band */
+} scaler_slice_t;
+
+#define SLICE_MAX (16)
+
 /**
  * Internal swscale filter structure.
  */
@@ -97,6 +141,12 @@ struct filter_sys_t
 
     struct SwsContext *ctx;
     struct SwsContext *ctxA;
+    scaler_key_t key;
+    scaler_key_t keyA;
+    scaler_slice_t slices[SLICE_MAX];
+    unsigned i_slices;
+    scaler_cache_t cache[CACHE_SIZE];
+    unsigned i_cache;
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -111,6 +161,7 @@ struct filter_sys_t
 static picture_t *Filter( filter_t *, picture_t * );
 static int  Init( filter_t * );
 static void Clean( filter_t * );
+static void CleanSlices( filter_sys_t * );
 
 typedef struct
 {
@@ -216,6 +267,8 @@ static void CloseScaler( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+    for( unsigned i = 0; i < p_sys->i_cache; i++ )
+        sws_freeContext( p_sys->cache[i].ctx );
     if( p_sys->p_filter )
         sws_freeFilter( p_sys->p_filter );
     free( p_sys );
@@ -350,6 +403,171 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Context cache
+ *****************************************************************************/
+static struct SwsContext *GetContext( filter_sys_t *p_sys,
+                                      const scaler_key_t *p_key )
+{
+    for( unsigned i = 0; i < p_sys->i_cache; i++ )
+    {
+        if( memcmp( &p_sys->cache[i].key, p_key, sizeof(*p_key) ) )
+            continue;
+
+        struct SwsContext *ctx = p_sys->cache[i].ctx;
+        p_sys->i_cache--;
+        memmove( &p_sys->cache[i], &p_sys->cache[i + 1],
+                 (p_sys->i_cache - i) * sizeof(p_sys->cache[0]) );
+        return ctx;
+    }
+
+    return sws_getContext( p_key->i_src_w, p_key->i_src_h, p_key->i_src_fmt,
+                           p_key->i_dst_w, p_key->i_dst_h, p_key->i_dst_fmt,
+                           p_key->i_flags, p_sys->p_filter, NULL, 0 );
+}
+
+static void PutContext( filter_sys_t *p_sys, struct SwsContext *ctx,
+                        const scaler_key_t *p_key )
+{
+    if( ctx == NULL )
+        return;
+
+    if( p_sys->i_cache == CACHE_SIZE )
+    {   /* Drop the least recently used one */
+        sws_freeContext( p_sys->cache[0].ctx );
+        p_sys->i_cache--;
+        memmove( &p_sys->cache[0], &p_sys->cache[1],
+                 p_sys->i_cache * sizeof(p_sys->cache[0]) );
+    }
+    p_sys->cache[p_sys->i_cache].ctx = ctx;
+    p_sys->cache[p_sys->i_cache].key = *p_key;
+    p_sys->i_cache++;
+}
+
+/*****************************************************************************
+ * Slicing
+ *****************************************************************************/
+static unsigned GetVerticalSubsampling( const vlc_chroma_description_t *desc )
+{
+    unsigned i_max = 1;
+
+    for( unsigned i = 0; i < desc->plane_count; i++ )
+        i_max = __MAX( i_max, desc->p[i].h.den / desc->p[i].h.num );
+    return i_max;
+}
+
+static unsigned Lcm( unsigned a, unsigned b )
+{
+    return a / GCD( a, b ) * b;
+}
+
+/**
+ * Splits the conversion into horizontal bands, one per thread.
+ *
+ * A band of destination lines is converted from the source lines at the
+ * same relative position, so both band boundaries must fall on a whole
+ * number of lines of every plane at the scaling ratio.
+ */
+static void InitSlices( filter_t *p_filter, const scaler_key_t *p_key )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_src_h = p_key->i_src_h;
+    const unsigned i_dst_h = p_key->i_dst_h;
+
+    p_sys->i_slices = 0;
+
+    /* Wide-support filters would need huge margins */
+    switch( p_sys->i_sws_flags & ~SWS_ACCURATE_RND )
+    {
+    case SWS_GAUSS:
+    case SWS_SINC:
+    case SWS_X:
+        return;
+    }
+    if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_RGBP )
+        return;
+
+    unsigned i_threads = __MIN( vlc_slice_threads( p_filter ), SLICE_MAX );
+    if( i_threads < 2 )
+        return;
+
+    /* Smallest band: a whole period of the scaling ratio, aligned to the
+     * chroma subsampling of both sides */
+    const unsigned i_gcd = GCD( i_src_h, i_dst_h );
+    const unsigned i_src_period = i_src_h / i_gcd;
+    const unsigned i_dst_period = i_dst_h / i_gcd;
+    const unsigned i_sub_in = GetVerticalSubsampling( p_sys->desc_in );
+    const unsigned i_sub_out = GetVerticalSubsampling( p_sys->desc_out );
+    const unsigned k = Lcm( i_sub_in / GCD( i_src_period, i_sub_in ),
+                            i_sub_out / GCD( i_dst_period, i_sub_out ) );
+    const unsigned i_src_unit = k * i_src_period;
+    const unsigned i_dst_unit = k * i_dst_period;
+
+    if( i_src_h % i_src_unit || i_dst_h % i_dst_unit )
+        return;
+
+    /* Margin covering the vertical filter support, in units. There is no
+     * vertical filtering at all with the same height and subsampling. */
+    unsigned i_margin = 0;
+    if( i_src_h != i_dst_h || i_sub_in != i_sub_out )
+    {
+        const unsigned i_support = 4 * i_sub_in *
+                                   ((i_src_h + i_dst_h - 1) / i_dst_h);
+        i_margin = (i_support + i_src_unit - 1) / i_src_unit;
+    }
+
+    const unsigned i_units = i_dst_h / i_dst_unit;
+    unsigned i_count = __MIN( i_threads, i_units / __MAX( 4 * i_margin, 1 ) );
+    if( i_count < 2 )
+        return;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        scaler_slice_t *p_slice = &p_sys->slices[i];
+        const unsigned i_first = i * i_units / i_count;
+        const unsigned i_last = (i + 1) * i_units / i_count;
+        const unsigned i_top = __MIN( i_margin, i_first );
+        const unsigned i_bottom = __MIN( i_margin, i_units - i_last );
+
+        scaler_key_t key = *p_key;
+        key.i_src_h = (i_last - i_first + i_top + i_bottom) * i_src_unit;
+        key.i_dst_h = (i_last - i_first + i_top + i_bottom) * i_dst_unit;
+
+        p_slice->key = key;
+        p_slice->ctx = GetContext( p_sys, &key );
+        p_slice->i_src_y = (i_first - i_top) * i_src_unit;
+        p_slice->i_dst_y = i_first * i_dst_unit;
+        p_slice->i_skip = i_top * i_dst_unit;
+        p_slice->i_lines = (i_last - i_first) * i_dst_unit;
+        p_slice->p_tmp = NULL;
+        if( i_top + i_bottom > 0 )
+            p_slice->p_tmp = picture_New( p_filter->fmt_out.video.i_chroma,
+                                          key.i_dst_w, key.i_dst_h, 1, 1 );
+        p_sys->i_slices = i + 1;
+
+        if( p_slice->ctx == NULL || (i_top + i_bottom > 0 && !p_slice->p_tmp) )
+        {
+            msg_Warn( p_filter, "cannot use %u slices", i_count );
+            CleanSlices( p_sys );
+            return;
+        }
+    }
+    msg_Dbg( p_filter, "converting in %u slices", p_sys->i_slices );
+}
+
+static void CleanSlices( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_slices; i++ )
+    {
+        scaler_slice_t *p_slice = &p_sys->slices[i];
+
+        PutContext( p_sys, p_slice->ctx, &p_slice->key );
+        if( p_slice->p_tmp )
+            picture_Release( p_slice->p_tmp );
+    }
+    p_sys->i_slices = 0;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -398,18 +616,27 @@ static int Init( filter_t *p_filter )
     const unsigned i_fmto_visible_width = p_fmto->i_visible_width * p_sys->i_extend_factor;
     for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
+        const scaler_key_t key = {
+            .i_src_w = i_fmti_visible_width,
+            .i_src_h = p_fmti->i_visible_height,
+            .i_src_fmt = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8,
+            .i_dst_w = i_fmto_visible_width,
+            .i_dst_h = p_fmto->i_visible_height,
+            .i_dst_fmt = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8,
+            .i_flags = cfg.i_sws_flags | p_sys->i_cpu_mask,
+        };
+        struct SwsContext *ctx = GetContext( p_sys, &key );
 
-        ctx = sws_getContext( i_fmti_visible_width, p_fmti->i_visible_height, i_fmti,
-                              i_fmto_visible_width, p_fmto->i_visible_height, i_fmto,
-                              cfg.i_sws_flags | p_sys->i_cpu_mask,
-                              p_sys->p_filter, NULL, 0 );
         if( n == 0 )
+        {
             p_sys->ctx = ctx;
+            p_sys->key = key;
+        }
         else
+        {
             p_sys->ctxA = ctx;
+            p_sys->keyA = key;
+        }
     }
     if( p_sys->ctxA )
     {
@@ -436,6 +663,9 @@ static int Init( filter_t *p_filter )
         return VLC_EGENERIC;
     }
 
+    if( !cfg.b_copy && p_sys->i_extend_factor == 1 )
+        InitSlices( p_filter, &p_sys->key );
+
     if (p_filter->b_allow_fmt_out_change)
     {
         /*
@@ -480,11 +710,9 @@ static void Clean( filter_t *p_filter )
     if( p_sys->p_dst_a )
         picture_Release( p_sys->p_dst_a );
 
-    if( p_sys->ctxA )
-        sws_freeContext( p_sys->ctxA );
-
-    if( p_sys->ctx )
-        sws_freeContext( p_sys->ctx );
+    CleanSlices( p_sys );
+    PutContext( p_sys, p_sys->ctxA, &p_sys->keyA );
+    PutContext( p_sys, p_sys->ctx, &p_sys->key );
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
@@ -615,6 +843,73 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+struct slice_job
+{
+    filter_t *p_filter;
+    picture_t *p_dst;
+    picture_t *p_src;
+    int i_plane_count;
+};
+
+static void ConvertSlice( void *opaque, unsigned i_slice, unsigned i_count )
+{
+    const struct slice_job *job = opaque;
+    filter_t *p_filter = job->p_filter;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const scaler_slice_t *p_slice = &p_sys->slices[i_slice];
+    const vlc_chroma_description_t *desc_out = p_sys->desc_out;
+    uint8_t *src[4]; int src_stride[4];
+    uint8_t *dst[4]; int dst_stride[4];
+
+    VLC_UNUSED(i_count);
+    GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
+               job->p_src, job->i_plane_count, p_sys->b_swap_uvi );
+    for( unsigned i = 0; i < p_sys->desc_in->plane_count && src[i]; i++ )
+        src[i] += p_slice->i_src_y * p_sys->desc_in->p[i].h.num
+                / p_sys->desc_in->p[i].h.den * src_stride[i];
+
+    if( p_slice->p_tmp == NULL )
+    {
+        GetPixels( dst, dst_stride, desc_out, &p_filter->fmt_out.video,
+                   job->p_dst, job->i_plane_count, p_sys->b_swap_uvo );
+        for( unsigned i = 0; i < desc_out->plane_count && dst[i]; i++ )
+            dst[i] += p_slice->i_dst_y * desc_out->p[i].h.num
+                    / desc_out->p[i].h.den * dst_stride[i];
+
+        sws_scale( p_slice->ctx, src, src_stride,
+                   0, p_slice->key.i_src_h, dst, dst_stride );
+        return;
+    }
+
+    GetPixels( dst, dst_stride, desc_out, &p_slice->p_tmp->format,
+               p_slice->p_tmp, job->i_plane_count, p_sys->b_swap_uvo );
+    sws_scale( p_slice->ctx, src, src_stride,
+               0, p_slice->key.i_src_h, dst, dst_stride );
+
+    /* Copy the band without its margins */
+    uint8_t *tmp[4]; int tmp_stride[4];
+
+    GetPixels( tmp, tmp_stride, desc_out, &p_slice->p_tmp->format,
+               p_slice->p_tmp, job->i_plane_count, false );
+    GetPixels( dst, dst_stride, desc_out, &p_filter->fmt_out.video,
+               job->p_dst, job->i_plane_count, false );
+    for( unsigned i = 0; i < desc_out->plane_count && dst[i]; i++ )
+    {
+        const unsigned num = desc_out->p[i].h.num;
+        const unsigned den = desc_out->p[i].h.den;
+        const size_t i_width = p_slice->p_tmp->p[i].i_visible_pitch;
+        const uint8_t *s = tmp[i] + p_slice->i_skip * num / den * tmp_stride[i];
+        uint8_t *d = dst[i] + p_slice->i_dst_y * num / den * dst_stride[i];
+
+        for( unsigned y = 0; y < p_slice->i_lines * num / den; y++ )
+        {
+            memcpy( d, s, i_width );
+            s += tmp_stride[i];
+            d += dst_stride[i];
+        }
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -662,8 +957,19 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         /* Even if alpha is unused, swscale expects the pointer to be set */
         const int n_planes = !p_sys->ctxA && (p_src->i_planes == 4 ||
                              p_dst->i_planes == 4) ? 4 : 3;
-        Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
-                 n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+        if( p_sys->i_slices > 1 )
+        {
+            struct slice_job job = {
+                .p_filter = p_filter,
+                .p_dst = p_dst,
+                .p_src = p_src,
+                .i_plane_count = n_planes,
+            };
+            vlc_slice_exec( p_filter, ConvertSlice, &job, p_sys->i_slices );
+        }
+        else
+            Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
+                     n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
     }
     if( p_sys->ctxA )
     {
@@ -33,6 +33,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "blend_kernels.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -79,6 +80,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -623,11 +636,323 @@ static const struct {
 #undef YUV
 };
 
+/*****************************************************************************
+ * Line based fast paths
+ *
+ * The most common blendings (subpictures onto 8 bits 4:2:0 or RGB32 video)
+ * are done one line at a time with vectorized kernels, the source line being
+ * first converted into planar 8 bits YUVA.
+ *****************************************************************************/
+struct filter_sys_t;
+
+typedef void (*fast_blend_function_t)(filter_sys_t *sys,
+                                      const CPicture &dst_data,
+                                      const CPicture &src_data,
+                                      unsigned width, unsigned height,
+                                      int alpha);
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), fast(NULL), scratch(NULL), scratch_pitch(0)
     {
     }
-    blend_function_t blend;
+    ~filter_sys_t()
+    {
+        free(scratch);
+    }
+    /* Returns one of the scratch lines */
+    uint8_t *getScratch(unsigned index) const
+    {
+        return &scratch[index * scratch_pitch];
+    }
+    blend_function_t      blend;
+    fast_blend_function_t fast;
+    blend_kernels_t       kernels;
+    uint8_t               *scratch;
+    size_t                scratch_pitch;
+};
+
+enum {
+    SCRATCH_Y,
+    SCRATCH_U,
+    SCRATCH_V,
+    SCRATCH_A,
+    SCRATCH_ALPHA,
+    SCRATCH_CHROMA_U,
+    SCRATCH_CHROMA_V,
+    SCRATCH_CHROMA_A,
+    SCRATCH_CHROMA_UV,
+    SCRATCH_CHROMA_AA,
+    SCRATCH_COUNT
+};
+
+struct CLine {
+    const uint8_t *y, *u, *v, *a;
+};
+
+class CLineYUVA : public CPicture {
+public:
+    CLineYUVA(const CPicture &cfg, filter_sys_t *) : CPicture(cfg)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = &CPicture::getLine<1>(i)[x];
+    }
+    void get(CLine *line, unsigned)
+    {
+        line->y = data[0];
+        line->u = data[1];
+        line->v = data[2];
+        line->a = data[3];
+    }
+    void nextLine()
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+private:
+    const uint8_t *data[4];
+};
+
+class CLineRGBA : public CPicture {
+public:
+    CLineRGBA(const CPicture &cfg, filter_sys_t *sys) : CPicture(cfg), sys(sys)
+    {
+        data = &CPicture::getLine<1>(0)[4 * x];
+    }
+    void get(CLine *line, unsigned width)
+    {
+        uint8_t *y = sys->getScratch(SCRATCH_Y);
+        uint8_t *u = sys->getScratch(SCRATCH_U);
+        uint8_t *v = sys->getScratch(SCRATCH_V);
+        uint8_t *a = sys->getScratch(SCRATCH_A);
+
+        sys->kernels.rgba_to_yuva(y, u, v, a, data, width);
+        line->y = y;
+        line->u = u;
+        line->v = v;
+        line->a = a;
+    }
+    void nextLine()
+    {
+        data += picture->p[0].i_pitch;
+    }
+private:
+    filter_sys_t *sys;
+    const uint8_t *data;
+};
+
+class CLineYUVP : public CPicture {
+public:
+    CLineYUVP(const CPicture &cfg, filter_sys_t *sys) : CPicture(cfg), sys(sys)
+    {
+        data = &CPicture::getLine<1>(0)[x];
+    }
+    void get(CLine *line, unsigned width)
+    {
+        const video_palette_t *palette = fmt->p_palette;
+        uint8_t *y = sys->getScratch(SCRATCH_Y);
+        uint8_t *u = sys->getScratch(SCRATCH_U);
+        uint8_t *v = sys->getScratch(SCRATCH_V);
+        uint8_t *a = sys->getScratch(SCRATCH_A);
+
+        for (unsigned i = 0; i < width; i++) {
+            const uint8_t *entry = palette->palette[data[i]];
+            y[i] = entry[0];
+            u[i] = entry[1];
+            v[i] = entry[2];
+            a[i] = entry[3];
+        }
+        line->y = y;
+        line->u = u;
+        line->v = v;
+        line->a = a;
+    }
+    void nextLine()
+    {
+        data += picture->p[0].i_pitch;
+    }
+private:
+    filter_sys_t *sys;
+    const uint8_t *data;
+};
+
+template <bool swap_uv>
+class CLineI420 : public CPicture {
+public:
+    CLineI420(const CPicture &cfg, filter_sys_t *sys) : CPicture(cfg), sys(sys)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(swap_uv ? 2 : 1);
+        data[2] = CPicture::getLine<2>(swap_uv ? 1 : 2);
+    }
+    void merge(const CLine &line, const uint8_t *a, unsigned width)
+    {
+        const blend_kernels_t *k = &sys->kernels;
+
+        k->merge(&data[0][x], line.y, a, width);
+        if ((y % 2) != 0)
+            return;
+
+        /* Chroma is taken from the pixels on even columns */
+        const unsigned phase = x % 2;
+        const unsigned count = (width - phase + 1) / 2;
+        uint8_t *u  = sys->getScratch(SCRATCH_CHROMA_U);
+        uint8_t *v  = sys->getScratch(SCRATCH_CHROMA_V);
+        uint8_t *ca = sys->getScratch(SCRATCH_CHROMA_A);
+
+        k->decimate(u,  line.u + phase, count);
+        k->decimate(v,  line.v + phase, count);
+        k->decimate(ca, a      + phase, count);
+        k->merge(&data[1][(x + phase) / 2], u, ca, count);
+        k->merge(&data[2][(x + phase) / 2], v, ca, count);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0) {
+            data[1] += picture->p[swap_uv ? 2 : 1].i_pitch;
+            data[2] += picture->p[swap_uv ? 1 : 2].i_pitch;
+        }
+    }
+private:
+    filter_sys_t *sys;
+    uint8_t *data[3];
+};
+
+template <bool swap_uv>
+class CLineNV12 : public CPicture {
+public:
+    CLineNV12(const CPicture &cfg, filter_sys_t *sys) : CPicture(cfg), sys(sys)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(1);
+    }
+    void merge(const CLine &line, const uint8_t *a, unsigned width)
+    {
+        const blend_kernels_t *k = &sys->kernels;
+
+        k->merge(&data[0][x], line.y, a, width);
+        if ((y % 2) != 0)
+            return;
+
+        const unsigned phase = x % 2;
+        const unsigned count = (width - phase + 1) / 2;
+        uint8_t *u  = sys->getScratch(SCRATCH_CHROMA_U);
+        uint8_t *v  = sys->getScratch(SCRATCH_CHROMA_V);
+        uint8_t *ca = sys->getScratch(SCRATCH_CHROMA_A);
+        uint8_t *uv = sys->getScratch(SCRATCH_CHROMA_UV);
+        uint8_t *aa = sys->getScratch(SCRATCH_CHROMA_AA);
+
+        k->decimate(u,  line.u + phase, count);
+        k->decimate(v,  line.v + phase, count);
+        k->decimate(ca, a      + phase, count);
+        if (swap_uv)
+            k->zip(uv, v, u, count);
+        else
+            k->zip(uv, u, v, count);
+        k->zip(aa, ca, ca, count);
+        k->merge(&data[1][x + phase], uv, aa, 2 * count);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0)
+            data[1] += picture->p[1].i_pitch;
+    }
+private:
+    filter_sys_t *sys;
+    uint8_t *data[2];
+};
+
+template <class TDst, class TSrc>
+void BlendFast(filter_sys_t *sys,
+               const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    TSrc src(src_data, sys);
+    TDst dst(dst_data, sys);
+    uint8_t *scaled = sys->getScratch(SCRATCH_ALPHA);
+
+    for (unsigned y = 0; y < height; y++) {
+        CLine line;
+        const uint8_t *a;
+
+        src.get(&line, width);
+        if (alpha < 255) {
+            sys->kernels.alpha(scaled, line.a, alpha, width);
+            a = scaled;
+        } else {
+            a = line.a; /* div255(255 * a) is a */
+        }
+        dst.merge(line, a, width);
+
+        src.nextLine();
+        dst.nextLine();
+    }
+}
+
+class CPictureRGBAOntoRGB32 : public CPicture {
+public:
+    CPictureRGBAOntoRGB32(const CPicture &cfg) : CPicture(cfg)
+    {
+#ifdef WORDS_BIGENDIAN
+        offsets[0] = (32 - fmt->i_lrshift) / 8;
+        offsets[1] = (32 - fmt->i_lgshift) / 8;
+        offsets[2] = (32 - fmt->i_lbshift) / 8;
+#else
+        offsets[0] = fmt->i_lrshift / 8;
+        offsets[1] = fmt->i_lgshift / 8;
+        offsets[2] = fmt->i_lbshift / 8;
+#endif
+        data = &CPicture::getLine<1>(0)[4 * x];
+    }
+    void blend(filter_sys_t *sys, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+    {
+        const picture_t *src = src_data.getPicture();
+        const uint8_t *line = &src->p[0].p_pixels[src_data.getY() * src->p[0].i_pitch
+                                                  + 4 * src_data.getX()];
+
+        for (unsigned y = 0; y < height; y++) {
+            sys->kernels.merge_rgbx(data, line, alpha, offsets, width);
+            data += picture->p[0].i_pitch;
+            line += src->p[0].i_pitch;
+        }
+    }
+private:
+    unsigned offsets[3];
+    uint8_t *data;
+};
+
+static void BlendRGBAOntoRGB32(filter_sys_t *sys,
+                               const CPicture &dst_data,
+                               const CPicture &src_data,
+                               unsigned width, unsigned height, int alpha)
+{
+    CPictureRGBAOntoRGB32 dst(dst_data);
+
+    dst.blend(sys, src_data, width, height, alpha);
+}
+
+static const struct {
+    vlc_fourcc_t          dst;
+    vlc_fourcc_t          src;
+    fast_blend_function_t blend;
+} fast_blends[] = {
+#define YUV(csp, line) \
+    { csp, VLC_CODEC_YUVA, BlendFast<line, CLineYUVA> }, \
+    { csp, VLC_CODEC_RGBA, BlendFast<line, CLineRGBA> }, \
+    { csp, VLC_CODEC_YUVP, BlendFast<line, CLineYUVP> }
+
+    YUV(VLC_CODEC_I420, CLineI420<false>),
+    YUV(VLC_CODEC_J420, CLineI420<false>),
+    YUV(VLC_CODEC_YV12, CLineI420<true>),
+    YUV(VLC_CODEC_NV12, CLineNV12<false>),
+    YUV(VLC_CODEC_NV21, CLineNV12<true>),
+
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAOntoRGB32 },
+#undef YUV
 };
 
 /**
@@ -655,13 +980,32 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+
+    if (sys->fast) {
+        /* Room for the source line converted to YUVA, and for the
+         * kernels reading or writing a few samples past the end */
+        size_t pitch = ((size_t)width + 1 + 63) & ~(size_t)31;
+
+        if (pitch > sys->scratch_pitch) {
+            uint8_t *scratch = (uint8_t *)realloc(sys->scratch,
+                                                  SCRATCH_COUNT * pitch);
+            if (likely(scratch != NULL)) {
+                sys->scratch       = scratch;
+                sys->scratch_pitch = pitch;
+            }
+        }
+        if (likely(pitch <= sys->scratch_pitch)) {
+            sys->fast(sys, dst_data, src_data, width, height, alpha);
+            return;
+        }
+    }
+    sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -683,6 +1027,12 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
+    for (size_t i = 0; i < sizeof(fast_blends) / sizeof(*fast_blends); i++) {
+        if (fast_blends[i].src == src && fast_blends[i].dst == dst)
+            sys->fast = fast_blends[i].blend;
+    }
+    blend_kernels_Init(&sys->kernels);
+
     filter->pf_video_blend = Blend;
     filter->p_sys          = sys;
     return VLC_SUCCESS;
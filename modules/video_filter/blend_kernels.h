@@ -0,0 +1,644 @@
+/*****************************************************************************
+ * blend_kernels.h: Line kernels for the blending fast paths
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_BLEND_KERNELS_H_
+#define VLC_BLEND_KERNELS_H_
+
+#include <vlc_cpu.h>
+
+/* All the kernels work on 8 bits samples and are bit-exact with the generic
+ * blending code: with v <= 255 * 255, ((v >> 8) + v + 1) >> 8 is v / 255
+ * rounded, and it never overflows 16 bits. */
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# define BLEND_SSE2
+# include <emmintrin.h>
+# if VLC_GCC_VERSION(4, 9) || defined(__clang__)
+/* Newer compilers expose every intrinsic regardless of -m flags */
+#  define BLEND_SSE4_1
+#  define BLEND_AVX2
+#  include <smmintrin.h>
+#  include <immintrin.h>
+# endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define BLEND_NEON
+# include <arm_neon.h>
+#endif
+
+typedef struct
+{
+    /* dst[i] = alpha * a[i] / 255 */
+    void (*alpha)(uint8_t *dst, const uint8_t *a, unsigned alpha,
+                  unsigned count);
+    /* dst[i] = ((255 - a[i]) * dst[i] + a[i] * src[i]) / 255 */
+    void (*merge)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                  unsigned count);
+    /* dst[i] = src[2 * i] */
+    void (*decimate)(uint8_t *dst, const uint8_t *src, unsigned count);
+    /* dst[2 * i] = a[i], dst[2 * i + 1] = b[i] */
+    void (*zip)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                unsigned count);
+    /* Splits RGBA into Y, U, V and A planes (see rgb_to_yuv()) */
+    void (*rgba_to_yuva)(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *a,
+                         const uint8_t *rgba, unsigned count);
+    /* Merges RGBA pixels into 32-bits RGB pixels, the R, G and B components
+     * being at the given byte offsets in the destination */
+    void (*merge_rgbx)(uint8_t *dst, const uint8_t *rgba, unsigned alpha,
+                       const unsigned offsets[3], unsigned count);
+} blend_kernels_t;
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static inline unsigned blend_div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static void blend_alpha_C(uint8_t *dst, const uint8_t *a, unsigned alpha,
+                          unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        dst[i] = blend_div255(alpha * a[i]);
+}
+
+static void blend_merge_C(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        dst[i] = blend_div255((255 - a[i]) * dst[i] + src[i] * a[i]);
+}
+
+static void blend_decimate_C(uint8_t *dst, const uint8_t *src, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        dst[i] = src[2 * i];
+}
+
+static void blend_zip_C(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                        unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        dst[2 * i + 0] = a[i];
+        dst[2 * i + 1] = b[i];
+    }
+}
+
+static void blend_rgba_to_yuva_C(uint8_t *y, uint8_t *u, uint8_t *v,
+                                 uint8_t *a, const uint8_t *rgba,
+                                 unsigned count)
+{
+    for (unsigned i = 0; i < count; i++, rgba += 4) {
+        const int r = rgba[0], g = rgba[1], b = rgba[2];
+
+        y[i] = ((  66 * r + 129 * g +  25 * b + 128) >> 8) + 16;
+        u[i] = (( -38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+        v[i] = (( 112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+        a[i] = rgba[3];
+    }
+}
+
+static void blend_merge_rgbx_C(uint8_t *dst, const uint8_t *rgba,
+                               unsigned alpha, const unsigned offsets[3],
+                               unsigned count)
+{
+    for (unsigned i = 0; i < count; i++, dst += 4, rgba += 4) {
+        const unsigned a = blend_div255(alpha * rgba[3]);
+
+        if (a == 0)
+            continue;
+        for (unsigned c = 0; c < 3; c++)
+            dst[offsets[c]] = blend_div255((255 - a) * dst[offsets[c]]
+                                           + rgba[c] * a);
+    }
+}
+
+#ifdef BLEND_SSE2
+/*****************************************************************************
+ * SSE2
+ *****************************************************************************/
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i blend_div255_SSE2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+    v = _mm_add_epi16(v, _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+/* Merges 8 samples widened to 16 bits */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i blend_merge8_SSE2(__m128i d, __m128i s, __m128i a)
+{
+    __m128i v = _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), a), d);
+
+    v = _mm_add_epi16(v, _mm_mullo_epi16(s, a));
+    return blend_div255_SSE2(v);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i blend_merge16_SSE2(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = blend_merge8_SSE2(_mm_unpacklo_epi8(d, zero),
+                                   _mm_unpacklo_epi8(s, zero),
+                                   _mm_unpacklo_epi8(a, zero));
+    __m128i hi = blend_merge8_SSE2(_mm_unpackhi_epi8(d, zero),
+                                   _mm_unpackhi_epi8(s, zero),
+                                   _mm_unpackhi_epi8(a, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void blend_alpha_SSE2(uint8_t *dst, const uint8_t *a, unsigned alpha,
+                             unsigned count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&a[i]);
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), k);
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), k);
+
+        v = _mm_packus_epi16(blend_div255_SSE2(lo), blend_div255_SSE2(hi));
+        _mm_storeu_si128((__m128i *)&dst[i], v);
+    }
+    blend_alpha_C(&dst[i], &a[i], alpha, count - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void blend_merge_SSE2(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i f = _mm_loadu_si128((const __m128i *)&a[i]);
+
+        _mm_storeu_si128((__m128i *)&dst[i], blend_merge16_SSE2(d, s, f));
+    }
+    blend_merge_C(&dst[i], &src[i], &a[i], count - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void blend_decimate_SSE2(uint8_t *dst, const uint8_t *src,
+                                unsigned count)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+    unsigned i = 0;
+
+    /* The last odd sample of the source may not exist */
+    for (; i + 17 <= count; i += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)&src[2 * i]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)&src[2 * i + 16]);
+
+        lo = _mm_and_si128(lo, mask);
+        hi = _mm_and_si128(hi, mask);
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+    blend_decimate_C(&dst[i], &src[2 * i], count - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void blend_zip_SSE2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                           unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)&a[i]);
+        __m128i vb = _mm_loadu_si128((const __m128i *)&b[i]);
+
+        _mm_storeu_si128((__m128i *)&dst[2 * i],
+                         _mm_unpacklo_epi8(va, vb));
+        _mm_storeu_si128((__m128i *)&dst[2 * i + 16],
+                         _mm_unpackhi_epi8(va, vb));
+    }
+    blend_zip_C(&dst[2 * i], &a[i], &b[i], count - i);
+}
+
+/* Extracts one component of 8 RGBA pixels as 16 bits samples */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i blend_rgba_component_SSE2(__m128i p0, __m128i p1,
+                                                int shift)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+
+    switch (shift) {
+        case 0:
+            break;
+        case 8:
+            p0 = _mm_srli_epi32(p0, 8);
+            p1 = _mm_srli_epi32(p1, 8);
+            break;
+        case 16:
+            p0 = _mm_srli_epi32(p0, 16);
+            p1 = _mm_srli_epi32(p1, 16);
+            break;
+        default:
+            p0 = _mm_srli_epi32(p0, 24);
+            p1 = _mm_srli_epi32(p1, 24);
+            break;
+    }
+    return _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i blend_dot_SSE2(__m128i r, __m128i g, __m128i b,
+                                     short kr, short kg, short kb)
+{
+    __m128i v = _mm_mullo_epi16(r, _mm_set1_epi16(kr));
+
+    v = _mm_add_epi16(v, _mm_mullo_epi16(g, _mm_set1_epi16(kg)));
+    v = _mm_add_epi16(v, _mm_mullo_epi16(b, _mm_set1_epi16(kb)));
+    return _mm_add_epi16(v, _mm_set1_epi16(128));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void blend_rgba_to_yuva_SSE2(uint8_t *y, uint8_t *u, uint8_t *v,
+                                    uint8_t *a, const uint8_t *rgba,
+                                    unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)&rgba[4 * i]);
+        __m128i p1 = _mm_loadu_si128((const __m128i *)&rgba[4 * i + 16]);
+        __m128i r = blend_rgba_component_SSE2(p0, p1, 0);
+        __m128i g = blend_rgba_component_SSE2(p0, p1, 8);
+        __m128i b = blend_rgba_component_SSE2(p0, p1, 16);
+        __m128i alpha = blend_rgba_component_SSE2(p0, p1, 24);
+        __m128i vy, vu, vv;
+
+        /* Y sums fit in 16 bits unsigned, U and V in 16 bits signed */
+        vy = _mm_srli_epi16(blend_dot_SSE2(r, g, b, 66, 129, 25), 8);
+        vy = _mm_add_epi16(vy, _mm_set1_epi16(16));
+        vu = _mm_srai_epi16(blend_dot_SSE2(r, g, b, -38, -74, 112), 8);
+        vu = _mm_add_epi16(vu, _mm_set1_epi16(128));
+        vv = _mm_srai_epi16(blend_dot_SSE2(r, g, b, 112, -94, -18), 8);
+        vv = _mm_add_epi16(vv, _mm_set1_epi16(128));
+
+        _mm_storel_epi64((__m128i *)&y[i], _mm_packus_epi16(vy, vy));
+        _mm_storel_epi64((__m128i *)&u[i], _mm_packus_epi16(vu, vu));
+        _mm_storel_epi64((__m128i *)&v[i], _mm_packus_epi16(vv, vv));
+        _mm_storel_epi64((__m128i *)&a[i], _mm_packus_epi16(alpha, alpha));
+    }
+    blend_rgba_to_yuva_C(&y[i], &u[i], &v[i], &a[i], &rgba[4 * i], count - i);
+}
+#endif
+
+#ifdef BLEND_SSE4_1
+/*****************************************************************************
+ * SSE4.1
+ *****************************************************************************/
+/* Computes the pshufb masks placing the R, G and B components and their
+ * opacity at the destination offsets (the padding byte gets 0 opacity) */
+static inline void blend_rgbx_masks(int8_t color[16], int8_t alpha[16],
+                                    const unsigned offsets[3])
+{
+    for (unsigned i = 0; i < 16; i++)
+        color[i] = alpha[i] = -128;
+    for (unsigned p = 0; p < 4; p++)
+        for (unsigned c = 0; c < 3; c++) {
+            color[4 * p + offsets[c]] = 4 * p + c;
+            alpha[4 * p + offsets[c]] = 4 * p;
+        }
+}
+
+__attribute__ ((__target__ ("sse4.1")))
+static void blend_merge_rgbx_SSE4_1(uint8_t *dst, const uint8_t *rgba,
+                                    unsigned alpha, const unsigned offsets[3],
+                                    unsigned count)
+{
+    int8_t cmask[16], amask[16];
+    unsigned i = 0;
+
+    blend_rgbx_masks(cmask, amask, offsets);
+
+    const __m128i vcmask = _mm_loadu_si128((const __m128i *)cmask);
+    const __m128i vamask = _mm_loadu_si128((const __m128i *)amask);
+    const __m128i k = _mm_set1_epi32(alpha);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)&rgba[4 * i]);
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+        /* alpha * A fits in the low 16 bits of each pixel */
+        __m128i f = _mm_mullo_epi16(_mm_srli_epi32(s, 24), k);
+
+        f = _mm_shuffle_epi8(blend_div255_SSE2(f), vamask);
+        s = _mm_shuffle_epi8(s, vcmask);
+
+        __m128i lo = blend_merge8_SSE2(_mm_cvtepu8_epi16(d),
+                                       _mm_cvtepu8_epi16(s),
+                                       _mm_cvtepu8_epi16(f));
+        __m128i hi = blend_merge8_SSE2(_mm_cvtepu8_epi16(_mm_srli_si128(d, 8)),
+                                       _mm_cvtepu8_epi16(_mm_srli_si128(s, 8)),
+                                       _mm_cvtepu8_epi16(_mm_srli_si128(f, 8)));
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_packus_epi16(lo, hi));
+    }
+    blend_merge_rgbx_C(&dst[4 * i], &rgba[4 * i], alpha, offsets, count - i);
+}
+#endif
+
+#ifdef BLEND_AVX2
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+/* Lane-wise unpacking and packing cancel out: the sample order is kept. */
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i blend_div255_AVX2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i blend_merge16_AVX2(__m256i d, __m256i s, __m256i a)
+{
+    __m256i v = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_set1_epi16(255), a),
+                                   d);
+
+    v = _mm256_add_epi16(v, _mm256_mullo_epi16(s, a));
+    return blend_div255_AVX2(v);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i blend_merge32_AVX2(__m256i d, __m256i s, __m256i a)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = blend_merge16_AVX2(_mm256_unpacklo_epi8(d, zero),
+                                    _mm256_unpacklo_epi8(s, zero),
+                                    _mm256_unpacklo_epi8(a, zero));
+    __m256i hi = blend_merge16_AVX2(_mm256_unpackhi_epi8(d, zero),
+                                    _mm256_unpackhi_epi8(s, zero),
+                                    _mm256_unpackhi_epi8(a, zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void blend_alpha_AVX2(uint8_t *dst, const uint8_t *a, unsigned alpha,
+                             unsigned count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k = _mm256_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&a[i]);
+        __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), k);
+        __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), k);
+
+        v = _mm256_packus_epi16(blend_div255_AVX2(lo), blend_div255_AVX2(hi));
+        _mm256_storeu_si256((__m256i *)&dst[i], v);
+    }
+    blend_alpha_C(&dst[i], &a[i], alpha, count - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void blend_merge_AVX2(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+        __m256i f = _mm256_loadu_si256((const __m256i *)&a[i]);
+
+        _mm256_storeu_si256((__m256i *)&dst[i], blend_merge32_AVX2(d, s, f));
+    }
+    blend_merge_C(&dst[i], &src[i], &a[i], count - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void blend_merge_rgbx_AVX2(uint8_t *dst, const uint8_t *rgba,
+                                  unsigned alpha, const unsigned offsets[3],
+                                  unsigned count)
+{
+    int8_t cmask[16], amask[16];
+    unsigned i = 0;
+
+    blend_rgbx_masks(cmask, amask, offsets);
+
+    /* The masks only move bytes within a pixel, hence within a lane */
+    const __m256i vcmask = _mm256_broadcastsi128_si256(
+                                _mm_loadu_si128((const __m128i *)cmask));
+    const __m256i vamask = _mm256_broadcastsi128_si256(
+                                _mm_loadu_si128((const __m128i *)amask));
+    const __m256i k = _mm256_set1_epi32(alpha);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&rgba[4 * i]);
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+        __m256i f = _mm256_mullo_epi16(_mm256_srli_epi32(s, 24), k);
+
+        f = _mm256_shuffle_epi8(blend_div255_AVX2(f), vamask);
+        s = _mm256_shuffle_epi8(s, vcmask);
+        _mm256_storeu_si256((__m256i *)&dst[4 * i],
+                            blend_merge32_AVX2(d, s, f));
+    }
+    blend_merge_rgbx_C(&dst[4 * i], &rgba[4 * i], alpha, offsets, count - i);
+}
+#endif
+
+#ifdef BLEND_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static inline uint8x8_t blend_div255_NEON(uint16x8_t v)
+{
+    v = vaddq_u16(v, vshrq_n_u16(v, 8));
+    v = vaddq_u16(v, vdupq_n_u16(1));
+    return vshrn_n_u16(v, 8);
+}
+
+static inline uint8x8_t blend_merge8_NEON(uint8x8_t d, uint8x8_t s,
+                                          uint8x8_t a)
+{
+    uint16x8_t v = vmull_u8(vsub_u8(vdup_n_u8(255), a), d);
+
+    return blend_div255_NEON(vmlal_u8(v, s, a));
+}
+
+static void blend_alpha_NEON(uint8_t *dst, const uint8_t *a, unsigned alpha,
+                             unsigned count)
+{
+    const uint8x8_t k = vdup_n_u8(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(&a[i]);
+        uint8x8_t lo = blend_div255_NEON(vmull_u8(vget_low_u8(v), k));
+        uint8x8_t hi = blend_div255_NEON(vmull_u8(vget_high_u8(v), k));
+
+        vst1q_u8(&dst[i], vcombine_u8(lo, hi));
+    }
+    blend_alpha_C(&dst[i], &a[i], alpha, count - i);
+}
+
+static void blend_merge_NEON(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t d = vld1q_u8(&dst[i]);
+        uint8x16_t s = vld1q_u8(&src[i]);
+        uint8x16_t f = vld1q_u8(&a[i]);
+        uint8x8_t lo = blend_merge8_NEON(vget_low_u8(d), vget_low_u8(s),
+                                         vget_low_u8(f));
+        uint8x8_t hi = blend_merge8_NEON(vget_high_u8(d), vget_high_u8(s),
+                                         vget_high_u8(f));
+
+        vst1q_u8(&dst[i], vcombine_u8(lo, hi));
+    }
+    blend_merge_C(&dst[i], &src[i], &a[i], count - i);
+}
+
+static void blend_decimate_NEON(uint8_t *dst, const uint8_t *src,
+                                unsigned count)
+{
+    unsigned i = 0;
+
+    /* The last odd sample of the source may not exist */
+    for (; i + 17 <= count; i += 16)
+        vst1q_u8(&dst[i], vld2q_u8(&src[2 * i]).val[0]);
+    blend_decimate_C(&dst[i], &src[2 * i], count - i);
+}
+
+static void blend_zip_NEON(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                           unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t v;
+
+        v.val[0] = vld1q_u8(&a[i]);
+        v.val[1] = vld1q_u8(&b[i]);
+        vst2q_u8(&dst[2 * i], v);
+    }
+    blend_zip_C(&dst[2 * i], &a[i], &b[i], count - i);
+}
+
+static inline uint8x8_t blend_chroma_NEON(uint8x8_t r, uint8x8_t g,
+                                          uint8x8_t b, uint8_t kr,
+                                          uint8_t kg, uint8_t kb, bool neg_r)
+{
+    /* U = (-kr R - kg G + kb B), V = (kr R - kg G - kb B), both fitting
+     * in 16 bits signed when computed modulo 2^16 */
+    uint16x8_t v;
+
+    if (neg_r) {
+        v = vmull_u8(b, vdup_n_u8(kb));
+        v = vmlsl_u8(v, r, vdup_n_u8(kr));
+    } else {
+        v = vmull_u8(r, vdup_n_u8(kr));
+        v = vmlsl_u8(v, b, vdup_n_u8(kb));
+    }
+    v = vmlsl_u8(v, g, vdup_n_u8(kg));
+
+    int16x8_t s = vreinterpretq_s16_u16(vaddq_u16(v, vdupq_n_u16(128)));
+
+    s = vaddq_s16(vshrq_n_s16(s, 8), vdupq_n_s16(128));
+    return vmovn_u16(vreinterpretq_u16_s16(s));
+}
+
+static void blend_rgba_to_yuva_NEON(uint8_t *y, uint8_t *u, uint8_t *v,
+                                    uint8_t *a, const uint8_t *rgba,
+                                    unsigned count)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t p = vld4_u8(&rgba[4 * i]);
+        uint16x8_t vy;
+
+        vy = vmull_u8(p.val[0], vdup_n_u8(66));
+        vy = vmlal_u8(vy, p.val[1], vdup_n_u8(129));
+        vy = vmlal_u8(vy, p.val[2], vdup_n_u8(25));
+        vy = vaddq_u16(vy, vdupq_n_u16(128));
+
+        vst1_u8(&y[i], vadd_u8(vshrn_n_u16(vy, 8), vdup_n_u8(16)));
+        vst1_u8(&u[i], blend_chroma_NEON(p.val[0], p.val[1], p.val[2],
+                                         38, 74, 112, true));
+        vst1_u8(&v[i], blend_chroma_NEON(p.val[0], p.val[1], p.val[2],
+                                         112, 94, 18, false));
+        vst1_u8(&a[i], p.val[3]);
+    }
+    blend_rgba_to_yuva_C(&y[i], &u[i], &v[i], &a[i], &rgba[4 * i], count - i);
+}
+#endif
+
+/**
+ * Selects the generic kernels.
+ */
+static inline void blend_kernels_InitC(blend_kernels_t *k)
+{
+    k->alpha        = blend_alpha_C;
+    k->merge        = blend_merge_C;
+    k->decimate     = blend_decimate_C;
+    k->zip          = blend_zip_C;
+    k->rgba_to_yuva = blend_rgba_to_yuva_C;
+    k->merge_rgbx   = blend_merge_rgbx_C;
+}
+
+/**
+ * Selects the best kernels for the running CPU.
+ */
+static inline void blend_kernels_Init(blend_kernels_t *k)
+{
+    blend_kernels_InitC(k);
+
+#ifdef BLEND_SSE2
+    if (vlc_CPU_SSE2()) {
+        k->alpha        = blend_alpha_SSE2;
+        k->merge        = blend_merge_SSE2;
+        k->decimate     = blend_decimate_SSE2;
+        k->zip          = blend_zip_SSE2;
+        k->rgba_to_yuva = blend_rgba_to_yuva_SSE2;
+    }
+#endif
+#ifdef BLEND_SSE4_1
+    if (vlc_CPU_SSE4_1())
+        k->merge_rgbx   = blend_merge_rgbx_SSE4_1;
+#endif
+#ifdef BLEND_AVX2
+    if (vlc_CPU_AVX2()) {
+        k->alpha        = blend_alpha_AVX2;
+        k->merge        = blend_merge_AVX2;
+        k->merge_rgbx   = blend_merge_rgbx_AVX2;
+    }
+#endif
+#ifdef BLEND_NEON
+    /* Only built when the compiler targets NEON in the first place */
+    k->alpha        = blend_alpha_NEON;
+    k->merge        = blend_merge_NEON;
+    k->decimate     = blend_decimate_NEON;
+    k->zip          = blend_zip_NEON;
+    k->rgba_to_yuva = blend_rgba_to_yuva_NEON;
+#endif
+}
+
+#endif
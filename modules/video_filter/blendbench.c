@@ -38,6 +38,8 @@
 #include <vlc_picture.h>
 #include <vlc_image.h>
 
+#include "blend_kernels.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -69,6 +71,11 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define CHECK_TEXT N_("Check against the reference code")
+#define CHECK_LONGTEXT N_("Also benchmark the line kernels of the blending " \
+                          "fast paths against the generic ones, and check " \
+                          "that their results are identical")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -83,6 +90,7 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_bool( CFG_PREFIX "check", true, CHECK_TEXT, CHECK_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
@@ -100,7 +108,7 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
+    "loops", "alpha", "check", "base-image", "base-chroma", "blend-image",
     "blend-chroma", NULL
 };
 
@@ -110,6 +118,7 @@ static const char *const ppsz_filter_options[] = {
 struct filter_sys_t
 {
     bool b_done;
+    bool b_check;
     int i_loops, i_alpha;
 
     picture_t *p_base_image;
@@ -175,6 +184,7 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
+    p_sys->b_check = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "check" );
 
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
@@ -215,32 +225,36 @@ static void Destroy( vlc_object_t *p_this )
     picture_Release( p_sys->p_blend_image );
 }
 
-/*****************************************************************************
- * Render: displays previously rendered output
- *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static filter_t *blendbench_CreateBlend( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
-
-    if( p_sys->b_done )
-        return p_pic;
+    filter_t *p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
 
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
         return NULL;
-    }
+
     p_blend->fmt_out.video = p_sys->p_base_image->format;
     p_blend->fmt_in.video = p_sys->p_blend_image->format;
+
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
         vlc_object_release( p_blend );
         return NULL;
     }
+    return p_blend;
+}
+
+static void blendbench_DeleteBlend( filter_t *p_blend )
+{
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+}
+
+static void blendbench_Run( filter_t *p_filter, filter_t *p_blend,
+                           const char *psz_name )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
@@ -250,18 +264,173 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                                  0, 0, p_sys->i_alpha );
     }
     time = mdate() - time;
+    if( time <= 0 )
+        time = 1;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              time / 1000000.0f );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * 1000000,
+    msg_Info( p_filter, "%s: blended %d images in %f sec", psz_name,
+              p_sys->i_loops, time / 1000000.0f );
+    msg_Info( p_filter, "%s: speed is: %f images/second, %f pixels/second",
+              psz_name, (float) p_sys->i_loops / time * 1000000,
               (float) p_sys->i_loops / time * 1000000 *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+}
 
-    module_unneed( p_blend, p_blend->p_module );
+static const char *const ppsz_kernels[] = {
+    "alpha", "merge", "decimate", "zip", "rgba_to_yuva", "merge_rgbx",
+};
 
-    vlc_object_release( p_blend );
+/* Number of output bytes of a kernel for each output buffer */
+static const uint8_t pi_kernel_outputs[][4] = {
+    { 1 }, { 1 }, { 1 }, { 2 }, { 1, 1, 1, 1 }, { 4 },
+};
+
+/**
+ * Runs one of the line kernels of the blend module on the input buffers.
+ */
+static void blendbench_RunKernel( const blend_kernels_t *p_kernels,
+                                  unsigned i_kernel, uint8_t *const pp_out[4],
+                                  uint8_t *const pp_in[3], unsigned i_count,
+                                  unsigned i_alpha )
+{
+    static const unsigned pi_offsets[3] = { 2, 1, 0 };
+
+    switch( i_kernel )
+    {
+        case 0:
+            p_kernels->alpha( pp_out[0], pp_in[0], i_alpha, i_count );
+            break;
+        case 1:
+            memcpy( pp_out[0], pp_in[1], i_count );
+            p_kernels->merge( pp_out[0], pp_in[0], pp_in[2], i_count );
+            break;
+        case 2:
+            p_kernels->decimate( pp_out[0], pp_in[0], i_count );
+            break;
+        case 3:
+            p_kernels->zip( pp_out[0], pp_in[0], pp_in[1], i_count );
+            break;
+        case 4:
+            p_kernels->rgba_to_yuva( pp_out[0], pp_out[1], pp_out[2],
+                                     pp_out[3], pp_in[0], i_count );
+            break;
+        case 5:
+            memcpy( pp_out[0], pp_in[1], 4 * i_count );
+            p_kernels->merge_rgbx( pp_out[0], pp_in[0], i_alpha, pi_offsets,
+                                   i_count );
+            break;
+    }
+}
+
+/**
+ * Benchmarks the line kernels selected for the CPU against the generic ones
+ * with lines as wide as the blend image, and checks that both give the same
+ * results for a few line widths (to exercise the tails) and alpha values.
+ */
+static int blendbench_CheckKernels( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const plane_t *p_plane = &p_sys->p_blend_image->p[Y_PLANE];
+    const unsigned i_width = p_sys->p_blend_image->format.i_visible_width;
+    const unsigned pi_counts[] = { 1, 15, 31, 33, i_width };
+    static const unsigned pi_alphas[] = { 1, 128, 255 };
+    /* Room for the kernels reading or writing a few bytes past the end */
+    const size_t i_size = 4 * (size_t)i_width + 64;
+    blend_kernels_t ref, opt;
+    uint8_t *pp_in[3], *pp_out[4], *pp_out_ref[4];
+    int i_errors = 0;
+
+    blend_kernels_InitC( &ref );
+    blend_kernels_Init( &opt );
+
+    uint8_t *p_buf = malloc( 11 * i_size );
+    if( !p_buf )
+        return -1;
+    for( unsigned i = 0; i < 3; i++ )
+        pp_in[i] = p_buf + i * i_size;
+    for( unsigned i = 0; i < 4; i++ )
+    {
+        pp_out[i] = p_buf + (3 + i) * i_size;
+        pp_out_ref[i] = p_buf + (7 + i) * i_size;
+    }
+
+    /* Deterministic pseudo-random input */
+    uint32_t i_seed = 0x1234567;
+    for( size_t i = 0; i < 3 * i_size; i++ )
+    {
+        i_seed = i_seed * 1664525 + 1013904223;
+        p_buf[i] = i_seed >> 24;
+    }
+
+    for( unsigned k = 0; k < ARRAY_SIZE(ppsz_kernels); k++ )
+    {
+        for( size_t i = 0; i < ARRAY_SIZE(pi_counts); i++ )
+            for( size_t j = 0; j < ARRAY_SIZE(pi_alphas); j++ )
+            {
+                const unsigned i_count = __MIN( pi_counts[i], i_width );
+
+                blendbench_RunKernel( &opt, k, pp_out, pp_in, i_count,
+                                      pi_alphas[j] );
+                blendbench_RunKernel( &ref, k, pp_out_ref, pp_in, i_count,
+                                      pi_alphas[j] );
+
+                for( unsigned o = 0; o < 4; o++ )
+                    if( memcmp( pp_out[o], pp_out_ref[o],
+                                pi_kernel_outputs[k][o] * i_count ) )
+                    {
+                        msg_Err( p_filter, "%s: mismatch with %u pixels, "
+                                 "alpha %u", ppsz_kernels[k], i_count,
+                                 pi_alphas[j] );
+                        i_errors++;
+                        break;
+                    }
+            }
+
+        /* As many lines as the benchmark blends */
+        const int i_lines = p_sys->i_loops * p_plane->i_visible_lines;
+        mtime_t pi_time[2];
+
+        for( int i = 0; i < 2; i++ )
+        {
+            pi_time[i] = mdate();
+            for( int y = 0; y < i_lines; y++ )
+                blendbench_RunKernel( i ? &opt : &ref, k, pp_out, pp_in,
+                                      i_width, p_sys->i_alpha );
+            pi_time[i] = __MAX( mdate() - pi_time[i], 1 );
+        }
+        msg_Info( p_filter, "%s: generic %f sec, optimized %f sec, "
+                  "speed up %f", ppsz_kernels[k], pi_time[0] / 1000000.0f,
+                  pi_time[1] / 1000000.0f, (float) pi_time[0] / pi_time[1] );
+    }
+
+    free( p_buf );
+    return i_errors;
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_blend;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    p_blend = blendbench_CreateBlend( p_filter );
+    if( !p_blend )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    blendbench_Run( p_filter, p_blend, "Blend" );
+
+    if( p_sys->b_check && blendbench_CheckKernels( p_filter ) == 0 )
+        msg_Info( p_filter, "Line kernels match the generic ones" );
+
+    blendbench_DeleteBlend( p_blend );
 
     p_sys->b_done = true;
     return p_pic;
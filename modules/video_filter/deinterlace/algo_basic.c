@@ -212,35 +212,63 @@ void RenderMean( filter_t *p_filter,
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-void RenderBlend( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic )
+typedef struct
+{
+    filter_t  *p_filter;
+    picture_t *p_outpic;
+    picture_t *p_pic;
+} blend_slice_t;
+
+static void RenderBlendSlice( void *opaque, unsigned i_slice,
+                              unsigned i_count )
 {
+    blend_slice_t *ctx = opaque;
+    filter_t *p_filter = ctx->p_filter;
+    picture_t *p_outpic = ctx->p_outpic;
+    picture_t *p_pic = ctx->p_pic;
     int i_plane;
 
     /* Copy image and skip lines */
     for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const int i_lines = p_outpic->p[i_plane].i_visible_lines;
+        const int i_first = i_lines * i_slice / i_count;
+        const int i_last  = i_lines * (i_slice + 1) / i_count;
+        const int i_in_pitch  = p_pic->p[i_plane].i_pitch;
+        const int i_out_pitch = p_outpic->p[i_plane].i_pitch;
+        int y = i_first;
 
-        p_in = p_pic->p[i_plane].p_pixels;
+        if( i_first >= i_last )
+            continue;
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        uint8_t *p_in  = p_pic->p[i_plane].p_pixels;
+        uint8_t *p_out = p_outpic->p[i_plane].p_pixels + y * i_out_pitch;
 
         /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
+        if( y == 0 && y < i_last )
+        {
+            memcpy( p_out, p_in, i_in_pitch );
+            p_out += i_out_pitch;
+            y++;
+        }
 
         /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( p_in += (y - 1) * i_in_pitch; y < i_last; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            Merge( p_out, p_in, p_in + i_in_pitch, i_in_pitch );
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
+            p_out += i_out_pitch;
+            p_in  += i_in_pitch;
         }
     }
     EndMerge();
 }
+
+void RenderBlend( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic )
+{
+    blend_slice_t ctx = { p_filter, p_outpic, p_pic };
+
+    vlc_slice_exec( p_filter, RenderBlendSlice, &ctx,
+                    p_filter->p_sys->i_slices );
+}
@@ -89,6 +89,8 @@ void RenderLinear( filter_t *p_filter,
  *
  * Obviously, there is no 2x equivalent for this filter.
  *
+ * The lines are processed in parallel slices.
+ *
  * @param p_filter The filter instance. Must be non-NULL.
  * @param p_outpic Output frame. Must be allocated by caller.
  * @param p_pic Input frame. Must exist.
@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
 
@@ -537,8 +538,17 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-void RenderX( picture_t *p_outpic, picture_t *p_pic )
+typedef struct
 {
+    picture_t *p_outpic;
+    picture_t *p_pic;
+} x_slice_t;
+
+static void RenderXSlice( void *opaque, unsigned i_slice, unsigned i_count )
+{
+    x_slice_t *ctx = opaque;
+    picture_t *p_outpic = ctx->p_outpic;
+    picture_t *p_pic = ctx->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -556,9 +566,14 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
+        /* Slices are made of whole bands of 8 lines; the last band
+         * (i_mby) is the partial one. */
+        const int i_first = (i_mby + 1) * i_slice / i_count;
+        const int i_last  = (i_mby + 1) * (i_slice + 1) / i_count;
+
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        for( y = i_first; y < i_last && y < i_mby; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -572,7 +587,7 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && y == i_mby && y < i_last )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -595,3 +610,11 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
         emms();
 #endif
 }
+
+void RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    x_slice_t ctx = { p_outpic, p_pic };
+
+    vlc_slice_exec( p_filter, RenderXSlice, &ctx,
+                    p_filter->p_sys->i_slices );
+}
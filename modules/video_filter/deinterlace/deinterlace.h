@@ -115,6 +115,9 @@ struct filter_sys_t
         (see extra documentation in deinterlace.h) */
     int i_frame_offset;
 
+    /** Number of slices for the slice-threaded algorithms */
+    unsigned i_slices;
+
     /** Input frame history buffer for algorithms with temporal filtering. */
     picture_t *pp_history[HISTORY_SIZE];
 
@@ -93,6 +93,9 @@ struct filter_sys_t
     int w[3], h[3];
 
     struct vf_priv_s cfg;
+    unsigned slices;
+    unsigned int *horiz;   /* horizontal low-pass of each plane (slices) */
+    unsigned int *line[3]; /* vertical low-pass state of each plane */
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
@@ -133,16 +136,39 @@ static int Open(vlc_object_t *this)
 
     sys->chroma = chroma;
 
+    size_t area = 0;
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        area += (size_t)sys->w[i] * sys->h[i];
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
+
+    sys->slices = vlc_slice_threads(filter);
+    if (sys->slices > 1) {
+        /* Each plane needs its own state when they are processed
+         * concurrently, plus the intermediate horizontal pass. */
+        cfg->Line = malloc(3 * wmax * sizeof(unsigned int));
+        sys->horiz = malloc(area * sizeof(unsigned int));
+        if (!cfg->Line || !sys->horiz) {
+            free(cfg->Line);
+            free(sys->horiz);
+            sys->slices = 1;
+            cfg->Line = NULL;
+            sys->horiz = NULL;
+        }
+        else
+            msg_Dbg(filter, "using %u slices", sys->slices);
     }
+    if (sys->slices <= 1) {
+        cfg->Line = malloc(wmax*sizeof(unsigned int));
+        if (!cfg->Line) {
+            free(sys);
+            return VLC_ENOMEM;
+        }
+    }
+    for (int i = 0; i < 3; ++i)
+        sys->line[i] = cfg->Line + ((sys->slices > 1) ? i * wmax : 0);
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
@@ -166,6 +192,143 @@ static int Open(vlc_object_t *this)
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Slice-threaded denoising
+ *****************************************************************************
+ * The horizontal low-pass only depends on the current line, while the
+ * vertical and temporal ones only depend on the current column. The former
+ * is thus computed first on line slices, and the latter then on column
+ * slices. This yields the exact same output as deNoise().
+ *****************************************************************************/
+typedef struct
+{
+    filter_sys_t *sys;
+    const picture_t *src;
+    picture_t *dst;
+    unsigned int *horiz[3];
+    int *coefs[3][3]; /* horizontal, vertical, temporal */
+} denoise_slices_t;
+
+static bool IsSpatial(int *const *coefs)
+{
+    return coefs[0][0] || coefs[1][0];
+}
+
+static void deNoiseLines(void *opaque, unsigned slice, unsigned count)
+{
+    const denoise_slices_t *ctx = opaque;
+    const filter_sys_t *sys = ctx->sys;
+
+    for (int i = 0; i < 3; i++) {
+        if (!IsSpatial(ctx->coefs[i]))
+            continue;
+
+        const int W = sys->w[i], H = sys->h[i];
+        const int sStride = ctx->src->p[i].i_pitch;
+        int *Horizontal = ctx->coefs[i][0];
+        /* deNoiseSpacial() filters the first line against its first pixel
+         * only: mimic it to keep the output identical */
+        const bool first_line_fixed = !ctx->coefs[i][2][0];
+
+        for (long Y = (long)H * slice / count;
+             Y < (long)H * (slice + 1) / count; Y++) {
+            const unsigned char *Frame = ctx->src->p[i].p_pixels + Y * sStride;
+            unsigned int *Horiz = ctx->horiz[i] + Y * W;
+            unsigned int PixelAnt = Horiz[0] = Frame[0]<<16;
+
+            if (Y == 0 && first_line_fixed) {
+                for (long X = 1; X < W; X++)
+                    Horiz[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+                continue;
+            }
+            for (long X = 1; X < W; X++)
+                Horiz[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16,
+                                                 Horizontal);
+        }
+    }
+}
+
+static void deNoiseColumns(void *opaque, unsigned slice, unsigned count)
+{
+    const denoise_slices_t *ctx = opaque;
+    const filter_sys_t *sys = ctx->sys;
+
+    for (int i = 0; i < 3; i++) {
+        const int W = sys->w[i], H = sys->h[i];
+        const int sStride = ctx->src->p[i].i_pitch;
+        const int dStride = ctx->dst->p[i].i_pitch;
+        const bool spatial = IsSpatial(ctx->coefs[i]);
+        int *Vertical = ctx->coefs[i][1];
+        int *Temporal = ctx->coefs[i][2];
+        unsigned int *LineAnt = sys->line[i];
+        unsigned short *FrameAnt = sys->cfg.Frame[i];
+        /* Align the column slices to limit false sharing */
+        const long X0 = ((long)W * slice / count) & ~15L;
+        const long X1 = (slice + 1 == count) ? W
+                      : (((long)W * (slice + 1) / count) & ~15L);
+
+        for (long Y = 0; Y < H; Y++) {
+            const unsigned char *Frame = ctx->src->p[i].p_pixels + Y * sStride;
+            unsigned char *FrameDest = ctx->dst->p[i].p_pixels + Y * dStride;
+            const unsigned int *Horiz = ctx->horiz[i] + Y * W;
+            unsigned short *LinePrev = FrameAnt + Y * W;
+
+            for (long X = X0; X < X1; X++) {
+                unsigned int PixelDst;
+
+                if (spatial) {
+                    LineAnt[X] = Y ? LowPassMul(LineAnt[X], Horiz[X], Vertical)
+                                   : Horiz[X];
+                    if (!Temporal[0]) {
+                        FrameDest[X] = ((LineAnt[X]+0x10007FFF)>>16);
+                        continue;
+                    }
+                    PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+                }
+                else
+                    PixelDst = LowPassMul(LinePrev[X]<<8, Frame[X]<<16,
+                                          Temporal);
+                LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+                FrameDest[X] = ((PixelDst+0x10007FFF)>>16);
+            }
+        }
+    }
+}
+
+static void deNoiseSlices(filter_t *filter, const picture_t *src,
+                          picture_t *dst)
+{
+    filter_sys_t *sys = filter->p_sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    denoise_slices_t ctx = { .sys = sys, .src = src, .dst = dst };
+    unsigned int *horiz = sys->horiz;
+
+    for (int i = 0; i < 3; i++) {
+        const int W = sys->w[i], H = sys->h[i];
+
+        if (!cfg->Frame[i]) {
+            unsigned short *FrameAnt = malloc(W*H*sizeof(unsigned short));
+            if (!FrameAnt)
+                return;
+            for (long Y = 0; Y < H; Y++) {
+                const unsigned char *line = src->p[i].p_pixels
+                                          + Y * src->p[i].i_pitch;
+                for (long X = 0; X < W; X++)
+                    FrameAnt[Y*W+X] = line[X]<<8;
+            }
+            cfg->Frame[i] = FrameAnt;
+        }
+
+        ctx.horiz[i] = horiz;
+        horiz += (size_t)W * H;
+        ctx.coefs[i][0] = ctx.coefs[i][1] = cfg->Coefs[i ? 2 : 0];
+        ctx.coefs[i][2] = cfg->Coefs[i ? 3 : 1];
+    }
+
+    vlc_slice_exec(filter, deNoiseLines, &ctx, sys->slices);
+    vlc_slice_exec(filter, deNoiseColumns, &ctx, sys->slices);
+}
+
 /*****************************************************************************
  * Close
  *****************************************************************************/
@@ -185,6 +348,7 @@ static void Close(vlc_object_t *this)
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
+    free(sys->horiz);
     free(cfg->Line);
     free(sys);
 }
@@ -221,24 +385,28 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    if (sys->slices > 1)
+        deNoiseSlices(filter, src, dst);
+    else {
+        deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
+                cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
+                src->p[0].i_pitch, dst->p[0].i_pitch,
+                cfg->Coefs[0],
+                cfg->Coefs[0],
+                cfg->Coefs[1]);
+        deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
+                cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
+                src->p[1].i_pitch, dst->p[1].i_pitch,
+                cfg->Coefs[2],
+                cfg->Coefs[2],
+                cfg->Coefs[3]);
+        deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
+                cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
+                src->p[2].i_pitch, dst->p[2].i_pitch,
+                cfg->Coefs[2],
+                cfg->Coefs[2],
+                cfg->Coefs[3]);
+    }
 
     if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
     {
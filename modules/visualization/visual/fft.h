@@ -1,5 +1,5 @@
 /*****************************************************************************
- * fft.h: Headers for iterative implementation of a FFT
+ * fft.h: Spectrum of sound samples
  *****************************************************************************
  * $Id$
  *
@@ -33,17 +33,12 @@
 typedef short int sound_sample;
 
 struct _struct_fft_state {
-     /* Temporary data stores to perform FFT in. */
-     float real[FFT_BUFFER_SIZE];
-     float imag[FFT_BUFFER_SIZE];
-
-     /* */
-     unsigned int bitReverse[FFT_BUFFER_SIZE];
+     struct vlc_fft *fft;
 
-     /* The next two tables could be made to use less space in memory, since they
-      * overlap hugely, but hey. */
-     float sintable[FFT_BUFFER_SIZE / 2];
-     float costable[FFT_BUFFER_SIZE / 2];
+     /* Temporary data stores to perform FFT in. */
+     float input[FFT_BUFFER_SIZE];
+     float real[FFT_BUFFER_SIZE / 2 + 1];
+     float imag[FFT_BUFFER_SIZE / 2 + 1];
 };
 
 /* FFT prototypes */
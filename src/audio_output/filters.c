@@ -42,16 +42,186 @@
 #include <libvlc.h>
 #include "aout_internal.h"
 
+/* Number of idle output buffers kept for reuse (ping-pong) */
+#define AOUT_POOL_SIZE 2
+/* Alignment of pooled buffers, suitable for SIMD */
+#define AOUT_POOL_ALIGN 32
+/* Target size of the slices filtered through the whole pipeline at once */
+#define AOUT_SLICE_SIZE 16384
+/* Blocks are not sliced in less than this many frames */
+#define AOUT_SLICE_MIN_FRAMES 256
+
+/**
+ * Pool of output buffers shared by the filters of a chain.
+ *
+ * Audio blocks are allocated, filled and released at the same rate, so a
+ * couple of idle buffers are enough to serve most allocations. Buffers are
+ * allocated with the requested size, and only reused for requests that fit.
+ * Blocks can outlive the pool, e.g. in the audio output.
+ */
+typedef struct aout_buffer_pool
+{
+    vlc_mutex_t lock;
+    unsigned    refs; /**< owner and outstanding blocks */
+    bool        dead;
+    unsigned    count;
+    block_t    *free[AOUT_POOL_SIZE];
+} aout_buffer_pool_t;
+
+typedef struct
+{
+    block_t self;
+    aout_buffer_pool_t *pool;
+    size_t capacity;
+} aout_pool_block_t;
+
+static aout_buffer_pool_t *aout_BufferPoolNew (void)
+{
+    aout_buffer_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->dead = false;
+    pool->count = 0;
+    return pool;
+}
+
+static void aout_BufferPoolUnref (aout_buffer_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+    {
+        vlc_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
+
+static void aout_BufferPoolDelete (aout_buffer_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    pool->dead = true;
+    while (pool->count > 0)
+        free (pool->free[--pool->count]);
+    vlc_mutex_unlock (&pool->lock);
+    aout_BufferPoolUnref (pool);
+}
+
+static void aout_PoolBlockRelease (block_t *block)
+{
+    aout_pool_block_t *pb = (aout_pool_block_t *)block;
+    aout_buffer_pool_t *pool = pb->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (!pool->dead)
+    {
+        if (pool->count < AOUT_POOL_SIZE)
+        {
+            pool->free[pool->count++] = block;
+            block = NULL;
+        }
+        else
+        {   /* Keep the largest buffers, the others may be too small */
+            unsigned smallest = 0;
+            for (unsigned i = 1; i < pool->count; i++)
+                if (((aout_pool_block_t *)pool->free[i])->capacity
+                  < ((aout_pool_block_t *)pool->free[smallest])->capacity)
+                    smallest = i;
+
+            block_t *idle = pool->free[smallest];
+            if (((aout_pool_block_t *)idle)->capacity < pb->capacity)
+            {
+                pool->free[smallest] = block;
+                block = idle;
+            }
+        }
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    free (block);
+    aout_BufferPoolUnref (pool);
+}
+
+static block_t *aout_BufferPoolGet (aout_buffer_pool_t *pool, size_t size)
+{
+    aout_pool_block_t *pb = NULL;
+
+    vlc_mutex_lock (&pool->lock);
+    /* Reuse the smallest idle buffer that fits */
+    unsigned best = pool->count;
+    for (unsigned i = 0; i < pool->count; i++)
+    {
+        aout_pool_block_t *cand = (aout_pool_block_t *)pool->free[i];
+        if (cand->capacity >= size
+         && (best == pool->count || cand->capacity
+                       < ((aout_pool_block_t *)pool->free[best])->capacity))
+            best = i;
+    }
+    if (best < pool->count)
+    {
+        pb = (aout_pool_block_t *)pool->free[best];
+        pool->free[best] = pool->free[--pool->count];
+    }
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (pb == NULL)
+    {
+        pb = malloc (sizeof (*pb) + AOUT_POOL_ALIGN - 1 + size);
+        if (unlikely(pb == NULL))
+        {
+            aout_BufferPoolUnref (pool);
+            return NULL;
+        }
+        pb->pool = pool;
+        pb->capacity = size;
+    }
+
+    uint8_t *buf = (uint8_t *)(pb + 1);
+    buf += (-(uintptr_t)buf) & (AOUT_POOL_ALIGN - 1);
+    block_Init (&pb->self, buf, pb->capacity);
+    pb->self.i_buffer = size;
+    pb->self.pf_release = aout_PoolBlockRelease;
+    return &pb->self;
+}
+
+/** Filter with its owner data */
+typedef struct
+{
+    filter_t filter;
+    aout_buffer_pool_t *pool; /**< output buffers (or NULL) */
+} aout_filter_priv_t;
+
+static aout_buffer_pool_t *aout_FilterPool (filter_t *filter)
+{
+    return ((aout_filter_priv_t *)filter)->pool;
+}
+
+static block_t *aout_FilterNewBuffer (filter_t *filter, size_t size)
+{
+    aout_buffer_pool_t *pool = aout_FilterPool (filter);
+
+    return (pool != NULL) ? aout_BufferPoolGet (pool, size)
+                          : block_Alloc (size);
+}
+
 static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
                                const char *name, filter_owner_sys_t *owner,
                                const audio_sample_format_t *infmt,
                                const audio_sample_format_t *outfmt)
 {
-    filter_t *filter = vlc_custom_create (obj, sizeof (*filter), type);
-    if (unlikely(filter == NULL))
+    aout_filter_priv_t *priv = vlc_custom_create (obj, sizeof (*priv), type);
+    if (unlikely(priv == NULL))
         return NULL;
 
+    filter_t *filter = &priv->filter;
+    priv->pool = NULL;
     filter->owner.sys = owner;
+    filter->owner.audio.buffer_new = aout_FilterNewBuffer;
     filter->fmt_in.audio = *infmt;
     filter->fmt_in.i_codec = infmt->i_format;
     filter->fmt_out.audio = *outfmt;
@@ -252,12 +422,11 @@ error:
 }
 
 /**
- * Filters an audio buffer through a chain of filters.
+ * Filters an audio buffer through each filter of a chain in turn.
  */
-static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
-                                         unsigned count, block_t *block)
+static block_t *aout_FiltersPipelineRun(filter_t *const *filters,
+                                        unsigned count, block_t *block)
 {
-    /* TODO: use filter chain */
     for (unsigned i = 0; (i < count) && (block != NULL); i++)
     {
         filter_t *filter = filters[i];
@@ -269,6 +438,125 @@ static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
     return block;
 }
 
+/**
+ * Computes how many frames can go through a chain of filters while the
+ * intermediate buffers remain in the CPU cache.
+ * \return the slice length in frames, or 0 if the chain cannot be sliced
+ */
+static unsigned aout_FiltersPipelineSlice(filter_t *const *filters,
+                                          unsigned count)
+{
+    unsigned frame = 0;
+
+    if (count < 2)
+        return 0; /* nothing to gain */
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const audio_format_t *in = &filters[i]->fmt_in.audio;
+        const audio_format_t *out = &filters[i]->fmt_out.audio;
+
+        if (!AOUT_FMT_LINEAR(in) || !AOUT_FMT_LINEAR(out)
+         || in->i_bytes_per_frame == 0 || out->i_bytes_per_frame == 0)
+            return 0;
+        /* Take resampling into account, in the worst case */
+        unsigned bytes = out->i_bytes_per_frame;
+        if (out->i_rate > in->i_rate && in->i_rate > 0)
+            bytes = (uint64_t)bytes * out->i_rate / in->i_rate;
+        frame = __MAX(frame, __MAX(in->i_bytes_per_frame, bytes));
+    }
+    return __MAX(AOUT_SLICE_SIZE / frame, AOUT_SLICE_MIN_FRAMES);
+}
+
+/**
+ * Concatenates the filtered slices of a block.
+ */
+static block_t *aout_FiltersPipelineGather(aout_buffer_pool_t *pool,
+                                           block_t *chain)
+{
+    if (chain == NULL || chain->p_next == NULL)
+        return chain;
+    if (pool == NULL)
+        return block_ChainGather (chain);
+
+    size_t size;
+    unsigned samples = 0;
+    mtime_t length;
+
+    block_ChainProperties (chain, NULL, &size, &length);
+    for (block_t *b = chain; b != NULL; b = b->p_next)
+        samples += b->i_nb_samples;
+
+    block_t *out = aout_BufferPoolGet (pool, size);
+    if (unlikely(out == NULL))
+    {
+        block_ChainRelease (chain);
+        return NULL;
+    }
+
+    block_CopyProperties (out, chain);
+    block_ChainExtract (chain, out->p_buffer, size);
+    out->i_nb_samples = samples;
+    out->i_length = length;
+    block_ChainRelease (chain);
+    return out;
+}
+
+/**
+ * Filters an audio buffer through a chain of filters.
+ *
+ * Large buffers are cut in slices, and each slice goes through the whole
+ * chain before the next one, so that the intermediate buffers of
+ * converters, remixers, effects and resamplers stay in the CPU cache.
+ */
+static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
+                                         unsigned count, block_t *block)
+{
+    if (block == NULL)
+        return NULL;
+
+    const unsigned slice = aout_FiltersPipelineSlice (filters, count);
+    const unsigned frame = (slice > 0)
+                         ? filters[0]->fmt_in.audio.i_bytes_per_frame : 0;
+    const unsigned total = block->i_nb_samples;
+
+    if (slice == 0 || total < 2 * slice
+     || block->i_buffer != (size_t)total * frame)
+        return aout_FiltersPipelineRun (filters, count, block);
+
+    aout_buffer_pool_t *pool = aout_FilterPool (filters[0]);
+    block_t *chain = NULL, **pp_last = &chain;
+
+    for (unsigned done = 0; done < total;)
+    {
+        const unsigned n = __MIN(slice, total - done);
+        block_t *in = aout_FilterNewBuffer (filters[0], (size_t)n * frame);
+        if (unlikely(in == NULL))
+            break;
+
+        const mtime_t start = block->i_length * done / total;
+        const mtime_t end = block->i_length * (done + n) / total;
+
+        memcpy (in->p_buffer, block->p_buffer + (size_t)done * frame,
+                (size_t)n * frame);
+        in->i_nb_samples = n;
+        in->i_flags = (done == 0) ? block->i_flags : 0;
+        in->i_pts = (block->i_pts > VLC_TS_INVALID) ? block->i_pts + start
+                                                     : block->i_pts;
+        in->i_dts = (block->i_dts > VLC_TS_INVALID) ? block->i_dts + start
+                                                     : block->i_dts;
+        in->i_length = end - start;
+        done += n;
+
+        in = aout_FiltersPipelineRun (filters, count, in);
+        if (in != NULL)
+            block_ChainLastAppend (&pp_last, in);
+    }
+    block_Release (block);
+
+    return aout_FiltersPipelineGather (pool, chain);
+}
+
 
 /**
  * Drain the chain of filters.
@@ -316,6 +604,8 @@ static void aout_FiltersPipelineFlush(filter_t *const *filters,
 
 struct aout_filters
 {
+    aout_buffer_pool_t *pool; /**< Output buffers of the filters */
+
     filter_t *rate_filter; /**< The filter adjusting samples count
         (either the scaletempo filter or a resampler) */
     filter_t *resampler; /**< The resampler */
@@ -407,6 +697,17 @@ static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
     return 0;
 }
 
+/**
+ * Lets all filters of a chain allocate their output buffers from its pool.
+ */
+static void aout_FiltersSetPool (aout_filters_t *filters)
+{
+    for (unsigned i = 0; i < filters->count; i++)
+        ((aout_filter_priv_t *)filters->tab[i])->pool = filters->pool;
+    if (filters->resampler != NULL)
+        ((aout_filter_priv_t *)filters->resampler)->pool = filters->pool;
+}
+
 #undef aout_FiltersNew
 /**
  * Sets a chain of audio filters up.
@@ -431,6 +732,12 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     if (unlikely(filters == NULL))
         return NULL;
 
+    filters->pool = aout_BufferPoolNew ();
+    if (unlikely(filters->pool == NULL))
+    {
+        free (filters);
+        return NULL;
+    }
     filters->rate_filter = NULL;
     filters->resampler = NULL;
     filters->resampling = 0;
@@ -459,6 +766,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
             }
             filters->count++;
         }
+        aout_FiltersSetPool (filters);
         return filters;
     }
     if (aout_FormatNbChannels(infmt) == 0 || aout_FormatNbChannels(outfmt) == 0)
@@ -519,12 +827,14 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     if (filters->rate_filter == NULL)
         filters->rate_filter = filters->resampler;
 
+    aout_FiltersSetPool (filters);
     return filters;
 
 error:
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (request_vout != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+    aout_BufferPoolDelete (filters->pool);
     free (filters);
     return NULL;
 }
@@ -545,6 +855,7 @@ void aout_FiltersDelete (vlc_object_t *obj, aout_filters_t *filters)
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (obj != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+    aout_BufferPoolDelete (filters->pool);
     free (filters);
 }
 
@@ -99,6 +99,13 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Rate (in 1/256) at which the pts_delay is lowered toward a smaller
+ * target, the outputs absorb it as a slight speed up */
+#define CR_DELAY_SLEW_RATE (2)
+
+/* Minimal safety margin kept above the measured arrival jitter */
+#define CR_JITTER_MARGIN (CLOCK_FREQ/100)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -138,6 +145,11 @@ static inline clock_point_t clock_point_Create( mtime_t i_stream, mtime_t i_syst
 /* */
 #define INPUT_CLOCK_LATE_COUNT (3)
 
+/* Arrival delays are recorded as the worst one of each period, the
+ * statistics then cover INPUT_CLOCK_ARRIVAL_COUNT periods (12.8s) */
+#define INPUT_CLOCK_ARRIVAL_COUNT (256)
+#define INPUT_CLOCK_ARRIVAL_PERIOD (CLOCK_FREQ/20)
+
 /* */
 struct input_clock_t
 {
@@ -165,6 +177,21 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Arrival statistics
+     * Delays of the clock references relative to the reference point */
+    struct
+    {
+        mtime_t  pi_value[INPUT_CLOCK_ARRIVAL_COUNT];
+        unsigned i_index;
+        unsigned i_count;
+        mtime_t  i_period_end;
+
+        /* Percentiles, updated once per period */
+        mtime_t  i_median;
+        mtime_t  i_high;
+        mtime_t  i_max;
+    } arrival;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
@@ -177,6 +204,7 @@ struct input_clock_t
     bool    b_paused;
     int     i_rate;
     mtime_t i_pts_delay;
+    mtime_t i_pts_delay_target;
     mtime_t i_pause_date;
 };
 
@@ -185,6 +213,9 @@ static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
 
+static void    ArrivalReset( input_clock_t * );
+static void    ArrivalUpdate( input_clock_t *, mtime_t i_system, mtime_t i_delay );
+
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
@@ -212,8 +243,11 @@ input_clock_t *input_clock_New( int i_rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    ArrivalReset( cl );
+
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
+    cl->i_pts_delay_target = 0;
     cl->b_paused = false;
     cl->i_pause_date = VLC_TS_INVALID;
 
@@ -272,6 +306,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        ArrivalReset( cl );
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -309,12 +344,25 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     }
     //fprintf( stderr, "input_clock_Update: %d :: %lld\n", b_buffering_allowed, cl->i_buffering_duration/1000 );
 
+    /* Lower the pts_delay progressively toward its target */
+    if( cl->i_pts_delay > cl->i_pts_delay_target &&
+        !b_reset_reference && cl->last.i_system > VLC_TS_INVALID )
+    {
+        const mtime_t i_step = __MAX( i_ck_system - cl->last.i_system, 0 ) *
+                               CR_DELAY_SLEW_RATE / 256;
+
+        cl->i_pts_delay = __MAX( cl->i_pts_delay - i_step,
+                                 cl->i_pts_delay_target );
+    }
+
     /* */
     cl->last = clock_point_Create( i_ck_stream, i_ck_system );
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
     const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    ArrivalUpdate( cl, i_ck_system, i_ck_system - i_system_expected );
+
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
     if( i_late > 0 )
@@ -543,7 +591,7 @@ void input_clock_SetJitter( input_clock_t *cl,
     vlc_mutex_lock( &cl->lock );
 
     /* Update late observations */
-    const mtime_t i_delay_delta = i_pts_delay - cl->i_pts_delay;
+    const mtime_t i_delay_delta = __MAX( i_pts_delay - cl->i_pts_delay, 0 );
     mtime_t pi_late[INPUT_CLOCK_LATE_COUNT];
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         pi_late[i] = __MAX( cl->late.pi_value[(cl->late.i_index + 1 + i)%INPUT_CLOCK_LATE_COUNT] - i_delay_delta, 0 );
@@ -560,9 +608,11 @@ void input_clock_SetJitter( input_clock_t *cl,
         cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
     }
 
-    /* TODO always save the value, and when rebuffering use the new one if smaller
+    /* The pts_delay is increased at once, but lowered progressively by
+     * input_clock_Update to avoid a discontinuity in the outputs
      * TODO when increasing -> force rebuffering
      */
+    cl->i_pts_delay_target = i_pts_delay;
     if( cl->i_pts_delay < i_pts_delay )
         cl->i_pts_delay = i_pts_delay;
 
@@ -586,8 +636,8 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     /* Find the median of the last late values
      * It works pretty well at rejecting bad values
      *
-     * XXX we only increase pts_delay over time, decreasing it is
-     * not that easy if we want to be robust.
+     * XXX it only estimates an increase of the pts_delay, decreasing it
+     * relies on the arrival statistics (see input_clock_GetStats).
      */
     const mtime_t *p = cl->late.pi_value;
     mtime_t i_late_median = p[0] + p[1] + p[2] - __MIN(__MIN(p[0],p[1]),p[2]) - __MAX(__MAX(p[0],p[1]),p[2]);
@@ -598,6 +648,29 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_GetStats( input_clock_t *cl, input_clock_stats_t *p_stats )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    p_stats->i_latency = cl->i_pts_delay;
+    p_stats->i_jitter = 0;
+    p_stats->i_pts_delay = 0;
+
+    if( cl->arrival.i_count > 0 )
+        p_stats->i_jitter = cl->arrival.i_high - cl->arrival.i_median;
+
+    /* Only trust a full window for the pts_delay estimation, and use its
+     * worst value as an underestimation costs a rebufferization */
+    if( cl->arrival.i_count >= INPUT_CLOCK_ARRIVAL_COUNT )
+    {
+        const mtime_t i_max = __MAX( cl->arrival.i_max, 0 );
+
+        p_stats->i_pts_delay = i_max + __MAX( i_max / 4, CR_JITTER_MARGIN );
+    }
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -631,6 +704,59 @@ static mtime_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+/*****************************************************************************
+ * Arrival statistics helpers
+ *****************************************************************************/
+static void ArrivalReset( input_clock_t *cl )
+{
+    cl->arrival.i_index = INPUT_CLOCK_ARRIVAL_COUNT - 1;
+    cl->arrival.i_count = 0;
+    cl->arrival.i_period_end = VLC_TS_INVALID;
+    cl->arrival.i_median = 0;
+    cl->arrival.i_high = 0;
+    cl->arrival.i_max = 0;
+}
+
+static int ArrivalCompare( const void *a, const void *b )
+{
+    const mtime_t i_a = *(const mtime_t *)a;
+    const mtime_t i_b = *(const mtime_t *)b;
+
+    return ( i_a > i_b ) - ( i_a < i_b );
+}
+
+static void ArrivalUpdate( input_clock_t *cl, mtime_t i_system, mtime_t i_delay )
+{
+    /* Keep the worst delay of the current period */
+    if( cl->arrival.i_count > 0 && i_system < cl->arrival.i_period_end )
+    {
+        mtime_t *p_value = &cl->arrival.pi_value[cl->arrival.i_index];
+        if( *p_value < i_delay )
+            *p_value = i_delay;
+        return;
+    }
+
+    /* The previous period is complete, update the percentiles */
+    const unsigned i_count = cl->arrival.i_count;
+    if( i_count > 0 )
+    {
+        mtime_t pi_sorted[INPUT_CLOCK_ARRIVAL_COUNT];
+
+        memcpy( pi_sorted, cl->arrival.pi_value, i_count * sizeof(*pi_sorted) );
+        qsort( pi_sorted, i_count, sizeof(*pi_sorted), ArrivalCompare );
+
+        cl->arrival.i_median = pi_sorted[(i_count - 1) / 2];
+        cl->arrival.i_high = pi_sorted[(i_count - 1) * 99 / 100];
+        cl->arrival.i_max = pi_sorted[i_count - 1];
+    }
+
+    cl->arrival.i_index = ( cl->arrival.i_index + 1 ) % INPUT_CLOCK_ARRIVAL_COUNT;
+    cl->arrival.pi_value[cl->arrival.i_index] = i_delay;
+    if( cl->arrival.i_count < INPUT_CLOCK_ARRIVAL_COUNT )
+        cl->arrival.i_count++;
+    cl->arrival.i_period_end = i_system + INPUT_CLOCK_ARRIVAL_PERIOD;
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
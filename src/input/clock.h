@@ -126,14 +126,33 @@ int input_clock_GetState( input_clock_t *,
 
 /**
  * This function allows the set the minimal configuration for the jitter estimation algo.
+ * A lower pts_delay is not applied at once but reached progressively.
  */
 void input_clock_SetJitter( input_clock_t *,
                             mtime_t i_pts_delay, int i_cr_average );
 
 /**
  * This function returns an estimation of the pts_delay needed to avoid rebufferization.
- * XXX in the current implementation, the pts_delay will never be decreased.
+ * XXX it never returns a value lower than the current pts_delay, see
+ * input_clock_GetStats for that.
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * Clock references arrival statistics
+ */
+typedef struct
+{
+    mtime_t i_latency;   /**< current pts_delay */
+    mtime_t i_jitter;    /**< spread between the median and the 99th
+                              percentile of the arrival delays */
+    mtime_t i_pts_delay; /**< pts_delay absorbing the arrival jitter, 0 if
+                              not enough references were received yet */
+} input_clock_stats_t;
+
+/**
+ * This function returns the arrival statistics of the last clock references.
+ */
+void    input_clock_GetStats( input_clock_t *, input_clock_stats_t * );
+
 #endif
@@ -96,6 +96,12 @@ struct decoder_owner_sys_t
 
     /* fifo */
     block_fifo_t *p_fifo;
+    /* Timestamps of the last queued and of the next dequeued blocks,
+     * protected by the FIFO lock */
+    mtime_t i_fifo_in_ts;
+    mtime_t i_fifo_out_ts;
+    mtime_t i_fifo_high;
+    mtime_t i_fifo_low;
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -146,6 +152,14 @@ struct decoder_owner_sys_t
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((mtime_t)(DEFAULT_PTS_DELAY * 30))
 
+/* Limits of the decoder FIFO when the input cannot be paced: beyond them,
+ * the demuxer is held back for a while, then the oldest blocks are dropped */
+#define DECODER_FIFO_MAX_DURATION                (60 * CLOCK_FREQ)
+#define DECODER_FIFO_MAX_SIZE                    (400*1024*1024)
+#define DECODER_FIFO_BACKPRESSURE                (CLOCK_FREQ / 10)
+/* Pacing limit used when the blocks have no timestamps */
+#define DECODER_FIFO_MAX_COUNT                   10
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
@@ -1341,6 +1355,15 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
         return;
     }
 #endif
+    if( p_block != NULL )
+    {
+        /* Decoders may modify their input in place, but the payload can be
+         * shared with the stream output (see EsOutSend()) */
+        p_block = block_Unshare( p_block );
+        if( unlikely(p_block == NULL) )
+            return;
+    }
+
     if( packetize )
     {
         block_t *p_packetized_block;
@@ -1445,6 +1468,71 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+static mtime_t DecoderFifoTimestamp( const block_t *p_block )
+{
+    return p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : p_block->i_pts;
+}
+
+/**
+ * Gets the duration of the data in the FIFO, -1 if unknown.
+ * The FIFO must be locked.
+ */
+static mtime_t DecoderFifoDuration( decoder_owner_sys_t *p_owner )
+{
+    if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        return 0;
+    if( p_owner->i_fifo_in_ts <= VLC_TS_INVALID
+     || p_owner->i_fifo_out_ts <= VLC_TS_INVALID )
+        return -1;
+    /* Discontinuities can make it negative until the next block is
+     * dequeued: ignore them */
+    return __MAX( p_owner->i_fifo_in_ts - p_owner->i_fifo_out_ts, 0 );
+}
+
+/**
+ * Dequeues a block and updates the FIFO duration.
+ * The FIFO must be locked.
+ */
+static block_t *DecoderFifoDequeue( decoder_owner_sys_t *p_owner )
+{
+    block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+
+    if( p_block != NULL )
+    {
+        mtime_t ts = DecoderFifoTimestamp( p_block );
+        if( ts > VLC_TS_INVALID )
+            p_owner->i_fifo_out_ts = ts;
+    }
+    return p_block;
+}
+
+/**
+ * Checks whether the paced FIFO is above the high watermark, or with
+ * b_resume, still above the low watermark.
+ * The FIFO must be locked.
+ */
+static bool DecoderFifoIsFull( decoder_owner_sys_t *p_owner, bool b_resume )
+{
+    mtime_t i_duration = DecoderFifoDuration( p_owner );
+
+    if( i_duration < 0 )
+        return vlc_fifo_GetCount( p_owner->p_fifo ) >= DECODER_FIFO_MAX_COUNT;
+    if( vlc_fifo_GetCount( p_owner->p_fifo ) < 2 )
+        return false;
+    return i_duration >= (b_resume ? p_owner->i_fifo_low
+                                   : p_owner->i_fifo_high);
+}
+
+/**
+ * Checks whether the non-paced FIFO holds too much data.
+ * The FIFO must be locked.
+ */
+static bool DecoderFifoIsOverflowing( decoder_owner_sys_t *p_owner )
+{
+    return vlc_fifo_GetBytes( p_owner->p_fifo ) > DECODER_FIFO_MAX_SIZE
+        || DecoderFifoDuration( p_owner ) > DECODER_FIFO_MAX_DURATION;
+}
+
 /**
  * The decoding main loop
  *
@@ -1514,7 +1602,7 @@ static void *DecoderThread( void *p_data )
         vlc_cond_signal( &p_owner->wait_fifo );
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        block_t *p_block = DecoderFifoDequeue( p_owner );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
@@ -1625,6 +1713,14 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_release( p_dec );
         return NULL;
     }
+    p_owner->i_fifo_in_ts = VLC_TS_INVALID;
+    p_owner->i_fifo_out_ts = VLC_TS_INVALID;
+    p_owner->i_fifo_high = var_InheritInteger( p_dec, "decoder-fifo-high" )
+                         * (CLOCK_FREQ / 1000);
+    p_owner->i_fifo_low = var_InheritInteger( p_dec, "decoder-fifo-low" )
+                        * (CLOCK_FREQ / 1000);
+    if( p_owner->i_fifo_low > p_owner->i_fifo_high )
+        p_owner->i_fifo_low = p_owner->i_fifo_high;
 
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
@@ -1953,25 +2049,58 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
-        /* FIXME: ideally we would check the time amount of data
-         * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
-        {
-            msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
-                      "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+        if( DecoderFifoIsOverflowing( p_owner ) )
+        {   /* Hold the demuxer back to let the decoder catch up, but not
+             * for long: the input cannot wait and the decoder may be paused
+             * or stuck. */
+            mtime_t deadline = mdate() + DECODER_FIFO_BACKPRESSURE;
+
+            /* paused is written with the FIFO locked, and the wait is
+             * interrupted by input_DecoderChangePause() */
+            while( !p_owner->b_waiting && !p_owner->paused
+                && DecoderFifoIsOverflowing( p_owner )
+                && vlc_fifo_TimedWaitCond( p_owner->p_fifo,
+                                           &p_owner->wait_fifo, deadline ) == 0 );
+
+            if( DecoderFifoIsOverflowing( p_owner ) )
+            {
+                msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
+                          "consumed quickly enough), dropping old data!" );
+                do
+                    block_Release( DecoderFifoDequeue( p_owner ) );
+                while( !vlc_fifo_IsEmpty( p_owner->p_fifo )
+                    && ( DecoderFifoIsOverflowing( p_owner )
+                      || DecoderFifoDuration( p_owner ) > p_owner->i_fifo_high ) );
+
+                /* Signal the gap to the decoder (or packetizer) */
+                block_t *p_first = vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo );
+                if( p_first != NULL )
+                {
+                    p_first->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+                    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_first );
+                }
+                else
+                    p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            }
         }
     }
     else
-    if( !p_owner->b_waiting )
+    if( !p_owner->b_waiting && DecoderFifoIsFull( p_owner, false ) )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        do
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        while( DecoderFifoIsFull( p_owner, true ) );
     }
 
+    mtime_t ts = DecoderFifoTimestamp( p_block );
+    if( ts > VLC_TS_INVALID )
+    {
+        if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+            p_owner->i_fifo_out_ts = ts;
+        p_owner->i_fifo_in_ts = ts;
+    }
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
@@ -2034,6 +2163,8 @@ void input_DecoderFlush( decoder_t *p_dec )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    p_owner->i_fifo_in_ts = VLC_TS_INVALID;
+    p_owner->i_fifo_out_ts = VLC_TS_INVALID;
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2147,6 +2278,8 @@ void input_DecoderChangePause( decoder_t *p_dec, bool b_paused, mtime_t i_date )
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
     vlc_fifo_Signal( p_owner->p_fifo );
+    /* Do not hold the input back for a decoder that stopped consuming */
+    vlc_cond_broadcast( &p_owner->wait_fifo );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
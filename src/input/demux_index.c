@@ -0,0 +1,382 @@
+/*****************************************************************************
+ * demux_index.c: persistent demuxer index cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_configuration.h>
+
+/* Cache file layout, all integers little endian:
+ *  - magic (8 bytes)
+ *  - key length (4 bytes), key (path, size, modification time and name)
+ *  - entry count (8 bytes)
+ *  - entries (ENTRY_SIZE bytes each)
+ */
+static const char magic[8] = "VLCIDX\x00\x01";
+
+#define ENTRY_SIZE 28
+
+/* Cached tables are rejected beyond that size */
+#define MAX_ENTRIES (UINT64_C(1) << 26)
+
+/* Bounds of the whole cache: tables older than MAX_AGE are removed, then
+ * the oldest ones until the total is below MAX_CACHE_SIZE */
+#define MAX_AGE (30 * 24 * 3600) /* seconds */
+#define MAX_CACHE_SIZE (UINT64_C(64) << 20) /* bytes */
+
+/**
+ * Builds the key identifying a version of a local file.
+ */
+static char *IndexKey(demux_t *demux, const char *name)
+{
+    const char *path = demux->psz_file;
+    struct stat st;
+    char *key;
+
+    if (path == NULL || !var_InheritBool(demux, "demux-index-cache"))
+        return NULL;
+    if (vlc_stat(path, &st) || !S_ISREG(st.st_mode))
+        return NULL;
+
+    if (asprintf(&key, "%s\n%"PRIu64"\n%"PRId64"\n%s", path,
+                 (uint64_t)st.st_size, (int64_t)st.st_mtime, name) == -1)
+        return NULL;
+    return key;
+}
+
+static void IndexCreateDir(const char *dir)
+{
+    char *psz = strdup(dir);
+    if (psz == NULL)
+        return;
+
+    /* Create the parent directories first */
+    for (char *p = psz + 1; *p != '\0'; p++)
+    {
+        if (*p != DIR_SEP_CHAR)
+            continue;
+        *p = '\0';
+        vlc_mkdir(psz, 0700);
+        *p = DIR_SEP_CHAR;
+    }
+    vlc_mkdir(psz, 0700);
+    free(psz);
+}
+
+static char *IndexDir(bool create)
+{
+    char *cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    if (cachedir == NULL)
+        return NULL;
+
+    char *dir;
+    if (asprintf(&dir, "%s" DIR_SEP "index", cachedir) == -1)
+        dir = NULL;
+    free(cachedir);
+
+    if (dir != NULL && create)
+        IndexCreateDir(dir);
+    return dir;
+}
+
+/**
+ * Gets the path of the cache file for an index of a local file.
+ *
+ * Only the file path and the index name are hashed, so that the table of
+ * an older version of the file is overwritten rather than left behind.
+ */
+static char *IndexPath(const char *dir, demux_t *demux, const char *name)
+{
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, demux->psz_file, strlen(demux->psz_file));
+    AddMD5(&md5, "\n", 1);
+    AddMD5(&md5, name, strlen(name));
+    EndMD5(&md5);
+
+    char *hash = psz_md5_hash(&md5);
+    char *path;
+    if (hash == NULL
+     || asprintf(&path, "%s" DIR_SEP "%s.idx", dir, hash) == -1)
+        path = NULL;
+    free(hash);
+    return path;
+}
+
+typedef struct
+{
+    char    *path;
+    time_t   mtime;
+    uint64_t size;
+} index_file_t;
+
+static int IndexFileCmp(const void *a, const void *b)
+{
+    const index_file_t *fa = a, *fb = b;
+
+    return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/**
+ * Removes old cached tables, keeping the one just saved.
+ */
+static void IndexPrune(demux_t *demux, const char *dir, const char *keep)
+{
+    DIR *handle = vlc_opendir(dir);
+    if (handle == NULL)
+        return;
+
+    index_file_t *files = NULL;
+    size_t count = 0;
+    uint64_t total = 0;
+    unsigned removed = 0;
+    const time_t now = time(NULL);
+    const char *filename;
+
+    while ((filename = vlc_readdir(handle)) != NULL)
+    {
+        size_t len = strlen(filename);
+        if (len < 4 || strcmp(filename + len - 4, ".idx"))
+            continue;
+
+        char *path;
+        struct stat st;
+        if (asprintf(&path, "%s" DIR_SEP "%s", dir, filename) == -1)
+            continue;
+        if (!strcmp(path, keep) || vlc_stat(path, &st)
+         || !S_ISREG(st.st_mode))
+        {
+            free(path);
+            continue;
+        }
+
+        if (now - st.st_mtime > MAX_AGE)
+        {
+            vlc_unlink(path);
+            free(path);
+            removed++;
+            continue;
+        }
+
+        index_file_t *tab = realloc(files, (count + 1) * sizeof (*files));
+        if (unlikely(tab == NULL))
+        {
+            free(path);
+            break;
+        }
+        files = tab;
+        files[count].path = path;
+        files[count].mtime = st.st_mtime;
+        files[count].size = st.st_size;
+        total += st.st_size;
+        count++;
+    }
+    closedir(handle);
+
+    struct stat st;
+    if (vlc_stat(keep, &st) == 0)
+        total += st.st_size;
+
+    if (count > 0 && total > MAX_CACHE_SIZE)
+        qsort(files, count, sizeof (*files), IndexFileCmp);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (total > MAX_CACHE_SIZE)
+        {
+            vlc_unlink(files[i].path);
+            total -= files[i].size;
+            removed++;
+        }
+        free(files[i].path);
+    }
+    free(files);
+
+    if (removed > 0)
+        msg_Dbg(demux, "removed %u old cached index(es)", removed);
+}
+
+int demux_IndexLoad(demux_t *demux, const char *name,
+                    demux_index_entry_t **pp_entries, size_t *pi_count)
+{
+    char *key = IndexKey(demux, name);
+    if (key == NULL)
+        return VLC_EGENERIC;
+
+    char *dir = IndexDir(false);
+    char *path = (dir != NULL) ? IndexPath(dir, demux, name) : NULL;
+    FILE *file = (path != NULL) ? vlc_fopen(path, "rb") : NULL;
+    free(dir);
+    if (file == NULL)
+    {
+        free(path);
+        free(key);
+        return VLC_EGENERIC;
+    }
+
+    int ret = VLC_EGENERIC;
+    demux_index_entry_t *entries = NULL;
+    const size_t keylen = strlen(key);
+    uint8_t hdr[12];
+    char *filekey = NULL;
+    bool stale = false;
+
+    if (fread(hdr, 1, sizeof (hdr), file) != sizeof (hdr)
+     || memcmp(hdr, magic, sizeof (magic)))
+        goto out;
+    if (GetDWLE(&hdr[8]) != keylen)
+    {
+        stale = true;
+        goto out;
+    }
+
+    /* The table may be for another version of the file */
+    filekey = malloc(keylen);
+    if (filekey == NULL || fread(filekey, 1, keylen, file) != keylen)
+        goto out;
+    if (memcmp(filekey, key, keylen))
+    {
+        stale = true;
+        goto out;
+    }
+
+    if (fread(hdr, 1, 8, file) != 8)
+        goto out;
+
+    uint64_t count = GetQWLE(hdr);
+    if (count == 0 || count > MAX_ENTRIES)
+        goto out;
+
+    entries = malloc(count * sizeof (*entries));
+    if (unlikely(entries == NULL))
+        goto out;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint8_t buf[ENTRY_SIZE];
+
+        if (fread(buf, 1, sizeof (buf), file) != sizeof (buf))
+            goto out;
+
+        entries[i].i_time   = GetQWLE(&buf[0]);
+        entries[i].i_offset = GetQWLE(&buf[8]);
+        entries[i].i_size   = GetDWLE(&buf[16]);
+        entries[i].i_stream = GetDWLE(&buf[20]);
+        entries[i].i_flags  = GetDWLE(&buf[24]);
+    }
+
+    msg_Dbg(demux, "loaded %"PRIu64" cached %s index entries", count, name);
+    *pp_entries = entries;
+    *pi_count = count;
+    entries = NULL;
+    ret = VLC_SUCCESS;
+out:
+    free(entries);
+    free(filekey);
+    free(key);
+    fclose(file);
+    if (stale)
+    {
+        msg_Dbg(demux, "discarding stale %s index cache", name);
+        vlc_unlink(path);
+    }
+    free(path);
+    return ret;
+}
+
+int demux_IndexSave(demux_t *demux, const char *name,
+                    const demux_index_entry_t *entries, size_t count)
+{
+    if (count == 0 || count > MAX_ENTRIES)
+        return VLC_EGENERIC;
+
+    char *key = IndexKey(demux, name);
+    if (key == NULL)
+        return VLC_EGENERIC;
+
+    char *dir = IndexDir(true);
+    char *path = (dir != NULL) ? IndexPath(dir, demux, name) : NULL;
+    char *tmp;
+    if (path == NULL || asprintf(&tmp, "%s.tmp", path) == -1)
+    {
+        free(path);
+        free(dir);
+        free(key);
+        return VLC_EGENERIC;
+    }
+
+    int ret = VLC_EGENERIC;
+    FILE *file = vlc_fopen(tmp, "wb");
+    if (file == NULL)
+    {
+        msg_Warn(demux, "cannot write index cache %s: %s", tmp,
+                 vlc_strerror_c(errno));
+        goto out;
+    }
+
+    const size_t keylen = strlen(key);
+    uint8_t hdr[12];
+
+    memcpy(hdr, magic, sizeof (magic));
+    SetDWLE(&hdr[8], keylen);
+    bool ok = fwrite(hdr, 1, sizeof (hdr), file) == sizeof (hdr)
+           && fwrite(key, 1, keylen, file) == keylen;
+
+    SetQWLE(hdr, count);
+    ok = ok && fwrite(hdr, 1, 8, file) == 8;
+
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        uint8_t buf[ENTRY_SIZE];
+
+        SetQWLE(&buf[0], entries[i].i_time);
+        SetQWLE(&buf[8], entries[i].i_offset);
+        SetDWLE(&buf[16], entries[i].i_size);
+        SetDWLE(&buf[20], entries[i].i_stream);
+        SetDWLE(&buf[24], entries[i].i_flags);
+        ok = fwrite(buf, 1, sizeof (buf), file) == sizeof (buf);
+    }
+
+    if (fclose(file) || !ok || vlc_rename(tmp, path))
+        vlc_unlink(tmp);
+    else
+    {
+        msg_Dbg(demux, "saved %zu %s index entries", count, name);
+        IndexPrune(demux, dir, path);
+        ret = VLC_SUCCESS;
+    }
+out:
+    free(tmp);
+    free(path);
+    free(dir);
+    free(key);
+    return ret;
+}
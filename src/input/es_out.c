@@ -54,6 +54,9 @@
 /* FIXME we should find a better way than including that */
 #include "../text/iso-639_def.h"
 
+/* Minimal jitter decrease for which the pts_delay is lowered */
+#define ES_OUT_JITTER_HYSTERESIS (CLOCK_FREQ/50)
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -2028,7 +2031,11 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Decode */
     if( es->p_dec_record )
     {
-        block_t *p_dup = block_Duplicate( p_block );
+        /* The recorder only packetizes and muxes the payload, which
+         * is copied on write: share it rather than copy it */
+        block_t *p_dup = block_Share( &p_block );
+        if( unlikely(p_dup == NULL) )
+            p_dup = block_Duplicate( p_block );
         if( p_dup )
             input_DecoderDecode( es->p_dec_record, p_dup,
                                  input_priv(p_input)->b_out_pace_control );
@@ -2390,6 +2397,25 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         if( !p_sys->p_pgrm )
             return VLC_SUCCESS;
 
+        input_clock_stats_t clock_stats;
+        if( p_pgrm == p_sys->p_pgrm )
+        {
+            input_thread_t *p_input = p_sys->p_input;
+
+            input_clock_GetStats( p_pgrm->p_clock, &clock_stats );
+            if( libvlc_stats( p_input ) )
+            {
+                vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
+                stats_Update( input_priv(p_input)->counters.p_clock_latency,
+                              clock_stats.i_latency, NULL );
+                stats_Update( input_priv(p_input)->counters.p_clock_jitter,
+                              clock_stats.i_jitter, NULL );
+                if( b_late )
+                    stats_Update( input_priv(p_input)->counters.p_clock_late, 1, NULL );
+                vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
+            }
+        }
+
         if( p_sys->b_buffering )
         {
             /* Check buffering state on master clock update */
@@ -2431,6 +2457,20 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
                 es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base, p_sys->i_cr_average );
             }
+            else if( !b_late && p_sys->i_pts_jitter > 0 && clock_stats.i_pts_delay > 0 )
+            {
+                /* Give back the extra delay once the arrival jitter
+                 * decreased, the clock lowers it progressively */
+                const mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
+                const mtime_t i_pts_jitter = __MAX( clock_stats.i_pts_delay - i_pts_delay_base, 0 );
+
+                if( i_pts_jitter + ES_OUT_JITTER_HYSTERESIS < p_sys->i_pts_jitter )
+                {
+                    msg_Dbg( p_sys->p_input, "arrival jitter decreased (pts_delay lowered to %d ms)",
+                             (int)((i_pts_delay_base + i_pts_jitter)/1000) );
+                    es_out_SetJitter( out, i_pts_delay_base, i_pts_jitter, p_sys->i_cr_average );
+                }
+            }
         }
         return VLC_SUCCESS;
     }
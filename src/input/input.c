@@ -812,6 +812,9 @@ static void InitStatistics( input_thread_t *p_input )
         INIT_COUNTER( demux_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, COUNTER );
         INIT_COUNTER( demux_discontinuity, COUNTER );
+        INIT_COUNTER( clock_latency, LAST );
+        INIT_COUNTER( clock_jitter, LAST );
+        INIT_COUNTER( clock_late, COUNTER );
         INIT_COUNTER( played_abuffers, COUNTER );
         INIT_COUNTER( lost_abuffers, COUNTER );
         INIT_COUNTER( displayed_pictures, COUNTER );
@@ -1475,6 +1478,9 @@ do { \
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
+            CL_CO( clock_latency );
+            CL_CO( clock_jitter );
+            CL_CO( clock_late );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
             CL_CO( displayed_pictures );
@@ -153,6 +153,9 @@ typedef struct input_thread_private_t
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
         counter_t *p_demux_discontinuity;
+        counter_t *p_clock_latency;
+        counter_t *p_clock_jitter;
+        counter_t *p_clock_late;
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
@@ -97,6 +97,11 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     st->i_demux_corrupted = stats_GetTotal(priv->counters.p_demux_corrupted);
     st->i_demux_discontinuity = stats_GetTotal(priv->counters.p_demux_discontinuity);
 
+    /* Clock */
+    st->i_clock_latency = stats_GetTotal(priv->counters.p_clock_latency);
+    st->i_clock_jitter = stats_GetTotal(priv->counters.p_clock_jitter);
+    st->i_clock_late = stats_GetTotal(priv->counters.p_clock_late);
+
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(priv->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(priv->counters.p_decoded_audio);
@@ -129,6 +134,8 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
+    p_stats->i_clock_latency = p_stats->i_clock_jitter =
+    p_stats->i_clock_late =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
@@ -193,6 +200,7 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
         break;
     }
     case STATS_COUNTER:
+    case STATS_LAST:
         if( p_counter->i_samples == 0 )
         {
             counter_sample_t *p_new = (counter_sample_t*)malloc(
@@ -207,7 +215,10 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
         }
         if( p_counter->i_samples == 1 )
         {
-            p_counter->pp_samples[0]->value += val;
+            if( p_counter->i_compute_type == STATS_LAST )
+                p_counter->pp_samples[0]->value = val;
+            else
+                p_counter->pp_samples[0]->value += val;
             if( new_val )
                 *new_val = p_counter->pp_samples[0]->value;
         }
@@ -0,0 +1,479 @@
+/*****************************************************************************
+ * thumbnailer.c: fast thumbnail extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_codec.h>
+#include <vlc_image.h>
+#include <vlc_meta.h>
+#include <vlc_modules.h>
+#include <vlc_thumbnailer.h>
+
+#include "../libvlc.h"
+#include "stream.h"
+
+/* Video blocks fed to the decoder after a seek before giving up */
+#define THUMBNAILER_MAX_BLOCKS 2000
+
+struct es_out_id_t
+{
+    int i_cat;
+};
+
+struct vlc_thumbnailer_t
+{
+    VLC_COMMON_MEMBERS
+
+    es_out_t out;
+    demux_t *demux;
+    image_handler_t *image;
+
+    es_out_id_t *video; /**< decoded video ES */
+    decoder_t *packetizer;
+    decoder_t *decoder;
+    picture_t *picture; /**< first picture decoded since the last seek */
+    video_format_t picture_fmt; /**< decoder output format of the picture */
+    unsigned blocks;
+    bool error;
+};
+
+static vlc_thumbnailer_t *out_thumbnailer(es_out_t *out)
+{
+    return (vlc_thumbnailer_t *)out->p_sys;
+}
+
+/*****************************************************************************
+ * Decoder
+ *****************************************************************************/
+static int VideoUpdateFormat(decoder_t *dec)
+{
+    dec->fmt_out.video.i_chroma = dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *VideoNewBuffer(decoder_t *dec)
+{
+    return picture_NewFromFormat(&dec->fmt_out.video);
+}
+
+static int VideoQueue(decoder_t *dec, picture_t *pic, block_t *cc,
+                      bool cc_present[4])
+{
+    vlc_thumbnailer_t *th = dec->p_queue_ctx;
+
+    (void) cc_present;
+    if (cc != NULL)
+        block_Release(cc);
+
+    /* Only the keyframe following the seek matters. The decoder may be
+     * replaced before the picture is used, so keep its format as well. */
+    if (th->picture == NULL
+     && video_format_Copy(&th->picture_fmt,
+                          &dec->fmt_out.video) == VLC_SUCCESS)
+        th->picture = pic;
+    else
+        picture_Release(pic);
+    return 0;
+}
+
+static void DecoderDelete(decoder_t *dec)
+{
+    if (dec->p_module != NULL)
+        module_unneed(dec, dec->p_module);
+    es_format_Clean(&dec->fmt_in);
+    es_format_Clean(&dec->fmt_out);
+    if (dec->p_description != NULL)
+        vlc_meta_Delete(dec->p_description);
+    vlc_object_release(dec);
+}
+
+static decoder_t *DecoderNew(vlc_thumbnailer_t *th, const es_format_t *fmt,
+                             bool packetizer)
+{
+    decoder_t *dec = vlc_custom_create(th, sizeof (*dec),
+                                       packetizer ? "packetizer" : "decoder");
+    if (unlikely(dec == NULL))
+        return NULL;
+
+    dec->p_module = NULL;
+    dec->b_frame_drop_allowed = false;
+    es_format_Copy(&dec->fmt_in, fmt);
+    es_format_Init(&dec->fmt_out, UNKNOWN_ES, 0);
+
+    dec->pf_vout_format_update = VideoUpdateFormat;
+    dec->pf_vout_buffer_new = VideoNewBuffer;
+    dec->pf_queue_video = VideoQueue;
+    dec->p_queue_ctx = th;
+
+    if (packetizer)
+        dec->p_module = module_need(dec, "packetizer", "$packetizer", false);
+    else
+        dec->p_module = module_need(dec, "decoder", "$codec", false);
+    if (dec->p_module == NULL)
+    {
+        msg_Err(th, "no suitable %s module for fourcc `%4.4s'",
+                packetizer ? "packetizer" : "decoder",
+                (const char *)&fmt->i_codec);
+        DecoderDelete(dec);
+        return NULL;
+    }
+    return dec;
+}
+
+static void Decode(vlc_thumbnailer_t *th, block_t *block)
+{
+    if (th->decoder == NULL)
+    {
+        if (block != NULL)
+            block_Release(block);
+        return;
+    }
+
+    if (th->decoder->pf_decode(th->decoder, block) != VLCDEC_SUCCESS)
+    {
+        msg_Err(th, "video decoder failure");
+        th->error = true;
+    }
+}
+
+static void Packetize(vlc_thumbnailer_t *th, block_t *block)
+{
+    decoder_t *packetizer = th->packetizer;
+    block_t **pp_block = (block != NULL) ? &block : NULL;
+    block_t *packet;
+
+    if (packetizer == NULL)
+    {
+        Decode(th, block);
+        return;
+    }
+
+    while ((packet = packetizer->pf_packetize(packetizer, pp_block)) != NULL)
+    {
+        if (th->decoder == NULL
+         || !es_format_IsSimilar(&th->decoder->fmt_in, &packetizer->fmt_out))
+        {
+            if (th->decoder != NULL)
+                DecoderDelete(th->decoder);
+            th->decoder = DecoderNew(th, &packetizer->fmt_out, false);
+        }
+
+        while (packet != NULL)
+        {
+            block_t *next = packet->p_next;
+
+            packet->p_next = NULL;
+            Decode(th, packet);
+            packet = next;
+        }
+    }
+
+    if (block == NULL)
+        Decode(th, NULL);
+}
+
+static void Flush(vlc_thumbnailer_t *th)
+{
+    if (th->packetizer != NULL && th->packetizer->pf_flush != NULL)
+        th->packetizer->pf_flush(th->packetizer);
+    if (th->decoder != NULL && th->decoder->pf_flush != NULL)
+        th->decoder->pf_flush(th->decoder);
+
+    if (th->picture != NULL)
+    {
+        picture_Release(th->picture);
+        video_format_Clean(&th->picture_fmt);
+        th->picture = NULL;
+    }
+    th->blocks = 0;
+}
+
+static void DeleteDecoders(vlc_thumbnailer_t *th)
+{
+    if (th->decoder != NULL)
+        DecoderDelete(th->decoder);
+    if (th->packetizer != NULL)
+        DecoderDelete(th->packetizer);
+    th->decoder = th->packetizer = NULL;
+    th->video = NULL;
+}
+
+/*****************************************************************************
+ * Elementary streams output
+ *****************************************************************************/
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    vlc_thumbnailer_t *th = out_thumbnailer(out);
+    es_out_id_t *id = malloc(sizeof (*id));
+    if (unlikely(id == NULL))
+        return NULL;
+
+    id->i_cat = fmt->i_cat;
+
+    /* Decode the first video track only */
+    if (fmt->i_cat != VIDEO_ES || th->video != NULL)
+        return id;
+
+    if (!fmt->b_packetized)
+    {
+        th->packetizer = DecoderNew(th, fmt, true);
+        if (th->packetizer == NULL)
+            return id;
+    }
+
+    th->decoder = DecoderNew(th, fmt, false);
+    if (th->decoder == NULL && th->packetizer != NULL)
+    {
+        DecoderDelete(th->packetizer);
+        th->packetizer = NULL;
+    }
+    if (th->decoder != NULL)
+        th->video = id;
+    return id;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    vlc_thumbnailer_t *th = out_thumbnailer(out);
+
+    if (id != th->video || th->picture != NULL || th->error)
+    {
+        block_Release(block);
+        return VLC_SUCCESS;
+    }
+
+    th->blocks++;
+    Packetize(th, block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    vlc_thumbnailer_t *th = out_thumbnailer(out);
+
+    if (id == th->video)
+        DeleteDecoders(th);
+    free(id);
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    vlc_thumbnailer_t *th = out_thumbnailer(out);
+
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg(args, es_out_id_t *);
+            bool *pb = va_arg(args, bool *);
+
+            *pb = id == th->video;
+            return VLC_SUCCESS;
+        }
+
+        case ES_OUT_GET_EMPTY:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_CAT_POLICY:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_SET_GROUP_EPG_EVENT:
+        case ES_OUT_SET_EPG_TIME:
+        case ES_OUT_DEL_GROUP:
+        case ES_OUT_SET_META:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+/*****************************************************************************
+ * Thumbnailer
+ *****************************************************************************/
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create(vlc_object_t *obj, const char *mrl)
+{
+    const char *location = strstr(mrl, "://");
+    if (location == NULL)
+        return NULL;
+
+    vlc_thumbnailer_t *th = vlc_custom_create(obj, sizeof (*th),
+                                              "thumbnailer");
+    if (unlikely(th == NULL))
+        return NULL;
+
+    th->out.pf_add = EsOutAdd;
+    th->out.pf_send = EsOutSend;
+    th->out.pf_del = EsOutDel;
+    th->out.pf_control = EsOutControl;
+    th->out.pf_destroy = EsOutDestroy;
+    th->out.p_sys = (es_out_sys_t *)th;
+    th->video = NULL;
+    th->packetizer = NULL;
+    th->decoder = NULL;
+    th->picture = NULL;
+    th->blocks = 0;
+    th->error = false;
+
+    /* Inherited by the decoder: only keyframes are decoded, quickly and in
+     * software */
+    var_Create(th, "avcodec-skip-frame", VLC_VAR_INTEGER);
+    var_SetInteger(th, "avcodec-skip-frame", 3);
+    var_Create(th, "avcodec-skiploopfilter", VLC_VAR_INTEGER);
+    var_SetInteger(th, "avcodec-skiploopfilter", 4);
+    var_Create(th, "avcodec-hurry-up", VLC_VAR_BOOL);
+    var_Create(th, "avcodec-fast", VLC_VAR_BOOL);
+    var_SetBool(th, "avcodec-fast", true);
+    var_Create(th, "avcodec-hw", VLC_VAR_STRING);
+    var_SetString(th, "avcodec-hw", "none");
+
+    th->image = image_HandlerCreate(th);
+    if (unlikely(th->image == NULL))
+        goto error;
+
+    stream_t *s = vlc_stream_NewURL(th, mrl);
+    if (s == NULL)
+        goto error;
+    s = stream_FilterAutoNew(s);
+
+    th->demux = demux_New(VLC_OBJECT(th), "any", location + 3, s, &th->out);
+    if (th->demux == NULL)
+    {
+        msg_Err(th, "cannot open `%s'", mrl);
+        vlc_stream_Delete(s);
+        goto error;
+    }
+    return th;
+
+error:
+    if (th->image != NULL)
+        image_HandlerDelete(th->image);
+    vlc_object_release(th);
+    return NULL;
+}
+
+static int Seek(vlc_thumbnailer_t *th, mtime_t time)
+{
+    if (demux_Control(th->demux, DEMUX_SET_TIME, (int64_t)time, false)
+                                                                == VLC_SUCCESS)
+        return VLC_SUCCESS;
+
+    int64_t length;
+    if (demux_Control(th->demux, DEMUX_GET_LENGTH, &length) || length <= 0)
+        return VLC_EGENERIC;
+
+    return demux_Control(th->demux, DEMUX_SET_POSITION,
+                         (double)time / length, false);
+}
+
+block_t *vlc_thumbnailer_Extract(vlc_thumbnailer_t *th, mtime_t time,
+                                 const video_format_t *fmt, mtime_t *pi_time)
+{
+    Flush(th);
+
+    if (Seek(th, time))
+    {
+        msg_Warn(th, "cannot seek to %"PRId64, time);
+        return NULL;
+    }
+
+    while (th->picture == NULL && !th->error)
+    {
+        if (th->blocks > THUMBNAILER_MAX_BLOCKS)
+        {
+            msg_Warn(th, "no keyframe found after %"PRId64, time);
+            return NULL;
+        }
+
+        if (demux_Demux(th->demux) != VLC_DEMUXER_SUCCESS)
+        {
+            /* Output the pictures held by the decoder */
+            if (th->video != NULL)
+                Packetize(th, NULL);
+            break;
+        }
+    }
+
+    picture_t *pic = th->picture;
+    if (pic == NULL)
+        return NULL;
+
+    video_format_t src = th->picture_fmt;
+    video_format_t dst = *fmt;
+
+    if (src.i_visible_width == 0 || src.i_visible_height == 0)
+    {
+        src.i_visible_width = src.i_width;
+        src.i_visible_height = src.i_height;
+    }
+    if (src.i_sar_num == 0 || src.i_sar_den == 0)
+        src.i_sar_num = src.i_sar_den = 1;
+
+    /* Preserve the display aspect ratio */
+    if (dst.i_width == 0 && dst.i_height == 0)
+        dst.i_height = src.i_visible_height;
+    if (dst.i_width == 0)
+        dst.i_width = (int64_t)src.i_visible_width * src.i_sar_num
+                      * dst.i_height / src.i_visible_height / src.i_sar_den;
+    if (dst.i_height == 0)
+        dst.i_height = (int64_t)src.i_visible_height * src.i_sar_den
+                       * dst.i_width / src.i_visible_width / src.i_sar_num;
+    dst.i_visible_width = dst.i_width;
+    dst.i_visible_height = dst.i_height;
+    dst.i_sar_num = dst.i_sar_den = 1;
+
+    if (pi_time != NULL)
+        *pi_time = (pic->date > VLC_TS_INVALID) ? pic->date - VLC_TS_0 : time;
+
+    /* Scaling, chroma conversion and encoding in one go */
+    return image_Write(th->image, pic, &src, &dst);
+}
+
+void vlc_thumbnailer_Delete(vlc_thumbnailer_t *th)
+{
+    Flush(th);
+    demux_Delete(th->demux);
+    DeleteDecoders(th);
+    image_HandlerDelete(th->image);
+    vlc_object_release(th);
+}
@@ -386,6 +386,11 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads that video filters can split their work across " \
+    "(0 = one per CPU).")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -530,6 +535,16 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define DECODER_FIFO_HIGH_TEXT N_("Decoder queue high watermark")
+#define DECODER_FIFO_HIGH_LONGTEXT N_( \
+    "When the input can be paced, the demuxer waits once the decoder " \
+    "queues hold this much media (in milliseconds)." )
+
+#define DECODER_FIFO_LOW_TEXT N_("Decoder queue low watermark")
+#define DECODER_FIFO_LOW_LONGTEXT N_( \
+    "A waiting demuxer resumes once the decoder queue holds less than this " \
+    "much media (in milliseconds)." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -643,6 +658,11 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define DEMUX_INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define DEMUX_INDEX_CACHE_LONGTEXT N_( \
+    "Save the seek indexes that demuxers have to rebuild by scanning " \
+    "local files, so that these files open faster the next time." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -950,6 +970,25 @@ static const char *const ppsz_prefres[] = {
     "This allow you to configure the initial caching amount for stream output " \
     "muxer. This value should be set in milliseconds." )
 
+#define SOUT_MUX_ASYNC_TEXT N_("Run muxers in their own thread")
+#define SOUT_MUX_ASYNC_LONGTEXT N_( \
+    "This runs each stream output muxer and its access output in a " \
+    "dedicated thread, so that a slow output does not stall the input nor " \
+    "the other outputs." )
+
+#define SOUT_MUX_QUEUE_TEXT N_("Muxer queue size (kB)")
+#define SOUT_MUX_QUEUE_LONGTEXT N_( \
+    "Maximum amount of data waiting for a muxer running in its own " \
+    "thread (0 means unlimited)." )
+
+#define SOUT_MUX_OVERFLOW_TEXT N_("Muxer queue overflow")
+#define SOUT_MUX_OVERFLOW_LONGTEXT N_( \
+    "What to do with new data when a muxer queue is full: wait for the " \
+    "muxer for a while, or drop it (video resumes on the next keyframe)." )
+static const int pi_sout_mux_overflow_values[] = { 0, 1 };
+static const char *const ppsz_sout_mux_overflow_descriptions[] = {
+    N_("Wait"), N_("Drop") };
+
 #define PACKETIZER_TEXT N_("Preferred packetizer list")
 #define PACKETIZER_LONGTEXT N_( \
     "This allows you to select the order in which VLC will choose its " \
@@ -1627,6 +1666,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list( "video-filter", "video filter", NULL,
                      VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_integer( "filter-threads", 0, FILTER_THREADS_TEXT,
+                 FILTER_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
     add_module_list( "video-splitter", "video splitter", NULL,
@@ -1730,6 +1772,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "demux-index-cache", true,
+              DEMUX_INDEX_CACHE_TEXT, DEMUX_INDEX_CACHE_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1864,6 +1908,12 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_integer( "decoder-fifo-high", 1000, DECODER_FIFO_HIGH_TEXT,
+                 DECODER_FIFO_HIGH_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+    add_integer( "decoder-fifo-low", 500, DECODER_FIFO_LOW_TEXT,
+                 DECODER_FIFO_LOW_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1924,6 +1974,15 @@ vlc_module_begin ()
                                 SOUT_SPU_LONGTEXT, true )
     add_integer( "sout-mux-caching", 1500, SOUT_MUX_CACHING_TEXT,
                                 SOUT_MUX_CACHING_LONGTEXT, true )
+    add_bool( "sout-mux-async", false, SOUT_MUX_ASYNC_TEXT,
+                                SOUT_MUX_ASYNC_LONGTEXT, true )
+    add_integer( "sout-mux-queue", 16384, SOUT_MUX_QUEUE_TEXT,
+                                SOUT_MUX_QUEUE_LONGTEXT, true )
+        change_integer_range( 0, 1048576 )
+    add_integer( "sout-mux-overflow", 0, SOUT_MUX_OVERFLOW_TEXT,
+                                SOUT_MUX_OVERFLOW_LONGTEXT, true )
+        change_integer_list( pi_sout_mux_overflow_values,
+                             ppsz_sout_mux_overflow_descriptions )
 
     set_section( N_("VLM"), NULL )
     add_loadfile( "vlm-conf", NULL, VLM_CONF_TEXT,
@@ -151,6 +151,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct vlc_slice_pool *slices; ///< Slice-threading worker pool (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -165,6 +166,8 @@ int intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                     const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
 
+void vlc_slice_pool_Destroy( libvlc_int_t * );
+
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->obj.libvlc)->b_stats)
 
 /*
@@ -179,6 +182,7 @@ enum
 {
     STATS_COUNTER,
     STATS_DERIVATIVE,
+    STATS_LAST,
 };
 
 typedef struct counter_sample_t
@@ -32,6 +32,7 @@
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -114,8 +115,10 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
  * libavcodec AVX optimizations require at least 32-bytes. */
 #define BLOCK_ALIGN        32
 
-/** Initial reserved header and footer size. */
-#define BLOCK_PADDING      32
+/** Initial reserved header and footer size.
+ * @note The footer fits libavcodec input padding (AV_INPUT_BUFFER_PADDING_SIZE)
+ * so that decoders can pad blocks in place. */
+#define BLOCK_PADDING      64
 
 block_t *block_Alloc (size_t size)
 {
@@ -139,6 +142,109 @@ block_t *block_Alloc (size_t size)
     return b;
 }
 
+/**
+ * Payload shared by several blocks.
+ * The original block owns the memory and is released with the last view.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *owner;
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub (&payload->refs, 1) == 1)
+    {
+        block_Release (payload->owner);
+        free (payload);
+    }
+}
+
+static block_t *block_shared_New (block_payload_t *payload, const block_t *in)
+{
+    block_shared_t *view = malloc (sizeof (*view));
+    if (unlikely(view == NULL))
+        return NULL;
+
+    block_t *b = &view->self;
+    block_Init (b, in->p_start, in->i_size);
+    b->p_buffer = in->p_buffer;
+    b->i_buffer = in->i_buffer;
+    BlockMetaCopy (b, in);
+    b->p_next = NULL;
+    b->pf_release = block_shared_Release;
+    view->payload = payload;
+    atomic_fetch_add (&payload->refs, 1);
+    return b;
+}
+
+/** Tells whether other blocks reference the same payload. */
+static bool block_IsShared (const block_t *block)
+{
+    if (block->pf_release != block_shared_Release)
+        return false;
+
+    const block_payload_t *payload = ((const block_shared_t *)block)->payload;
+    return atomic_load (&payload->refs) > 1;
+}
+
+block_t *block_Share (block_t **pp_block)
+{
+    block_t *block = *pp_block;
+
+    block_Check (block);
+
+    if (block->pf_release != block_shared_Release)
+    {   /* First reference: turn the block into a view of its own payload */
+        block_payload_t *payload = malloc (sizeof (*payload));
+        if (unlikely(payload == NULL))
+            return NULL;
+
+        atomic_init (&payload->refs, 0);
+        payload->owner = block;
+
+        block_t *view = block_shared_New (payload, block);
+        if (unlikely(view == NULL))
+        {
+            free (payload);
+            return NULL;
+        }
+
+        view->p_next = block->p_next;
+        block->p_next = NULL;
+        *pp_block = block = view;
+    }
+
+    return block_shared_New (((block_shared_t *)block)->payload, block);
+}
+
+block_t *block_Unshare (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *copy = block_Alloc (block->i_buffer);
+    if (likely(copy != NULL))
+    {
+        memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+        BlockMetaCopy (copy, block);
+    }
+    block_Release (block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -173,9 +279,12 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     size_t requested = i_prebody + i_body;
 
+    /* Shared payloads are read-only, only their views can be shrunk */
+    const bool b_shared = block_IsShared( p_block );
+
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !b_shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -200,7 +309,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (b_shared && (i_prebody > 0 || i_body > p_block->i_buffer)) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -0,0 +1,422 @@
+/*****************************************************************************
+ * fft.c: fast Fourier transform
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_fft.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <xmmintrin.h>
+# define FFT_SSE 1
+# if VLC_GCC_VERSION(4, 9) || defined(__clang__)
+#  include <immintrin.h>
+#  define FFT_AVX 1
+# endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define FFT_NEON 1
+#endif
+
+/** Number of unused plans kept in the cache */
+#define FFT_CACHE_MAX 4
+
+typedef void (*fft_stage_fn)(float *, float *, const float *, const float *,
+                             unsigned, unsigned);
+
+/*
+ * A real transform of N samples is computed as a complex transform of
+ * M = N/2 points, whose real and imaginary parts are the even and odd
+ * samples respectively. The two interleaved spectra are then separated.
+ *
+ * The complex transform is an iterative decimation in time: the input is
+ * loaded in bit-reversed order, the first two butterfly stages are merged
+ * into a single radix-4 pass (their twiddle factors are trivial), then each
+ * remaining radix-2 stage is run by a vector kernel where available.
+ */
+struct vlc_fft
+{
+    struct vlc_fft *next;
+    unsigned refs;
+    unsigned size; /**< Number of real samples (N) */
+    unsigned half; /**< Number of complex points (M) */
+    fft_stage_fn stage;
+
+    unsigned *bitrev; /**< Bit-reversed index for each of M points */
+    /** Twiddle factors of all radix-2 stages: the stage of half-size h uses
+     * exp(-i pi k / h) for k in [0, h), stored from offset h */
+    float *tw_re, *tw_im;
+    /** Twiddle factors of the separation: exp(-2i pi k / N), k in [0, M/2] */
+    float *post_re, *post_im;
+};
+
+static vlc_mutex_t fft_lock = VLC_STATIC_MUTEX;
+static struct vlc_fft *fft_cache = NULL;
+
+/*** Butterfly kernels ***/
+
+static void fft_stage_C(float *re, float *im, const float *wr, const float *wi,
+                        unsigned m, unsigned h)
+{
+    for (unsigned j = 0; j < m; j += 2 * h)
+    {
+        float *re0 = re + j, *im0 = im + j;
+        float *re1 = re0 + h, *im1 = im0 + h;
+
+        for (unsigned k = 0; k < h; k++)
+        {
+            float tr = wr[k] * re1[k] - wi[k] * im1[k];
+            float ti = wr[k] * im1[k] + wi[k] * re1[k];
+
+            re1[k] = re0[k] - tr;
+            im1[k] = im0[k] - ti;
+            re0[k] += tr;
+            im0[k] += ti;
+        }
+    }
+}
+
+#ifdef FFT_SSE
+__attribute__ ((__target__ ("sse")))
+static void fft_stage_SSE(float *re, float *im, const float *wr,
+                          const float *wi, unsigned m, unsigned h)
+{
+    if (h < 4)
+    {
+        fft_stage_C(re, im, wr, wi, m, h);
+        return;
+    }
+
+    for (unsigned j = 0; j < m; j += 2 * h)
+    {
+        float *re0 = re + j, *im0 = im + j;
+        float *re1 = re0 + h, *im1 = im0 + h;
+
+        for (unsigned k = 0; k < h; k += 4)
+        {
+            __m128 c = _mm_load_ps(wr + k), s = _mm_load_ps(wi + k);
+            __m128 xr = _mm_loadu_ps(re1 + k), xi = _mm_loadu_ps(im1 + k);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(c, xr), _mm_mul_ps(s, xi));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(c, xi), _mm_mul_ps(s, xr));
+            __m128 ar = _mm_loadu_ps(re0 + k), ai = _mm_loadu_ps(im0 + k);
+
+            _mm_storeu_ps(re1 + k, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(im1 + k, _mm_sub_ps(ai, ti));
+            _mm_storeu_ps(re0 + k, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(im0 + k, _mm_add_ps(ai, ti));
+        }
+    }
+}
+#endif
+
+#ifdef FFT_AVX
+__attribute__ ((__target__ ("avx")))
+static void fft_stage_AVX(float *re, float *im, const float *wr,
+                          const float *wi, unsigned m, unsigned h)
+{
+    if (h < 8)
+    {
+        fft_stage_SSE(re, im, wr, wi, m, h);
+        return;
+    }
+
+    for (unsigned j = 0; j < m; j += 2 * h)
+    {
+        float *re0 = re + j, *im0 = im + j;
+        float *re1 = re0 + h, *im1 = im0 + h;
+
+        for (unsigned k = 0; k < h; k += 8)
+        {
+            __m256 c = _mm256_load_ps(wr + k), s = _mm256_load_ps(wi + k);
+            __m256 xr = _mm256_loadu_ps(re1 + k);
+            __m256 xi = _mm256_loadu_ps(im1 + k);
+            __m256 tr = _mm256_sub_ps(_mm256_mul_ps(c, xr),
+                                      _mm256_mul_ps(s, xi));
+            __m256 ti = _mm256_add_ps(_mm256_mul_ps(c, xi),
+                                      _mm256_mul_ps(s, xr));
+            __m256 ar = _mm256_loadu_ps(re0 + k);
+            __m256 ai = _mm256_loadu_ps(im0 + k);
+
+            _mm256_storeu_ps(re1 + k, _mm256_sub_ps(ar, tr));
+            _mm256_storeu_ps(im1 + k, _mm256_sub_ps(ai, ti));
+            _mm256_storeu_ps(re0 + k, _mm256_add_ps(ar, tr));
+            _mm256_storeu_ps(im0 + k, _mm256_add_ps(ai, ti));
+        }
+    }
+}
+#endif
+
+#ifdef FFT_NEON
+static void fft_stage_NEON(float *re, float *im, const float *wr,
+                           const float *wi, unsigned m, unsigned h)
+{
+    if (h < 4)
+    {
+        fft_stage_C(re, im, wr, wi, m, h);
+        return;
+    }
+
+    for (unsigned j = 0; j < m; j += 2 * h)
+    {
+        float *re0 = re + j, *im0 = im + j;
+        float *re1 = re0 + h, *im1 = im0 + h;
+
+        for (unsigned k = 0; k < h; k += 4)
+        {
+            float32x4_t c = vld1q_f32(wr + k), s = vld1q_f32(wi + k);
+            float32x4_t xr = vld1q_f32(re1 + k), xi = vld1q_f32(im1 + k);
+            float32x4_t tr = vmlsq_f32(vmulq_f32(c, xr), s, xi);
+            float32x4_t ti = vmlaq_f32(vmulq_f32(c, xi), s, xr);
+            float32x4_t ar = vld1q_f32(re0 + k), ai = vld1q_f32(im0 + k);
+
+            vst1q_f32(re1 + k, vsubq_f32(ar, tr));
+            vst1q_f32(im1 + k, vsubq_f32(ai, ti));
+            vst1q_f32(re0 + k, vaddq_f32(ar, tr));
+            vst1q_f32(im0 + k, vaddq_f32(ai, ti));
+        }
+    }
+}
+#endif
+
+static fft_stage_fn fft_stage_Get(void)
+{
+#ifdef FFT_AVX
+    if (vlc_CPU_AVX())
+        return fft_stage_AVX;
+#endif
+#ifdef FFT_SSE
+    if (vlc_CPU_SSE())
+        return fft_stage_SSE;
+#endif
+#ifdef FFT_NEON
+    return fft_stage_NEON;
+#endif
+    return fft_stage_C;
+}
+
+/**
+ * Merges the first two stages: 4-point transforms of bit-reversed data.
+ */
+static void fft_radix4(float *re, float *im, unsigned m)
+{
+    for (unsigned j = 0; j < m; j += 4)
+    {
+        float s0r = re[j] + re[j + 1], s0i = im[j] + im[j + 1];
+        float d0r = re[j] - re[j + 1], d0i = im[j] - im[j + 1];
+        float s1r = re[j + 2] + re[j + 3], s1i = im[j + 2] + im[j + 3];
+        float d1r = re[j + 2] - re[j + 3], d1i = im[j + 2] - im[j + 3];
+
+        re[j]     = s0r + s1r;  im[j]     = s0i + s1i;
+        re[j + 2] = s0r - s1r;  im[j + 2] = s0i - s1i;
+        /* d1 * exp(-i pi/2) = d1 * -i */
+        re[j + 1] = d0r + d1i;  im[j + 1] = d0i - d1r;
+        re[j + 3] = d0r - d1i;  im[j + 3] = d0i + d1r;
+    }
+}
+
+void vlc_fft_Real(const vlc_fft_t *fft, const float *in,
+                  float *restrict re, float *restrict im)
+{
+    const unsigned m = fft->half;
+
+    /* Complex transform of the packed samples */
+    for (unsigned i = 0; i < m; i++)
+    {
+        unsigned n = fft->bitrev[i];
+
+        re[i] = in[2 * n];
+        im[i] = in[2 * n + 1];
+    }
+
+    unsigned h;
+    if (m >= 4)
+    {
+        fft_radix4(re, im, m);
+        h = 4;
+    }
+    else
+        h = 1;
+
+    for (; h < m; h *= 2)
+        fft->stage(re, im, fft->tw_re + h, fft->tw_im + h, m, h);
+
+    /* Separation of the even and odd samples spectra */
+    float z0r = re[0], z0i = im[0];
+
+    re[0] = z0r + z0i;
+    im[0] = 0.f;
+    re[m] = z0r - z0i;
+    im[m] = 0.f;
+
+    for (unsigned k = 1; k <= m / 2; k++)
+    {
+        float ar = re[k], ai = im[k];
+        float br = re[m - k], bi = im[m - k];
+        float er = .5f * (ar + br), ei = .5f * (ai - bi);
+        float dr = .5f * (ai + bi), di = .5f * (br - ar);
+        float wr = fft->post_re[k], wi = fft->post_im[k];
+        float tr = wr * dr - wi * di, ti = wr * di + wi * dr;
+
+        re[k] = er + tr;
+        im[k] = ei + ti;
+        re[m - k] = er - tr;
+        im[m - k] = ti - ei;
+    }
+}
+
+/*** Plans ***/
+
+static void fft_Destroy(struct vlc_fft *fft)
+{
+    free(fft->post_im);
+    free(fft->post_re);
+    vlc_free(fft->tw_im);
+    vlc_free(fft->tw_re);
+    free(fft->bitrev);
+    free(fft);
+}
+
+static struct vlc_fft *fft_Create(unsigned size)
+{
+    struct vlc_fft *fft = malloc(sizeof (*fft));
+    if (unlikely(fft == NULL))
+        return NULL;
+
+    const unsigned m = size / 2;
+    unsigned bits = 0;
+
+    while ((1u << bits) < m)
+        bits++;
+
+    fft->refs = 1;
+    fft->size = size;
+    fft->half = m;
+    fft->stage = fft_stage_Get();
+    fft->bitrev = malloc(m * sizeof (*fft->bitrev));
+    /* Aligned for the vector kernels: each stage starts at offset h */
+    fft->tw_re = vlc_memalign(32, m * sizeof (float));
+    fft->tw_im = vlc_memalign(32, m * sizeof (float));
+    fft->post_re = malloc((m / 2 + 1) * sizeof (float));
+    fft->post_im = malloc((m / 2 + 1) * sizeof (float));
+
+    if (unlikely(fft->bitrev == NULL || fft->tw_re == NULL
+              || fft->tw_im == NULL || fft->post_re == NULL
+              || fft->post_im == NULL))
+    {
+        fft_Destroy(fft);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < m; i++)
+    {
+        unsigned r = 0;
+
+        for (unsigned b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        fft->bitrev[i] = r;
+    }
+
+    fft->tw_re[0] = fft->tw_im[0] = 0.f; /* unused */
+    for (unsigned h = 1; h < m; h *= 2)
+        for (unsigned k = 0; k < h; k++)
+        {
+            double theta = -M_PI * k / h;
+
+            fft->tw_re[h + k] = cos(theta);
+            fft->tw_im[h + k] = sin(theta);
+        }
+
+    for (unsigned k = 0; k <= m / 2; k++)
+    {
+        double theta = -2. * M_PI * k / size;
+
+        fft->post_re[k] = cos(theta);
+        fft->post_im[k] = sin(theta);
+    }
+    return fft;
+}
+
+vlc_fft_t *vlc_fft_Get(unsigned size)
+{
+    if (size < 4 || size > VLC_FFT_SIZE_MAX || (size & (size - 1)))
+        return NULL;
+
+    struct vlc_fft *fft;
+
+    vlc_mutex_lock(&fft_lock);
+    for (struct vlc_fft **pp = &fft_cache; (fft = *pp) != NULL; pp = &fft->next)
+        if (fft->size == size)
+        {   /* Move to the front, so that unused plans are evicted LRU */
+            *pp = fft->next;
+            fft->refs++;
+            break;
+        }
+
+    if (fft == NULL)
+        fft = fft_Create(size);
+    if (fft != NULL)
+    {
+        fft->next = fft_cache;
+        fft_cache = fft;
+    }
+    vlc_mutex_unlock(&fft_lock);
+    return fft;
+}
+
+void vlc_fft_Release(vlc_fft_t *fft)
+{
+    struct vlc_fft *unused = NULL;
+    unsigned count = 0;
+
+    vlc_mutex_lock(&fft_lock);
+    assert(fft->refs > 0);
+    if (--fft->refs == 0)
+    {   /* Keep the most recently used plans, evict the others */
+        for (struct vlc_fft **pp = &fft_cache; *pp != NULL;)
+        {
+            struct vlc_fft *p = *pp;
+
+            if (p->refs == 0 && ++count > FFT_CACHE_MAX)
+            {
+                *pp = p->next;
+                p->next = unused;
+                unused = p;
+            }
+            else
+                pp = &p->next;
+        }
+    }
+    vlc_mutex_unlock(&fft_lock);
+
+    while (unused != NULL)
+    {
+        fft = unused->next;
+        fft_Destroy(unused);
+        unused = fft;
+    }
+}
@@ -34,6 +34,7 @@
 #include <assert.h>
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 #include "picture.h"
 #include <vlc_image.h>
 #include <vlc_block.h>
@@ -319,6 +320,120 @@ bool picture_IsReferenced( picture_t *p_picture )
 /*****************************************************************************
  *
  *****************************************************************************/
+
+/* Planes bigger than that would only evict the caches, they are copied with
+ * non-temporal stores */
+#define PLANE_STREAM_SIZE (1 << 20)
+
+#ifdef CAN_COMPILE_SSE2
+/* Copy 64 bytes from srcp to dstp loading data with the SSE>=2 instruction
+ * load and storing data with the SSE>=2 instruction store.
+ */
+#define COPY64(dstp, srcp, load, store) \
+    asm volatile (                      \
+        load "  0(%[src]), %%xmm1\n"    \
+        load " 16(%[src]), %%xmm2\n"    \
+        load " 32(%[src]), %%xmm3\n"    \
+        load " 48(%[src]), %%xmm4\n"    \
+        store " %%xmm1,    0(%[dst])\n" \
+        store " %%xmm2,   16(%[dst])\n" \
+        store " %%xmm3,   32(%[dst])\n" \
+        store " %%xmm4,   48(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+
+VLC_SSE
+static void SSE_CopyLines( uint8_t *dst, ptrdiff_t dst_pitch,
+                           const uint8_t *src, ptrdiff_t src_pitch,
+                           unsigned width, unsigned height )
+{
+    for( unsigned y = 0; y < height; y++ )
+    {
+        /* Align the destination for the non-temporal stores */
+        unsigned x = __MIN( (-(uintptr_t)dst) & 0x0f, width );
+
+        memcpy( dst, src, x );
+        for( ; x + 63 < width; x += 64 )
+            COPY64( &dst[x], &src[x], "movdqu", "movntdq" );
+        memcpy( &dst[x], &src[x], width - x );
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    asm volatile ("sfence" ::: "memory");
+}
+
+VLC_SSE
+static unsigned SSE_SplitUV( uint8_t *dstu, uint8_t *dstv,
+                             const uint8_t *src, unsigned width )
+{
+    unsigned x;
+
+    for( x = 0; x + 15 < width; x += 16 )
+        asm volatile (
+            "pcmpeqw   %%xmm7, %%xmm7\n"
+            "psrlw     $8,     %%xmm7\n"
+            "movdqu  0(%[src]), %%xmm0\n"
+            "movdqu 16(%[src]), %%xmm1\n"
+            "movdqa    %%xmm0, %%xmm2\n"
+            "movdqa    %%xmm1, %%xmm3\n"
+            "pand      %%xmm7, %%xmm0\n"
+            "pand      %%xmm7, %%xmm1\n"
+            "psrlw     $8,     %%xmm2\n"
+            "psrlw     $8,     %%xmm3\n"
+            "packuswb  %%xmm1, %%xmm0\n"
+            "packuswb  %%xmm3, %%xmm2\n"
+            "movdqu    %%xmm0, (%[dstu])\n"
+            "movdqu    %%xmm2, (%[dstv])\n"
+            : : [dstu]"r"(&dstu[x]), [dstv]"r"(&dstv[x]), [src]"r"(&src[2*x])
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+    return x;
+}
+
+VLC_SSE
+static unsigned SSE_MergeUV( uint8_t *dst, const uint8_t *srcu,
+                             const uint8_t *srcv, unsigned width )
+{
+    unsigned x;
+
+    for( x = 0; x + 15 < width; x += 16 )
+        asm volatile (
+            "movdqu    (%[srcu]), %%xmm0\n"
+            "movdqu    (%[srcv]), %%xmm1\n"
+            "movdqa    %%xmm0, %%xmm2\n"
+            "punpcklbw %%xmm1, %%xmm0\n"
+            "punpckhbw %%xmm1, %%xmm2\n"
+            "movdqu    %%xmm0,  0(%[dst])\n"
+            "movdqu    %%xmm2, 16(%[dst])\n"
+            : : [dst]"r"(&dst[2*x]), [srcu]"r"(&srcu[x]), [srcv]"r"(&srcv[x])
+            : "memory", "xmm0", "xmm1", "xmm2");
+    return x;
+}
+
+VLC_SSE
+static unsigned SSE_PackYUY2( uint8_t *dst, const uint8_t *srcy,
+                              const uint8_t *srcu, const uint8_t *srcv,
+                              unsigned width )
+{
+    unsigned x;
+
+    for( x = 0; x + 15 < width; x += 16 )
+        asm volatile (
+            "movdqu    (%[srcy]), %%xmm0\n"
+            "movq      (%[srcu]), %%xmm1\n"
+            "movq      (%[srcv]), %%xmm2\n"
+            "punpcklbw %%xmm2, %%xmm1\n"
+            "movdqa    %%xmm0, %%xmm3\n"
+            "punpcklbw %%xmm1, %%xmm0\n"
+            "punpckhbw %%xmm1, %%xmm3\n"
+            "movdqu    %%xmm0,  0(%[dst])\n"
+            "movdqu    %%xmm3, 16(%[dst])\n"
+            : : [dst]"r"(&dst[2*x]), [srcy]"r"(&srcy[x]),
+                [srcu]"r"(&srcu[x/2]), [srcv]"r"(&srcv[x/2])
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    return x;
+}
+#endif /* CAN_COMPILE_SSE2 */
+
 void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
 {
     const unsigned i_width  = __MIN( p_dst->i_visible_pitch,
@@ -346,6 +461,14 @@ void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
         assert( p_in );
         assert( p_out );
 
+#ifdef CAN_COMPILE_SSE2
+        if( vlc_CPU_SSE2() && i_width * i_height >= PLANE_STREAM_SIZE )
+        {
+            SSE_CopyLines( p_out, p_dst->i_pitch, p_in, p_src->i_pitch,
+                           i_width, i_height );
+            return;
+        }
+#endif
         for( int i_line = i_height; i_line--; )
         {
             memcpy( p_out, p_in, i_width );
@@ -377,6 +500,147 @@ void picture_Copy( picture_t *p_dst, const picture_t *p_src )
     picture_CopyProperties( p_dst, p_src );
 }
 
+/* Returns the index of the U plane of a planar 4:2:0 chroma, the V plane
+ * being the other one, or -1 */
+static int GetUPlane( vlc_fourcc_t i_chroma )
+{
+    switch( i_chroma )
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            return U_PLANE;
+        case VLC_CODEC_YV12:
+            return V_PLANE;
+        default:
+            return -1;
+    }
+}
+
+static void SplitUV( plane_t *p_u, plane_t *p_v, const plane_t *p_uv )
+{
+    const unsigned i_width = __MIN( (unsigned)p_uv->i_visible_pitch / 2,
+                             __MIN( p_u->i_visible_pitch, p_v->i_visible_pitch ) );
+    const int i_height = __MIN( p_uv->i_visible_lines,
+                         __MIN( p_u->i_visible_lines, p_v->i_visible_lines ) );
+
+    for( int y = 0; y < i_height; y++ )
+    {
+        const uint8_t *p_in = &p_uv->p_pixels[y * p_uv->i_pitch];
+        uint8_t *p_out_u = &p_u->p_pixels[y * p_u->i_pitch];
+        uint8_t *p_out_v = &p_v->p_pixels[y * p_v->i_pitch];
+        unsigned x = 0;
+
+#ifdef CAN_COMPILE_SSE2
+        if( vlc_CPU_SSE2() )
+            x = SSE_SplitUV( p_out_u, p_out_v, p_in, i_width );
+#endif
+        for( ; x < i_width; x++ )
+        {
+            p_out_u[x] = p_in[2*x];
+            p_out_v[x] = p_in[2*x+1];
+        }
+    }
+}
+
+static void MergeUV( plane_t *p_uv, const plane_t *p_u, const plane_t *p_v )
+{
+    const unsigned i_width = __MIN( (unsigned)p_uv->i_visible_pitch / 2,
+                             __MIN( p_u->i_visible_pitch, p_v->i_visible_pitch ) );
+    const int i_height = __MIN( p_uv->i_visible_lines,
+                         __MIN( p_u->i_visible_lines, p_v->i_visible_lines ) );
+
+    for( int y = 0; y < i_height; y++ )
+    {
+        const uint8_t *p_in_u = &p_u->p_pixels[y * p_u->i_pitch];
+        const uint8_t *p_in_v = &p_v->p_pixels[y * p_v->i_pitch];
+        uint8_t *p_out = &p_uv->p_pixels[y * p_uv->i_pitch];
+        unsigned x = 0;
+
+#ifdef CAN_COMPILE_SSE2
+        if( vlc_CPU_SSE2() )
+            x = SSE_MergeUV( p_out, p_in_u, p_in_v, i_width );
+#endif
+        for( ; x < i_width; x++ )
+        {
+            p_out[2*x]   = p_in_u[x];
+            p_out[2*x+1] = p_in_v[x];
+        }
+    }
+}
+
+static void PackYUY2( plane_t *p_yuyv, const plane_t *p_y,
+                      const plane_t *p_u, const plane_t *p_v )
+{
+    const unsigned i_width = __MIN( (unsigned)p_yuyv->i_visible_pitch / 2,
+                                    (unsigned)p_y->i_visible_pitch ) & ~1;
+    const int i_height = __MIN( p_yuyv->i_visible_lines,
+                         __MIN( p_y->i_visible_lines,
+                         2 * __MIN( p_u->i_visible_lines, p_v->i_visible_lines ) ) );
+
+    /* Each chroma line is used for two luma lines */
+    for( int y = 0; y < i_height; y++ )
+    {
+        const uint8_t *p_in_y = &p_y->p_pixels[y * p_y->i_pitch];
+        const uint8_t *p_in_u = &p_u->p_pixels[y / 2 * p_u->i_pitch];
+        const uint8_t *p_in_v = &p_v->p_pixels[y / 2 * p_v->i_pitch];
+        uint8_t *p_out = &p_yuyv->p_pixels[y * p_yuyv->i_pitch];
+        unsigned x = 0;
+
+#ifdef CAN_COMPILE_SSE2
+        if( vlc_CPU_SSE2() )
+            x = SSE_PackYUY2( p_out, p_in_y, p_in_u, p_in_v, i_width );
+#endif
+        for( ; x < i_width; x += 2 )
+        {
+            p_out[2*x+0] = p_in_y[x];
+            p_out[2*x+1] = p_in_u[x/2];
+            p_out[2*x+2] = p_in_y[x+1];
+            p_out[2*x+3] = p_in_v[x/2];
+        }
+    }
+}
+
+int picture_ConvertPixels( picture_t *p_dst, const picture_t *p_src )
+{
+    const vlc_fourcc_t i_src = p_src->format.i_chroma;
+    const vlc_fourcc_t i_dst = p_dst->format.i_chroma;
+
+    if( i_src == i_dst )
+    {
+        picture_CopyPixels( p_dst, p_src );
+        return VLC_SUCCESS;
+    }
+
+    if( i_src == VLC_CODEC_NV12 )
+    {
+        const int i_u = GetUPlane( i_dst );
+        if( i_u < 0 )
+            return VLC_EGENERIC;
+
+        plane_CopyPixels( &p_dst->p[Y_PLANE], &p_src->p[Y_PLANE] );
+        SplitUV( &p_dst->p[i_u], &p_dst->p[3 - i_u], &p_src->p[1] );
+        return VLC_SUCCESS;
+    }
+
+    const int i_u = GetUPlane( i_src );
+    if( i_u < 0 )
+        return VLC_EGENERIC;
+
+    const plane_t *p_u = &p_src->p[i_u], *p_v = &p_src->p[3 - i_u];
+    switch( i_dst )
+    {
+        case VLC_CODEC_NV12:
+            plane_CopyPixels( &p_dst->p[Y_PLANE], &p_src->p[Y_PLANE] );
+            MergeUV( &p_dst->p[1], p_u, p_v );
+            return VLC_SUCCESS;
+        case VLC_CODEC_YUYV:
+            PackYUY2( &p_dst->p[0], &p_src->p[Y_PLANE], p_u, p_v );
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
 
 /*****************************************************************************
  *
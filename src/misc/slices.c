@@ -0,0 +1,236 @@
+/*****************************************************************************
+ * slices.c : Slice-threaded execution for filters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include "libvlc.h"
+
+/** A set of slices submitted with vlc_slice_exec() */
+struct vlc_slice_job
+{
+    vlc_slice_cb cb;
+    void *opaque;
+    unsigned count; /**< total number of slices */
+    unsigned next; /**< next slice to hand out */
+    unsigned running; /**< slices handed out but not completed yet */
+    struct vlc_slice_job *next_job;
+};
+
+/** Worker pool shared by all filters of a LibVLC instance */
+struct vlc_slice_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /**< signaled when a job is queued */
+    vlc_cond_t done; /**< signaled when a job is completed */
+    struct vlc_slice_job *first, **lastp; /**< jobs with slices left */
+    bool closing;
+    unsigned threadc;
+    vlc_thread_t threads[];
+};
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+
+/**
+ * Hands the next slice of a queued job out.
+ * The pool lock must be held.
+ */
+static unsigned vlc_slice_take(struct vlc_slice_pool *pool,
+                               struct vlc_slice_job *job)
+{
+    unsigned slice = job->next++;
+
+    assert(slice < job->count);
+    job->running++;
+
+    if (job->next == job->count)
+    {   /* Nothing left to hand out: dequeue the job */
+        struct vlc_slice_job **pp = &pool->first;
+
+        while (*pp != job)
+            pp = &(*pp)->next_job;
+
+        *pp = job->next_job;
+        if (pool->lastp == &job->next_job)
+            pool->lastp = pp;
+    }
+    return slice;
+}
+
+static void vlc_slice_run(struct vlc_slice_pool *pool,
+                          struct vlc_slice_job *job, unsigned slice)
+{
+    vlc_mutex_unlock(&pool->lock);
+    job->cb(job->opaque, slice, job->count);
+    vlc_mutex_lock(&pool->lock);
+
+    assert(job->running > 0);
+    if (--job->running == 0 && job->next == job->count)
+        vlc_cond_broadcast(&pool->done);
+}
+
+static void *vlc_slice_thread(void *data)
+{
+    struct vlc_slice_pool *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->first == NULL && !pool->closing)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->closing)
+            break;
+
+        struct vlc_slice_job *job = pool->first;
+
+        vlc_slice_run(pool, job, vlc_slice_take(pool, job));
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static unsigned vlc_slice_threads_count(libvlc_int_t *libvlc)
+{
+    int64_t count = var_InheritInteger(libvlc, "filter-threads");
+
+    if (count <= 0)
+        count = vlc_GetCPUCount();
+    if (count > 64)
+        count = 64;
+    return (count > 0) ? count : 1;
+}
+
+/**
+ * Gets the worker pool of a LibVLC instance, creating it if needed.
+ */
+static struct vlc_slice_pool *vlc_slice_pool_Get(vlc_object_t *obj)
+{
+    libvlc_priv_t *priv = libvlc_priv(obj->obj.libvlc);
+    struct vlc_slice_pool *pool;
+
+    vlc_mutex_lock(&pool_lock);
+    pool = priv->slices;
+    if (pool != NULL)
+        goto out;
+
+    unsigned threadc = vlc_slice_threads_count(obj->obj.libvlc) - 1;
+
+    pool = malloc(sizeof (*pool) + threadc * sizeof (pool->threads[0]));
+    if (unlikely(pool == NULL))
+        goto out;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->first = NULL;
+    pool->lastp = &pool->first;
+    pool->closing = false;
+    pool->threadc = 0;
+
+    while (pool->threadc < threadc)
+    {
+        if (vlc_clone(&pool->threads[pool->threadc], vlc_slice_thread, pool,
+                      VLC_THREAD_PRIORITY_LOW))
+            break;
+        pool->threadc++;
+    }
+
+    msg_Dbg(obj, "using %u slice worker thread(s)", pool->threadc);
+    priv->slices = pool;
+out:
+    vlc_mutex_unlock(&pool_lock);
+    return pool;
+}
+
+void vlc_slice_pool_Destroy(libvlc_int_t *libvlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(libvlc);
+    struct vlc_slice_pool *pool = priv->slices;
+
+    if (pool == NULL)
+        return;
+
+    vlc_mutex_lock(&pool->lock);
+    assert(pool->first == NULL);
+    pool->closing = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->threadc; i++)
+        vlc_join(pool->threads[i], NULL);
+
+    vlc_cond_destroy(&pool->done);
+    vlc_cond_destroy(&pool->wait);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+    priv->slices = NULL;
+}
+
+unsigned (vlc_slice_threads)(vlc_object_t *obj)
+{
+    struct vlc_slice_pool *pool = vlc_slice_pool_Get(obj);
+
+    return (pool != NULL) ? pool->threadc + 1 : 1;
+}
+
+void (vlc_slice_exec)(vlc_object_t *obj, vlc_slice_cb cb, void *opaque,
+                      unsigned count)
+{
+    struct vlc_slice_pool *pool = NULL;
+
+    if (count > 1)
+        pool = vlc_slice_pool_Get(obj);
+
+    if (pool == NULL || pool->threadc == 0)
+    {   /* Nothing to run in parallel */
+        for (unsigned i = 0; i < count; i++)
+            cb(opaque, i, count);
+        return;
+    }
+
+    struct vlc_slice_job job = {
+        .cb = cb,
+        .opaque = opaque,
+        .count = count,
+        .next = 0,
+        .running = 0,
+        .next_job = NULL,
+    };
+
+    vlc_mutex_lock(&pool->lock);
+    *pool->lastp = &job;
+    pool->lastp = &job.next_job;
+    vlc_cond_broadcast(&pool->wait);
+
+    /* The calling thread processes its own slices too, but only its own:
+     * it must not get stuck into another (possibly longer) job. */
+    while (job.next < job.count)
+        vlc_slice_run(pool, &job, vlc_slice_take(pool, &job));
+
+    while (job.running > 0)
+        vlc_cond_wait(&pool->done, &pool->lock);
+    vlc_mutex_unlock(&pool->lock);
+}
@@ -131,6 +131,33 @@ httpd_redirect_t *httpd_RedirectNew (httpd_host_t *host,
     vlc_assert_unreachable ();
 }
 
+int httpd_SegmentAppend (httpd_segment_t *seg, const void *data, size_t len)
+{
+    (void) seg; (void) data; (void) len;
+    vlc_assert_unreachable ();
+}
+
+void httpd_SegmentDelete (httpd_segment_t *seg)
+{
+    (void) seg;
+    vlc_assert_unreachable ();
+}
+
+void httpd_SegmentEnd (httpd_segment_t *seg)
+{
+    (void) seg;
+    vlc_assert_unreachable ();
+}
+
+httpd_segment_t *httpd_SegmentNew (httpd_host_t *host, const char *url,
+                                   const char *content_type,
+                                   const char *login, const char *password)
+{
+    (void) host; (void) url; (void) content_type;
+    (void) login; (void) password;
+    vlc_assert_unreachable ();
+}
+
 char *httpd_ServerIP (const httpd_client_t *client, char *ip, int *port)
 {
     (void) client; (void) ip; (void) port;
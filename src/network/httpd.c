@@ -64,6 +64,8 @@
 #endif
 
 static void httpd_ClientDestroy(httpd_client_t *cl);
+static void httpd_ClientDetach(httpd_host_t *host, httpd_client_t *cl);
+static void httpd_UrlDrain(httpd_url_t *, void (*)(void *), void *);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
 /* each host run in his own thread */
@@ -113,6 +115,12 @@ struct httpd_url_t
         httpd_callback_t     cb;
         httpd_callback_sys_t *p_sys;
     } catch[HTTPD_MSG_MAX];
+
+    /* Set when the URL was deleted while clients were still receiving an
+     * answer from it: the URL is kept out of the host table until the last
+     * of them is done, then released along with the owner data */
+    void (*pf_release)(void *);
+    void *p_release;
 };
 
 /* status */
@@ -164,6 +172,16 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* p_buffer (resp. answer.p_body) points to data owned by the
+     * answering object, which outlives the client: do not free it */
+    bool    b_buffer_borrowed;
+    bool    b_body_borrowed;
+
+    /* Chunked transfer encoding state of segment answers: size of the
+     * chunk whose header was just sent, 0 if the next piece is a header */
+    bool    b_chunked;
+    size_t  i_chunk;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -853,6 +871,214 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     free(stream);
 }
 
+/*****************************************************************************
+ * High Level Functions: httpd_segment_t
+ *****************************************************************************/
+#define HTTPD_SEGMENT_CHUNK (64 * 1024)
+
+struct httpd_segment_t
+{
+    vlc_mutex_t lock;
+    httpd_url_t *url;
+    char        *psz_mime;
+
+    /* The data is stored in fixed-size chunks, which are neither moved nor
+     * modified once written: clients send directly from them. */
+    uint8_t     **pp_chunks;
+    size_t      i_chunks;
+    size_t      i_size;
+    bool        b_ended;
+};
+
+static int httpd_SegmentCallBack(httpd_callback_sys_t *p_sys,
+                                 httpd_client_t *cl, httpd_message_t *answer,
+                                 const httpd_message_t *query)
+{
+    httpd_segment_t *seg = (httpd_segment_t *)p_sys;
+
+    if (!answer || !query || !cl)
+        return VLC_SUCCESS;
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    if (answer->i_body_offset == 0) {
+        vlc_mutex_lock(&seg->lock);
+        size_t i_size = seg->i_size;
+        bool b_ended = seg->b_ended;
+        vlc_mutex_unlock(&seg->lock);
+
+        /* Answer HTTP/1.1 clients in kind, so that they keep the
+         * connection open for the next segments */
+        answer->i_version = query->i_version >= 1 ? 1 : 0;
+        answer->i_status = 200;
+        httpd_MsgAdd(answer, "Content-Type", "%s", seg->psz_mime);
+        httpd_MsgAdd(answer, "Cache-Control", "no-cache");
+
+        cl->b_chunked = false;
+        cl->i_chunk = 0;
+        if (b_ended)
+            httpd_MsgAdd(answer, "Content-Length", "%zu", i_size);
+        else if (query->i_version >= 1) {
+            /* Partial segment: send what is there, then the rest as it
+             * comes */
+            httpd_MsgAdd(answer, "Transfer-Encoding", "chunked");
+            cl->b_chunked = true;
+        } else
+            httpd_MsgAdd(answer, "Connection", "close");
+
+        if (query->i_type != HTTPD_MSG_HEAD) {
+            cl->b_stream_mode = !b_ended;
+            answer->i_body_offset = 1; /* the position plus one */
+        }
+        return VLC_SUCCESS;
+    }
+
+    size_t i_pos = answer->i_body_offset - 1;
+    char *psz_chunk = NULL;
+
+    vlc_mutex_lock(&seg->lock);
+    if (cl->i_chunk > 0 || (i_pos < seg->i_size && !cl->b_chunked)) {
+        /* Send the data straight from the chunk storage */
+        size_t i_offset = i_pos % HTTPD_SEGMENT_CHUNK;
+        size_t i_len = __MIN(seg->i_size - i_pos,
+                             HTTPD_SEGMENT_CHUNK - i_offset);
+
+        if (cl->i_chunk > 0) {
+            i_len = cl->i_chunk;
+            cl->i_chunk = 0;
+        }
+        answer->p_body = &seg->pp_chunks[i_pos / HTTPD_SEGMENT_CHUNK][i_offset];
+        answer->i_body = i_len;
+        answer->i_body_offset += i_len;
+        cl->b_body_borrowed = true;
+    } else if (i_pos < seg->i_size) {
+        size_t i_len = __MIN(seg->i_size - i_pos,
+                             HTTPD_SEGMENT_CHUNK - i_pos % HTTPD_SEGMENT_CHUNK);
+
+        if (asprintf(&psz_chunk, "%s%zx\r\n", i_pos > 0 ? "\r\n" : "",
+                     i_len) >= 0)
+            cl->i_chunk = i_len;
+        else
+            psz_chunk = NULL;
+    } else if (seg->b_ended) {
+        if (cl->b_chunked) {
+            if (asprintf(&psz_chunk, "%s0\r\n\r\n",
+                         i_pos > 0 ? "\r\n" : "") < 0)
+                psz_chunk = NULL;
+        } else if (cl->b_stream_mode)
+            /* HTTP/1.0 answer delimited by the connection close */
+            httpd_MsgAdd(answer, "Connection", "close");
+        answer->i_body_offset = 0;
+    } else {
+        vlc_mutex_unlock(&seg->lock);
+        answer->i_type = HTTPD_MSG_NONE;
+        return VLC_EGENERIC; /* wait for more data */
+    }
+    vlc_mutex_unlock(&seg->lock);
+
+    if (psz_chunk != NULL) {
+        answer->p_body = (uint8_t *)psz_chunk;
+        answer->i_body = strlen(psz_chunk);
+    }
+    return VLC_SUCCESS;
+}
+
+httpd_segment_t *httpd_SegmentNew(httpd_host_t *host, const char *psz_url,
+                                  const char *psz_mime, const char *psz_user,
+                                  const char *psz_password)
+{
+    httpd_segment_t *seg = malloc(sizeof(*seg));
+    if (!seg)
+        return NULL;
+
+    seg->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
+    if (!seg->url) {
+        free(seg);
+        return NULL;
+    }
+
+    vlc_mutex_init(&seg->lock);
+    if (psz_mime == NULL || psz_mime[0] == '\0')
+        psz_mime = vlc_mime_Ext2Mime(psz_url);
+    seg->psz_mime = xstrdup(psz_mime);
+    seg->pp_chunks = NULL;
+    seg->i_chunks = 0;
+    seg->i_size = 0;
+    seg->b_ended = false;
+
+    httpd_UrlCatch(seg->url, HTTPD_MSG_HEAD, httpd_SegmentCallBack,
+                   (httpd_callback_sys_t*)seg);
+    httpd_UrlCatch(seg->url, HTTPD_MSG_GET, httpd_SegmentCallBack,
+                   (httpd_callback_sys_t*)seg);
+
+    return seg;
+}
+
+int httpd_SegmentAppend(httpd_segment_t *seg, const void *p_data, size_t i_data)
+{
+    const uint8_t *p = p_data;
+    int ret = VLC_SUCCESS;
+
+    vlc_mutex_lock(&seg->lock);
+    assert(!seg->b_ended);
+    while (i_data > 0) {
+        size_t i_offset = seg->i_size % HTTPD_SEGMENT_CHUNK;
+
+        if (seg->i_size == seg->i_chunks * HTTPD_SEGMENT_CHUNK) {
+            uint8_t **pp = realloc(seg->pp_chunks,
+                                   (seg->i_chunks + 1) * sizeof (*pp));
+            if (unlikely(pp == NULL)) {
+                ret = VLC_ENOMEM;
+                break;
+            }
+            seg->pp_chunks = pp;
+            pp[seg->i_chunks] = malloc(HTTPD_SEGMENT_CHUNK);
+            if (unlikely(pp[seg->i_chunks] == NULL)) {
+                ret = VLC_ENOMEM;
+                break;
+            }
+            seg->i_chunks++;
+        }
+
+        size_t i_copy = __MIN(i_data, HTTPD_SEGMENT_CHUNK - i_offset);
+
+        memcpy(&seg->pp_chunks[seg->i_chunks - 1][i_offset], p, i_copy);
+        seg->i_size += i_copy;
+        p += i_copy;
+        i_data -= i_copy;
+    }
+    vlc_mutex_unlock(&seg->lock);
+    return ret;
+}
+
+void httpd_SegmentEnd(httpd_segment_t *seg)
+{
+    vlc_mutex_lock(&seg->lock);
+    seg->b_ended = true;
+    vlc_mutex_unlock(&seg->lock);
+}
+
+static void httpd_SegmentRelease(void *data)
+{
+    httpd_segment_t *seg = data;
+
+    for (size_t i = 0; i < seg->i_chunks; i++)
+        free(seg->pp_chunks[i]);
+    free(seg->pp_chunks);
+    vlc_mutex_destroy(&seg->lock);
+    free(seg->psz_mime);
+    free(seg);
+}
+
+void httpd_SegmentDelete(httpd_segment_t *seg)
+{
+    /* Unfinished answers end with the data already there */
+    httpd_SegmentEnd(seg);
+    /* Clients still downloading the segment keep it until they are done */
+    httpd_UrlDrain(seg->url, httpd_SegmentRelease, seg);
+}
+
 /*****************************************************************************
  * Low level
  *****************************************************************************/
@@ -1029,9 +1255,13 @@ void httpd_HostDelete(httpd_host_t *host)
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
+    while (host->i_client > 0) {
+        httpd_client_t *cl = host->client[0];
+
         msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(host->client[i]);
+        TAB_REMOVE(host->i_client, host->client, cl);
+        httpd_ClientDetach(host, cl);
+        httpd_ClientDestroy(cl);
     }
     TAB_CLEAN(host->i_client, host->client);
 
@@ -1070,6 +1300,8 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
         url->catch[i].cb = NULL;
         url->catch[i].p_sys = NULL;
     }
+    url->pf_release = NULL;
+    url->p_release = NULL;
 
     TAB_APPEND(host->i_url, host->url, url);
     vlc_cond_signal(&host->wait);
@@ -1090,6 +1322,51 @@ int httpd_UrlCatch(httpd_url_t *url, int i_msg, httpd_callback_t cb,
     return VLC_SUCCESS;
 }
 
+static void httpd_UrlFree(httpd_url_t *url)
+{
+    vlc_mutex_destroy(&url->lock);
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
+    if (url->pf_release != NULL)
+        url->pf_release(url->p_release);
+    free(url);
+}
+
+static bool httpd_UrlInUse(const httpd_host_t *host, const httpd_url_t *url)
+{
+    for (int i = 0; i < host->i_client; i++)
+        if (host->client[i]->url == url)
+            return true;
+    return false;
+}
+
+/* Detaches a client from the URL it is answered by (host lock held) */
+static void httpd_ClientDetach(httpd_host_t *host, httpd_client_t *cl)
+{
+    httpd_url_t *url = cl->url;
+
+    cl->url = NULL;
+    if (url != NULL && url->pf_release != NULL && !httpd_UrlInUse(host, url))
+        httpd_UrlFree(url);
+}
+
+/* Unregisters a url, but lets the clients finish their current answer
+ * before releasing it, and the owner data with it */
+static void httpd_UrlDrain(httpd_url_t *url, void (*pf_release)(void *),
+                           void *p_release)
+{
+    httpd_host_t *host = url->host;
+
+    vlc_mutex_lock(&host->lock);
+    TAB_REMOVE(host->i_url, host->url, url);
+    url->pf_release = pf_release;
+    url->p_release = p_release;
+    if (!httpd_UrlInUse(host, url))
+        httpd_UrlFree(url);
+    vlc_mutex_unlock(&host->lock);
+}
+
 /* delete a url */
 void httpd_UrlDelete(httpd_url_t *url)
 {
@@ -1098,11 +1375,6 @@ void httpd_UrlDelete(httpd_url_t *url)
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
 
-    vlc_mutex_destroy(&url->lock);
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
-
     for (int i = 0; i < host->i_client; i++) {
         httpd_client_t *client = host->client[i];
 
@@ -1115,7 +1387,7 @@ void httpd_UrlDelete(httpd_url_t *url)
         httpd_ClientDestroy(client);
         i--;
     }
-    free(url);
+    httpd_UrlFree(url);
     vlc_mutex_unlock(&host->lock);
 }
 
@@ -1198,6 +1470,10 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->b_buffer_borrowed = false;
+    cl->b_body_borrowed = false;
+    cl->b_chunked = false;
+    cl->i_chunk = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1213,13 +1489,38 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
+/* Releases the send buffer */
+static void httpd_ClientFreeBuffer(httpd_client_t *cl)
+{
+    if (!cl->b_buffer_borrowed)
+        free(cl->p_buffer);
+    cl->p_buffer = NULL;
+    cl->b_buffer_borrowed = false;
+}
+
+/* Moves the answer body to the send buffer */
+static void httpd_ClientTakeBody(httpd_client_t *cl)
+{
+    httpd_ClientFreeBuffer(cl);
+    cl->p_buffer = cl->answer.p_body;
+    cl->i_buffer_size = cl->answer.i_body;
+    cl->i_buffer = 0;
+    cl->b_buffer_borrowed = cl->b_body_borrowed;
+
+    cl->answer.p_body = NULL;
+    cl->answer.i_body = 0;
+    cl->b_body_borrowed = false;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
     vlc_tls_Close(cl->sock);
+    if (cl->b_body_borrowed)
+        cl->answer.p_body = NULL;
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
-    free(cl->p_buffer);
+    httpd_ClientFreeBuffer(cl);
     free(cl);
 }
 
@@ -1572,9 +1873,9 @@ static void httpd_ClientSend(httpd_client_t *cl)
             i_size += strlen(cl->answer.p_headers[i].name) + 2 +
                       strlen(cl->answer.p_headers[i].value) + 2;
 
-        if (cl->i_buffer_size < i_size) {
+        if (cl->i_buffer_size < i_size || cl->b_buffer_borrowed) {
             cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
+            httpd_ClientFreeBuffer(cl);
             cl->p_buffer = xmalloc(i_size);
         }
         p = (char *)cl->p_buffer;
@@ -1612,13 +1913,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
             if (cl->answer.i_body > 0) {
                 /* send the body data */
-                free(cl->p_buffer);
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
-
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
+                httpd_ClientTakeBody(cl);
             } else /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
@@ -1716,6 +2011,7 @@ static void httpdLoop(httpd_host_t *host)
                         cl->i_activity_date+cl->i_activity_timeout < now)))) {
             TAB_REMOVE(host->i_client, host->client, cl);
             i_client--;
+            httpd_ClientDetach(host, cl);
             httpd_ClientDestroy(cl);
             continue;
         }
@@ -1884,7 +2180,7 @@ static void httpdLoop(httpd_host_t *host)
                     bool b_keepalive = false;
                     bool b_query = false;
 
-                    cl->url = NULL;
+                    httpd_ClientDetach(host, cl);
                     if (psz_connection) {
                         b_connection = (strcasecmp(psz_connection, "Close") == 0);
                         b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
@@ -1901,9 +2197,12 @@ static void httpdLoop(httpd_host_t *host)
                         httpd_MsgClean(&cl->query);
                         httpd_MsgInit(&cl->query);
 
+                        cl->b_stream_mode = false;
+                        cl->b_chunked = false;
+                        cl->i_chunk = 0;
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
+                        httpd_ClientFreeBuffer(cl);
                         cl->p_buffer = xmalloc(cl->i_buffer_size);
                         cl->i_state = HTTPD_CLIENT_RECEIVING;
                     } else
@@ -1914,8 +2213,7 @@ static void httpdLoop(httpd_host_t *host)
                     httpd_MsgClean(&cl->answer);
 
                     cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
+                    httpd_ClientFreeBuffer(cl);
                     cl->i_buffer = 0;
                     cl->i_buffer_size = 0;
 
@@ -1934,12 +2232,11 @@ static void httpdLoop(httpd_host_t *host)
                         &cl->answer, &cl->query);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    httpd_ClientTakeBody(cl);
+                    if (cl->i_buffer_size > 0)
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    else /* or the answer is complete */
+                        cl->i_state = HTTPD_CLIENT_SEND_DONE;
                 }
         }
 
@@ -47,12 +47,88 @@
 #include <vlc_block.h>
 #include <vlc_codec.h>
 #include <vlc_modules.h>
+#include <vlc_atomic.h>
 
 #include "input/input_interface.h"
 
 #define VLC_CODEC_NULL VLC_FOURCC( 'n', 'u', 'l', 'l' )
 
 #undef DEBUG_BUFFER
+
+/* Longest wait for an asynchronous muxer with a full queue */
+#define SOUT_MUX_WAIT_MAX (CLOCK_FREQ / 10)
+
+/* Shortest interval between updates of the muxer statistics variables */
+#define SOUT_MUX_STATS_PERIOD (CLOCK_FREQ / 4)
+
+enum
+{
+    SOUT_MUX_OVERFLOW_WAIT,
+    SOUT_MUX_OVERFLOW_DROP,
+};
+
+typedef struct
+{
+    sout_instance_t sout;
+
+    /* Back-pressure from the asynchronous muxers */
+    atomic_bool  b_wait; /**< a muxer queue was full during a send */
+    vlc_mutex_t  wait_lock;
+    vlc_cond_t   wait;
+    unsigned     i_congested; /**< muxers with a full queue */
+} sout_instance_priv_t;
+
+typedef struct
+{
+    sout_mux_t mux;
+
+    mtime_t    i_caching;
+
+    /* Asynchronous muxing */
+    bool         b_async;
+    vlc_thread_t thread;
+    vlc_mutex_t  lock; /**< serializes the calls to the muxer module */
+    vlc_sem_t    wakeup;
+    atomic_bool  dead;
+
+    vlc_mutex_t  queue_lock; /**< also protects b_waiting_stream */
+    size_t       i_queue_max; /**< in bytes, 0 if unlimited */
+    int          i_overflow;
+    bool         b_congested; /**< protected by the instance wait_lock */
+
+    /* Statistics, protected by queue_lock */
+    size_t       i_queue_peak;
+    mtime_t      i_latency_peak;
+    unsigned     i_dropped;
+
+    /* Largest values since the variables were last updated, only used by
+     * the muxer thread */
+    mtime_t      i_stats_date;
+    size_t       i_stats_queue;
+    mtime_t      i_stats_latency;
+} sout_mux_priv_t;
+
+typedef struct
+{
+    sout_input_t input;
+    bool         b_keyframes; /**< keyframes are flagged */
+    bool         b_dropping;
+} sout_input_priv_t;
+
+static inline sout_instance_priv_t *sout_priv( sout_instance_t *p_sout )
+{
+    return (sout_instance_priv_t *)p_sout;
+}
+
+static inline sout_mux_priv_t *mux_priv( sout_mux_t *p_mux )
+{
+    return (sout_mux_priv_t *)p_mux;
+}
+
+static inline sout_input_priv_t *input_priv( sout_input_t *p_input )
+{
+    return (sout_input_priv_t *)p_input;
+}
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -82,6 +158,7 @@ static void mrl_Clean( mrl_t *p_mrl );
  *****************************************************************************/
 sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest )
 {
+    sout_instance_priv_t *priv;
     sout_instance_t *p_sout;
     char *psz_chain;
 
@@ -100,12 +177,13 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
         return NULL;
 
     /* *** Allocate descriptor *** */
-    p_sout = vlc_custom_create( p_parent, sizeof( *p_sout ), "stream output" );
-    if( p_sout == NULL )
+    priv = vlc_custom_create( p_parent, sizeof( *priv ), "stream output" );
+    if( priv == NULL )
     {
         free( psz_chain );
         return NULL;
     }
+    p_sout = &priv->sout;
 
     msg_Dbg( p_sout, "using sout chain=`%s'", psz_chain );
 
@@ -116,6 +194,11 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
     vlc_mutex_init( &p_sout->lock );
     p_sout->p_stream = NULL;
 
+    atomic_init( &priv->b_wait, false );
+    vlc_mutex_init( &priv->wait_lock );
+    vlc_cond_init( &priv->wait );
+    priv->i_congested = 0;
+
     var_Create( p_sout, "sout-mux-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
 
     p_sout->p_stream = sout_StreamChainNew( p_sout, psz_chain, NULL, NULL );
@@ -130,6 +213,8 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
 
     FREENULL( p_sout->psz_sout );
 
+    vlc_cond_destroy( &priv->wait );
+    vlc_mutex_destroy( &priv->wait_lock );
     vlc_mutex_destroy( &p_sout->lock );
     vlc_object_release( p_sout );
     return NULL;
@@ -140,12 +225,16 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
  *****************************************************************************/
 void sout_DeleteInstance( sout_instance_t * p_sout )
 {
+    sout_instance_priv_t *priv = sout_priv( p_sout );
+
     /* remove the stream out chain */
     sout_StreamChainDelete( p_sout->p_stream, NULL );
 
     /* *** free all string *** */
     FREENULL( p_sout->psz_sout );
 
+    vlc_cond_destroy( &priv->wait );
+    vlc_mutex_destroy( &priv->wait_lock );
     vlc_mutex_destroy( &p_sout->lock );
 
     /* *** free structure *** */
@@ -235,6 +324,27 @@ void sout_InputFlush( sout_packetizer_input_t *p_input )
 /*****************************************************************************
  *
  *****************************************************************************/
+/**
+ * Waits for the asynchronous muxers to make room in their queue, but not
+ * forever: a muxer may be waiting for data from another of its inputs.
+ */
+static void sout_WaitMuxers( sout_instance_t *p_sout )
+{
+    sout_instance_priv_t *priv = sout_priv( p_sout );
+    mtime_t i_deadline = mdate() + SOUT_MUX_WAIT_MAX;
+
+    vlc_mutex_lock( &priv->wait_lock );
+    while( priv->i_congested > 0 )
+    {
+        if( vlc_cond_timedwait( &priv->wait, &priv->wait_lock, i_deadline ) )
+        {
+            msg_Warn( p_sout, "muxer queue full, muxer too slow" );
+            break;
+        }
+    }
+    vlc_mutex_unlock( &priv->wait_lock );
+}
+
 int sout_InputSendBuffer( sout_packetizer_input_t *p_input,
                           block_t *p_buffer )
 {
@@ -252,6 +362,10 @@ int sout_InputSendBuffer( sout_packetizer_input_t *p_input,
                                        p_input->id, p_buffer );
     vlc_mutex_unlock( &p_sout->lock );
 
+    /* Waiting with the lock held would also stall the other outputs */
+    if( atomic_exchange( &sout_priv( p_sout )->b_wait, false ) )
+        sout_WaitMuxers( p_sout );
+
     return i_ret;
 }
 
@@ -356,15 +470,172 @@ int sout_AccessOutControl (sout_access_out_t *access, int query, ...)
 /*****************************************************************************
  * sout_MuxNew: create a new mux
  *****************************************************************************/
+/* Bytes waiting in the muxer input FIFOs */
+static size_t MuxQueueSize( sout_mux_t *p_mux )
+{
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_mux->i_nb_inputs; i++ )
+        i_size += block_FifoSize( p_mux->pp_inputs[i]->p_fifo );
+    return i_size;
+}
+
+static void MuxSetCongested( sout_mux_t *p_mux, bool b_congested )
+{
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+    sout_instance_priv_t *sout = sout_priv( p_mux->p_sout );
+
+    vlc_mutex_lock( &sout->wait_lock );
+    if( priv->b_congested != b_congested )
+    {
+        priv->b_congested = b_congested;
+        if( b_congested )
+            sout->i_congested++;
+        else
+        {
+            sout->i_congested--;
+            vlc_cond_broadcast( &sout->wait );
+        }
+    }
+    vlc_mutex_unlock( &sout->wait_lock );
+}
+
+static bool MuxIsWaiting( sout_mux_t *p_mux )
+{
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+
+    vlc_mutex_lock( &priv->queue_lock );
+    bool b_waiting = p_mux->b_waiting_stream;
+    vlc_mutex_unlock( &priv->queue_lock );
+    return b_waiting;
+}
+
+static void MuxSetWaiting( sout_mux_t *p_mux, bool b_waiting )
+{
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+
+    vlc_mutex_lock( &priv->queue_lock );
+    p_mux->b_waiting_stream = b_waiting;
+    vlc_mutex_unlock( &priv->queue_lock );
+}
+
+static void *MuxThread( void *data )
+{
+    sout_mux_t *p_mux = data;
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+
+    for( ;; )
+    {
+        vlc_sem_wait( &priv->wakeup );
+        if( atomic_load( &priv->dead ) )
+            break;
+
+        mtime_t i_start = mdate();
+
+        vlc_mutex_lock( &priv->lock );
+        p_mux->pf_mux( p_mux );
+        size_t i_queue = MuxQueueSize( p_mux );
+        vlc_mutex_unlock( &priv->lock );
+
+        mtime_t i_latency = mdate() - i_start;
+
+        vlc_mutex_lock( &priv->queue_lock );
+        if( i_latency > priv->i_latency_peak )
+            priv->i_latency_peak = i_latency;
+        vlc_mutex_unlock( &priv->queue_lock );
+
+        if( priv->i_queue_max > 0 && i_queue < priv->i_queue_max )
+            MuxSetCongested( p_mux, false );
+
+        if( i_queue > priv->i_stats_queue )
+            priv->i_stats_queue = i_queue;
+        if( i_latency > priv->i_stats_latency )
+            priv->i_stats_latency = i_latency;
+        if( i_start >= priv->i_stats_date )
+        {
+            var_SetInteger( p_mux, "mux-queue", priv->i_stats_queue );
+            var_SetInteger( p_mux, "mux-latency", priv->i_stats_latency );
+            priv->i_stats_date = i_start + SOUT_MUX_STATS_PERIOD;
+            priv->i_stats_queue = 0;
+            priv->i_stats_latency = 0;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Applies the overflow policy of an asynchronous muxer.
+ * \return true if the buffer must be dropped
+ */
+static bool MuxQueueOverflow( sout_mux_t *p_mux, sout_input_t *p_input,
+                              const block_t *p_buffer )
+{
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+    sout_input_priv_t *in = input_priv( p_input );
+
+    if( p_buffer->i_flags & BLOCK_FLAG_TYPE_I )
+        in->b_keyframes = true;
+
+    if( priv->i_queue_max == 0 )
+        return false;
+
+    size_t i_size = MuxQueueSize( p_mux );
+
+    vlc_mutex_lock( &priv->queue_lock );
+    if( p_mux->b_waiting_stream )
+    {
+        vlc_mutex_unlock( &priv->queue_lock );
+        return false;
+    }
+    if( i_size > priv->i_queue_peak )
+        priv->i_queue_peak = i_size;
+
+    if( priv->i_overflow == SOUT_MUX_OVERFLOW_DROP )
+    {
+        bool b_drop = i_size >= priv->i_queue_max;
+
+        /* Video resumes on a keyframe */
+        if( !b_drop && in->b_dropping && in->b_keyframes
+         && p_input->p_fmt->i_cat == VIDEO_ES
+         && !(p_buffer->i_flags & BLOCK_FLAG_TYPE_I) )
+            b_drop = true;
+
+        if( b_drop )
+        {
+            if( !in->b_dropping )
+                msg_Warn( p_mux, "queue full (%zu bytes), dropping data",
+                          i_size );
+            priv->i_dropped++;
+        }
+        in->b_dropping = b_drop;
+        vlc_mutex_unlock( &priv->queue_lock );
+        return b_drop;
+    }
+
+    vlc_mutex_unlock( &priv->queue_lock );
+
+    /* The sender waits for the muxer once it has released the stream
+     * output lock (see sout_InputSendBuffer()) */
+    if( i_size >= priv->i_queue_max )
+    {
+        MuxSetCongested( p_mux, true );
+        atomic_store( &sout_priv( p_mux->p_sout )->b_wait, true );
+        vlc_sem_post( &priv->wakeup );
+    }
+    return false;
+}
+
 sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
                           sout_access_out_t *p_access )
 {
+    sout_mux_priv_t *priv;
     sout_mux_t *p_mux;
     char       *psz_next;
 
-    p_mux = vlc_custom_create( p_sout, sizeof( *p_mux ), "mux" );
-    if( p_mux == NULL )
+    priv = vlc_custom_create( p_sout, sizeof( *priv ), "mux" );
+    if( priv == NULL )
         return NULL;
+    p_mux = &priv->mux;
 
     p_mux->p_sout = p_sout;
     psz_next = config_ChainCreate( &p_mux->psz_mux, &p_mux->p_cfg, psz_mux );
@@ -381,10 +652,17 @@ sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
     p_mux->p_sys        = NULL;
     p_mux->p_module     = NULL;
 
+    vlc_mutex_init( &priv->queue_lock );
+    priv->b_congested = false;
+
     p_mux->b_add_stream_any_time = false;
     p_mux->b_waiting_stream = true;
     p_mux->i_add_stream_start = -1;
 
+    priv->i_caching = var_GetInteger( p_sout, "sout-mux-caching" )
+                    * INT64_C(1000);
+    priv->b_async = false;
+
     p_mux->p_module =
         module_need( p_mux, "sout mux", p_mux->psz_mux, true );
 
@@ -392,6 +670,7 @@ sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
     {
         FREENULL( p_mux->psz_mux );
 
+        vlc_mutex_destroy( &priv->queue_lock );
         vlc_object_release( p_mux );
         return NULL;
     }
@@ -411,7 +690,7 @@ sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
         {
             msg_Dbg( p_sout, "muxer support adding stream at any time" );
             p_mux->b_add_stream_any_time = true;
-            p_mux->b_waiting_stream = false;
+            MuxSetWaiting( p_mux, false );
 
             /* If we control the output pace then it's better to wait before
              * starting muxing (generates better streams/files). */
@@ -429,11 +708,40 @@ sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
             {
                 msg_Dbg( p_sout, "muxer prefers to wait for all ES before "
                          "starting to mux" );
-                p_mux->b_waiting_stream = true;
+                MuxSetWaiting( p_mux, true );
             }
         }
     }
 
+    if( var_InheritBool( p_mux, "sout-mux-async" ) )
+    {
+        vlc_mutex_init( &priv->lock );
+        vlc_sem_init( &priv->wakeup, 0 );
+        atomic_init( &priv->dead, false );
+        priv->i_queue_max = var_InheritInteger( p_mux, "sout-mux-queue" )
+                          * 1024;
+        priv->i_overflow = var_InheritInteger( p_mux, "sout-mux-overflow" );
+        priv->i_queue_peak = 0;
+        priv->i_latency_peak = 0;
+        priv->i_dropped = 0;
+        priv->i_stats_date = 0;
+        priv->i_stats_queue = 0;
+        priv->i_stats_latency = 0;
+
+        var_Create( p_mux, "mux-queue", VLC_VAR_INTEGER );
+        var_Create( p_mux, "mux-latency", VLC_VAR_INTEGER );
+
+        if( vlc_clone( &priv->thread, MuxThread, p_mux,
+                       VLC_THREAD_PRIORITY_OUTPUT ) == 0 )
+            priv->b_async = true;
+        else
+        {
+            msg_Warn( p_mux, "cannot start the muxer thread" );
+            vlc_sem_destroy( &priv->wakeup );
+            vlc_mutex_destroy( &priv->lock );
+        }
+    }
+
     return p_mux;
 }
 
@@ -442,10 +750,28 @@ sout_mux_t * sout_MuxNew( sout_instance_t *p_sout, const char *psz_mux,
  *****************************************************************************/
 void sout_MuxDelete( sout_mux_t *p_mux )
 {
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+
+    if( priv->b_async )
+    {
+        atomic_store( &priv->dead, true );
+        vlc_sem_post( &priv->wakeup );
+        vlc_join( priv->thread, NULL );
+        MuxSetCongested( p_mux, false );
+
+        msg_Dbg( p_mux, "queue peak %zu bytes, latency peak %"PRId64" us, "
+                 "%u blocks dropped", priv->i_queue_peak,
+                 priv->i_latency_peak, priv->i_dropped );
+
+        vlc_sem_destroy( &priv->wakeup );
+        vlc_mutex_destroy( &priv->lock );
+    }
+
     if( p_mux->p_module )
     {
         module_unneed( p_mux, p_mux->p_module );
     }
+    vlc_mutex_destroy( &priv->queue_lock );
     free( p_mux->psz_mux );
 
     config_ChainDestroy( p_mux->p_cfg );
@@ -458,9 +784,11 @@ void sout_MuxDelete( sout_mux_t *p_mux )
  *****************************************************************************/
 sout_input_t *sout_MuxAddStream( sout_mux_t *p_mux, const es_format_t *p_fmt )
 {
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+    sout_input_priv_t *in;
     sout_input_t *p_input;
 
-    if( !p_mux->b_add_stream_any_time && !p_mux->b_waiting_stream )
+    if( !p_mux->b_add_stream_any_time && !MuxIsWaiting( p_mux ) )
     {
         msg_Err( p_mux, "cannot add a new stream (unsupported while muxing "
                         "to this format). You can try increasing sout-mux-caching value" );
@@ -470,9 +798,12 @@ sout_input_t *sout_MuxAddStream( sout_mux_t *p_mux, const es_format_t *p_fmt )
     msg_Dbg( p_mux, "adding a new input" );
 
     /* create a new sout input */
-    p_input = malloc( sizeof( sout_input_t ) );
-    if( !p_input )
+    in = malloc( sizeof( *in ) );
+    if( !in )
         return NULL;
+    in->b_keyframes = false;
+    in->b_dropping = false;
+    p_input = &in->input;
 
     // FIXME: remove either fmt or p_fmt...
     es_format_Copy( &p_input->fmt, p_fmt );
@@ -481,16 +812,22 @@ sout_input_t *sout_MuxAddStream( sout_mux_t *p_mux, const es_format_t *p_fmt )
     p_input->p_fifo = block_FifoNew();
     p_input->p_sys  = NULL;
 
+    if( priv->b_async )
+        vlc_mutex_lock( &priv->lock );
     TAB_APPEND( p_mux->i_nb_inputs, p_mux->pp_inputs, p_input );
     if( p_mux->pf_addstream( p_mux, p_input ) < 0 )
     {
         msg_Err( p_mux, "cannot add this stream" );
         TAB_REMOVE( p_mux->i_nb_inputs, p_mux->pp_inputs, p_input );
+        if( priv->b_async )
+            vlc_mutex_unlock( &priv->lock );
         block_FifoRelease( p_input->p_fifo );
         es_format_Clean( &p_input->fmt );
-        free( p_input );
+        free( in );
         return NULL;
     }
+    if( priv->b_async )
+        vlc_mutex_unlock( &priv->lock );
 
     return p_input;
 }
@@ -500,14 +837,18 @@ sout_input_t *sout_MuxAddStream( sout_mux_t *p_mux, const es_format_t *p_fmt )
  *****************************************************************************/
 void sout_MuxDeleteStream( sout_mux_t *p_mux, sout_input_t *p_input )
 {
+    sout_mux_priv_t *priv = mux_priv( p_mux );
     int i_index;
 
-    if( p_mux->b_waiting_stream
-     && block_FifoCount( p_input->p_fifo ) > 0 )
+    if( priv->b_async )
+        vlc_mutex_lock( &priv->lock );
+
+    if( block_FifoCount( p_input->p_fifo ) > 0
+     && (MuxIsWaiting( p_mux ) || priv->b_async) )
     {
         /* We stop waiting, and call the muxer for taking care of the data
          * before we remove this es */
-        p_mux->b_waiting_stream = false;
+        MuxSetWaiting( p_mux, false );
         p_mux->pf_mux( p_mux );
     }
 
@@ -526,8 +867,11 @@ void sout_MuxDeleteStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
         block_FifoRelease( p_input->p_fifo );
         es_format_Clean( &p_input->fmt );
-        free( p_input );
+        free( input_priv( p_input ) );
     }
+
+    if( priv->b_async )
+        vlc_mutex_unlock( &priv->lock );
 }
 
 /*****************************************************************************
@@ -536,7 +880,15 @@ void sout_MuxDeleteStream( sout_mux_t *p_mux, sout_input_t *p_input )
 int sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
                          block_t *p_buffer )
 {
+    sout_mux_priv_t *priv = mux_priv( p_mux );
     mtime_t i_dts = p_buffer->i_dts;
+
+    if( priv->b_async && MuxQueueOverflow( p_mux, p_input, p_buffer ) )
+    {
+        block_Release( p_buffer );
+        return VLC_SUCCESS;
+    }
+
     block_FifoPut( p_input->p_fifo, p_buffer );
 
     if( p_mux->p_sout->i_out_pace_nocontrol )
@@ -547,26 +899,40 @@ int sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
                       current_date - i_dts );
     }
 
+    vlc_mutex_lock( &priv->queue_lock );
     if( p_mux->b_waiting_stream )
     {
-        const int64_t i_caching = var_GetInteger( p_mux->p_sout, "sout-mux-caching" ) * INT64_C(1000);
-
         if( p_mux->i_add_stream_start < 0 )
             p_mux->i_add_stream_start = i_dts;
 
         /* Wait until we have enough data before muxing */
         if( p_mux->i_add_stream_start < 0 ||
-            i_dts < p_mux->i_add_stream_start + i_caching )
+            i_dts < p_mux->i_add_stream_start + priv->i_caching )
+        {
+            vlc_mutex_unlock( &priv->queue_lock );
             return VLC_SUCCESS;
+        }
         p_mux->b_waiting_stream = false;
     }
+    vlc_mutex_unlock( &priv->queue_lock );
+
+    if( priv->b_async )
+    {
+        vlc_sem_post( &priv->wakeup );
+        return VLC_SUCCESS;
+    }
     return p_mux->pf_mux( p_mux );
 }
 
 void sout_MuxFlush( sout_mux_t *p_mux, sout_input_t *p_input )
 {
-    VLC_UNUSED(p_mux);
+    sout_mux_priv_t *priv = mux_priv( p_mux );
+
+    if( priv->b_async )
+        vlc_mutex_lock( &priv->lock );
     block_FifoEmpty( p_input->p_fifo );
+    if( priv->b_async )
+        vlc_mutex_unlock( &priv->lock );
 }
 
 /*****************************************************************************
@@ -86,11 +86,55 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block_t *first = block_Share (&block);
+    assert (first != NULL);
+    block_t *second = block_Share (&block);
+    assert (second != NULL);
+    assert (first->p_buffer == block->p_buffer);
+    assert (second->p_buffer == block->p_buffer);
+    assert (first->i_pts == 42);
+
+    /* Views are independent */
+    first->p_buffer += 5;
+    first->i_buffer -= 5;
+    assert (!memcmp (first->p_buffer, text + 5, sizeof (text) - 5));
+    assert (!memcmp (second->p_buffer, text, sizeof (text)));
+
+    /* Growing a view must not touch the shared payload */
+    first = block_Realloc (first, 5, first->i_buffer);
+    assert (first != NULL);
+    assert (first->p_buffer != block->p_buffer);
+    memset (first->p_buffer, 'A', 5);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (first);
+
+    second = block_Unshare (second);
+    assert (second != NULL);
+    assert (second->p_buffer != block->p_buffer);
+    memset (second->p_buffer, 'B', second->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (second);
+
+    /* Last reference: the payload is writable */
+    block = block_Unshare (block);
+    assert (block != NULL);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (block);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Share ();
     return 0;
 }
 
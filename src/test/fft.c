@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * fft.c: fast Fourier transform test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_fft.h>
+
+static void test_fft(unsigned size)
+{
+    float *in = malloc(size * sizeof (float));
+    float *re = malloc((size / 2 + 1) * sizeof (float));
+    float *im = malloc((size / 2 + 1) * sizeof (float));
+    unsigned seed = size;
+
+    assert(in != NULL && re != NULL && im != NULL);
+    for (unsigned i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        in[i] = (float)((seed >> 16) & 0x7fff) / 16384.f - 1.f;
+    }
+
+    vlc_fft_t *fft = vlc_fft_Get(size);
+    assert(fft != NULL);
+    vlc_fft_Real(fft, in, re, im);
+
+    /* Naive discrete Fourier transform */
+    double err = 0.;
+
+    for (unsigned k = 0; k <= size / 2; k++)
+    {
+        double xr = 0., xi = 0.;
+
+        for (unsigned n = 0; n < size; n++)
+        {
+            double theta = -2. * M_PI * (double)((k * n) % size) / size;
+
+            xr += in[n] * cos(theta);
+            xi += in[n] * sin(theta);
+        }
+        err = fmax(err, fabs(xr - re[k]));
+        err = fmax(err, fabs(xi - im[k]));
+    }
+
+    printf("%u points: max error %g\n", size, err);
+    /* Rounding errors grow with the logarithm of the size */
+    assert(err < 1e-6 * size);
+
+    /* Plans are shared */
+    vlc_fft_t *fft2 = vlc_fft_Get(size);
+    assert(fft2 == fft);
+    vlc_fft_Release(fft2);
+    vlc_fft_Release(fft);
+
+    free(im);
+    free(re);
+    free(in);
+}
+
+int main(void)
+{
+    assert(vlc_fft_Get(0) == NULL);
+    assert(vlc_fft_Get(2) == NULL);
+    assert(vlc_fft_Get(1000) == NULL);
+
+    for (unsigned size = 4; size <= 8192; size *= 2)
+        test_fft(size);
+    return 0;
+}
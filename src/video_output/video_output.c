@@ -39,6 +39,7 @@
 #include <stdlib.h>                                                /* free() */
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 
 #include <vlc_vout.h>
 
@@ -848,6 +849,191 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
     return VLC_SUCCESS;
 }
 
+/**
+ * Fingerprints the regions of a subpicture, without holding their pictures.
+ * \return the number of regions, or UINT_MAX if there are too many of them
+ */
+static unsigned SpuFingerprint(vout_spu_region_t *regions,
+                               const subpicture_t *subpic)
+{
+    unsigned count = 0;
+
+    for (const subpicture_region_t *r = subpic->p_region; r != NULL;
+         r = r->p_next) {
+        if (count >= VOUT_SPU_CACHE_REGIONS)
+            return UINT_MAX;
+
+        /* The palette is copied into each rendered region: hash it */
+        uint32_t palette = 0;
+        if (r->fmt.p_palette != NULL) {
+            const uint8_t *p = (const uint8_t *)r->fmt.p_palette->palette;
+            size_t size = r->fmt.p_palette->i_entries
+                        * sizeof (r->fmt.p_palette->palette[0]);
+
+            palette = 2166136261u;
+            for (size_t i = 0; i < size; i++)
+                palette = (palette ^ p[i]) * 16777619u; /* FNV-1a */
+        }
+
+        vout_spu_region_t *region = &regions[count++];
+        region->picture = r->p_picture;
+        region->x       = r->i_x;
+        region->y       = r->i_y;
+        region->width   = r->fmt.i_visible_width;
+        region->height  = r->fmt.i_visible_height;
+        region->crop_x  = r->fmt.i_x_offset;
+        region->crop_y  = r->fmt.i_y_offset;
+        region->alpha   = subpic->i_alpha * r->i_alpha / 255;
+        region->palette = palette;
+    }
+    return count;
+}
+
+static bool SpuRegionsEqual(const vout_spu_region_t *a,
+                            const vout_spu_region_t *b, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        if (a[i].picture != b[i].picture ||
+            a[i].x != b[i].x || a[i].y != b[i].y ||
+            a[i].width != b[i].width || a[i].height != b[i].height ||
+            a[i].crop_x != b[i].crop_x || a[i].crop_y != b[i].crop_y ||
+            a[i].alpha != b[i].alpha || a[i].palette != b[i].palette)
+            return false;
+    return true;
+}
+
+/**
+ * Replaces the cached regions, holding their pictures.
+ */
+static void SpuCacheSetRegions(vout_thread_t *vout,
+                               const vout_spu_region_t *regions,
+                               unsigned count)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Hold(regions[i].picture);
+    for (unsigned i = 0; i < sys->spu_cache.count; i++)
+        picture_Release(sys->spu_cache.regions[i].picture);
+
+    for (unsigned i = 0; i < count; i++)
+        sys->spu_cache.regions[i] = regions[i];
+    sys->spu_cache.count = count;
+}
+
+/**
+ * Copies the area covered by a subpicture region from src to dst.
+ */
+static void SpuRestoreRegion(picture_t *dst, const picture_t *src,
+                             const vout_spu_region_t *region)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(dst->format.i_chroma);
+    if (dsc == NULL) {
+        picture_Copy(dst, src);
+        return;
+    }
+
+    /* Align on 16 pixels so that no subsampled or packed pixel is split */
+    int x0 = __MAX(region->x, 0) & ~15;
+    int y0 = __MAX(region->y, 0) & ~15;
+    int x1 = __MIN((int64_t)region->x + region->width,
+                   (int64_t)dst->format.i_width);
+    int y1 = __MIN((int64_t)region->y + region->height,
+                   (int64_t)dst->format.i_height);
+    x1 = __MIN((x1 + 15) & ~15, (int)dst->format.i_width);
+    y1 = __MIN((y1 + 15) & ~15, (int)dst->format.i_height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (int i = 0; i < dst->i_planes && i < src->i_planes; i++) {
+        plane_t *d = &dst->p[i];
+        const plane_t *s = &src->p[i];
+        unsigned wn = dsc->p[i].w.num, wd = dsc->p[i].w.den;
+        unsigned hn = dsc->p[i].h.num, hd = dsc->p[i].h.den;
+        size_t offset = x0 * wn / wd * dsc->pixel_size;
+        size_t size = __MIN((x1 * wn + wd - 1) / wd * dsc->pixel_size,
+                            (size_t)__MIN(d->i_pitch, s->i_pitch)) - offset;
+        int lines = __MIN(d->i_lines, s->i_lines);
+        int ystart = y0 * hn / hd;
+        int yend = __MIN((int)((y1 * hn + hd - 1) / hd), lines);
+
+        for (int y = ystart; y < yend; y++)
+            memcpy(&d->p_pixels[y * d->i_pitch + offset],
+                   &s->p_pixels[y * s->i_pitch + offset], size);
+    }
+}
+
+static void SpuCacheRelease(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->spu_cache.blent != NULL) {
+        picture_Release(sys->spu_cache.blent);
+        picture_Release(sys->spu_cache.source);
+        sys->spu_cache.blent  = NULL;
+        sys->spu_cache.source = NULL;
+    }
+    SpuCacheSetRegions(vout, NULL, 0);
+}
+
+/**
+ * Blends a subpicture into a private copy of the filtered picture.
+ *
+ * While the same picture is being displayed (pause, stills, low frame rate
+ * video with faster subtitles or OSD), the previous blending is reused
+ * as is if the subpicture did not change. Otherwise only the areas covered by
+ * the old and new regions are restored from the source before blending.
+ *
+ * \return the blent picture, or NULL on error
+ */
+static picture_t *ThreadBlendEarlySpu(vout_thread_t *vout, picture_t *filtered,
+                                      subpicture_t *subpic)
+{
+    vout_thread_sys_t *sys = vout->p;
+    vout_spu_region_t regions[VOUT_SPU_CACHE_REGIONS];
+    /* Only pictures straight from the decoder are cached: they are held until
+     * the next one anyway, while filter outputs are new on each call. */
+    const bool cacheable = filtered == sys->displayed.current;
+    unsigned count = cacheable ? SpuFingerprint(regions, subpic) : UINT_MAX;
+    picture_t *blent = sys->spu_cache.blent;
+
+    if (count <= VOUT_SPU_CACHE_REGIONS && blent != NULL &&
+        sys->spu_cache.source == filtered) {
+        if (count == sys->spu_cache.count &&
+            SpuRegionsEqual(regions, sys->spu_cache.regions, count))
+            return picture_Hold(blent);
+
+        if (!picture_IsReferenced(blent)) {
+            for (unsigned i = 0; i < sys->spu_cache.count; i++)
+                SpuRestoreRegion(blent, filtered, &sys->spu_cache.regions[i]);
+            picture_BlendSubpicture(blent, sys->spu_blend, subpic);
+
+            SpuCacheSetRegions(vout, regions, count);
+            return picture_Hold(blent);
+        }
+    }
+    SpuCacheRelease(vout);
+
+    blent = picture_pool_Get(sys->private_pool);
+    if (blent == NULL)
+        return NULL;
+
+    VideoFormatCopyCropAr(&blent->format, &filtered->format);
+    picture_Copy(blent, filtered);
+    if (!picture_BlendSubpicture(blent, sys->spu_blend, subpic)) {
+        picture_Release(blent);
+        return NULL;
+    }
+
+    if (count <= VOUT_SPU_CACHE_REGIONS) {
+        sys->spu_cache.source = picture_Hold(filtered);
+        sys->spu_cache.blent  = picture_Hold(blent);
+        SpuCacheSetRegions(vout, regions, count);
+    }
+    return blent;
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -953,22 +1139,23 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
      */
     bool is_direct = vout->p->decoder_pool == vout->p->display_pool;
     picture_t *todisplay = filtered;
-    if (do_early_spu && subpic) {
+    /* If the picture must be copied to a display buffer anyway, blend
+     * straight into it (unless it is slow to read back) */
+    const bool do_direct_spu = do_early_spu && subpic && vout->p->spu_blend &&
+                               sys->display.use_dr && !is_direct &&
+                               !vd->info.is_slow;
+    if (do_early_spu && subpic && !do_direct_spu) {
         if (vout->p->spu_blend) {
-            picture_t *blent = picture_pool_Get(vout->p->private_pool);
+            picture_t *blent = ThreadBlendEarlySpu(vout, filtered, subpic);
             if (blent) {
-                VideoFormatCopyCropAr(&blent->format, &filtered->format);
-                picture_Copy(blent, filtered);
-                if (picture_BlendSubpicture(blent, vout->p->spu_blend, subpic)) {
-                    picture_Release(todisplay);
-                    todisplay = blent;
-                } else
-                    picture_Release(blent);
+                picture_Release(todisplay);
+                todisplay = blent;
             }
         }
         subpicture_Delete(subpic);
         subpic = NULL;
-    }
+    } else
+        SpuCacheRelease(vout);
 
     assert(vout_IsDisplayFiltered(vd) == !sys->display.use_dr);
     if (sys->display.use_dr && !is_direct) {
@@ -990,6 +1177,12 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         picture_Copy(direct, todisplay);
         picture_Release(todisplay);
         todisplay = direct;
+
+        if (do_direct_spu) {
+            picture_BlendSubpicture(direct, vout->p->spu_blend, subpic);
+            subpicture_Delete(subpic);
+            subpic = NULL;
+        }
     }
 
     /*
@@ -1185,6 +1378,7 @@ static void ThreadFlush(vout_thread_t *vout, bool below, mtime_t date)
     vout->p->step.last      = VLC_TS_INVALID;
 
     ThreadFilterFlush(vout, false); /* FIXME too much */
+    SpuCacheRelease(vout);
 
     picture_t *last = vout->p->displayed.decoded;
     if (last) {
@@ -1405,6 +1599,9 @@ static int ThreadStart(vout_thread_t *vout, vout_display_state_t *state)
 
     vout->p->spu_blend_chroma        = 0;
     vout->p->spu_blend               = NULL;
+    vout->p->spu_cache.source        = NULL;
+    vout->p->spu_cache.blent         = NULL;
+    vout->p->spu_cache.count         = 0;
 
     video_format_Print(VLC_OBJECT(vout), "original format", &vout->p->original);
     return VLC_SUCCESS;
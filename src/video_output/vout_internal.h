@@ -43,6 +43,21 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/* Maximum number of subpicture regions tracked for blending reuse */
+#define VOUT_SPU_CACHE_REGIONS (16)
+
+/* Placement and content of a blent subpicture region. Rendered region
+ * pictures are not modified, so the picture itself identifies the content
+ * as long as it is held. */
+typedef struct {
+    picture_t *picture;
+    int      x, y;
+    unsigned width, height;
+    unsigned crop_x, crop_y; /* visible area offset within the picture */
+    int      alpha;
+    uint32_t palette; /* palette hash, if any */
+} vout_spu_region_t;
+
 /* */
 struct vout_thread_sys_t
 {
@@ -68,6 +83,15 @@ struct vout_thread_sys_t
     vlc_fourcc_t    spu_blend_chroma;
     filter_t        *spu_blend;
 
+    /* Last early subpicture blending, reused while the picture and
+     * the subpicture regions do not change */
+    struct {
+        picture_t         *source;
+        picture_t         *blent;
+        unsigned          count;
+        vout_spu_region_t regions[VOUT_SPU_CACHE_REGIONS];
+    } spu_cache;
+
     /* Video output window */
     vout_window_t   *window;
 
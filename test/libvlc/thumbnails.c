@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * thumbnails.c: test libvlc_media_t thumbnails API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static void
+thumbnail_cb(void *opaque, libvlc_time_t i_time, const void *p_data,
+             size_t i_size)
+{
+    static const uint8_t png_magic[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+    };
+    unsigned *pi_count = opaque;
+
+    assert(i_time >= 0);
+    assert(i_size > sizeof(png_magic));
+    assert(memcmp(p_data, png_magic, sizeof(png_magic)) == 0);
+    (*pi_count)++;
+}
+
+static void
+test_thumbnails(const char **argv, int argc)
+{
+    const libvlc_time_t p_times[] = { 0, 0 };
+    unsigned i_count = 0;
+
+    log("Testing thumbnails\n");
+
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    libvlc_media_t *p_m = libvlc_media_new_path(vlc, test_default_video);
+    assert(p_m != NULL);
+
+    /* Unknown image format */
+    assert(libvlc_media_thumbnails(p_m, p_times, 1, 32, 0, "nope",
+                                   thumbnail_cb, &i_count) == -1);
+    assert(i_count == 0);
+
+    /* The same time twice: the media is seeked back for each thumbnail */
+    assert(libvlc_media_thumbnails(p_m, p_times, 2, 32, 0, "png",
+                                   thumbnail_cb, &i_count) == 2);
+    assert(i_count == 2);
+    libvlc_media_release(p_m);
+
+    /* Media that cannot be opened */
+    p_m = libvlc_media_new_path(vlc, SRCDIR"/samples/nonexistent.jpg");
+    assert(p_m != NULL);
+    i_count = 0;
+    assert(libvlc_media_thumbnails(p_m, p_times, 1, 32, 0, "png",
+                                   thumbnail_cb, &i_count) == -1);
+    assert(i_count == 0);
+    libvlc_media_release(p_m);
+
+    libvlc_release(vlc);
+}
+
+int
+main(void)
+{
+    test_init();
+
+    test_thumbnails(test_defaults_args, test_defaults_nargs);
+
+    return 0;
+}
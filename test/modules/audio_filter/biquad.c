@@ -0,0 +1,207 @@
+/*****************************************************************************
+ * biquad.c: vectorized IIR filters test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include "../modules/audio_filter/biquad.h"
+
+#define CHANNELS_MAX 8
+#define SAMPLES 4096
+/* The vector versions only sum in a different order */
+#define TOLERANCE 1e-4f
+
+static void fill(float *buf, unsigned count)
+{
+    unsigned seed = 1;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (float)((seed >> 16) & 0x7fff) / 16384.f - 1.f;
+    }
+}
+
+static void compare(const float *ref, const float *out, unsigned count,
+                    const char *name)
+{
+    float err = 0.f;
+
+    for (unsigned i = 0; i < count; i++)
+        err = fmaxf(err, fabsf(ref[i] - out[i]));
+    printf("%s: max error %g\n", name, err);
+    assert(err < TOLERANCE);
+}
+
+/* Stereo buffers as the filters get them, timed in ns per frame */
+#define BENCH_RUNS 200
+#define BENCH_CHANNELS 2
+
+static double bench_bank(biquad_bank_fn fn, const biquad_bank_t *bank,
+                         const float *src, float *dst)
+{
+    biquad_bank_state_t st[BENCH_CHANNELS];
+    mtime_t start;
+
+    memset(st, 0, sizeof (st));
+    start = mdate();
+    for (unsigned i = 0; i < BENCH_RUNS; i++)
+        for (unsigned ch = 0; ch < BENCH_CHANNELS; ch++)
+            fn(bank, &st[ch], dst + ch, src + ch, BENCH_CHANNELS, SAMPLES,
+               0.25f, 0.9f);
+    return (double)(mdate() - start) * 1000. / (BENCH_RUNS * SAMPLES);
+}
+
+static double bench_cascade(biquad_cascade_fn fn, const float *coeffs,
+                            const float *src, float *dst)
+{
+    static float st[4 * 5 * BENCH_CHANNELS];
+    mtime_t start;
+
+    memset(st, 0, sizeof (st));
+    start = mdate();
+    for (unsigned i = 0; i < BENCH_RUNS; i++)
+        fn(coeffs, 5, st, dst, src, BENCH_CHANNELS, SAMPLES);
+    return (double)(mdate() - start) * 1000. / (BENCH_RUNS * SAMPLES);
+}
+
+static void test_bank(biquad_bank_fn fn, const char *name)
+{
+    biquad_bank_t bank;
+    biquad_bank_state_t ref_st[CHANNELS_MAX], st[CHANNELS_MAX];
+    static float src[SAMPLES * CHANNELS_MAX];
+    static float ref[SAMPLES * CHANNELS_MAX], out[SAMPLES * CHANNELS_MAX];
+
+    memset(&bank, 0, sizeof (bank));
+    bank.bands = 10;
+    for (unsigned i = 0; i < bank.bands; i++)
+    {   /* Band-pass filters from 60 Hz to 16 kHz at 48 kHz */
+        float theta = 2.f * (float)M_PI * 60.f * powf(2.f, 0.8f * i) / 48000.f;
+        float s = sinf(theta / 2.f);
+
+        bank.alpha[i] = s / (1.f + s);
+        bank.beta[i] = (1.f - s) / (1.f + s);
+        bank.gamma[i] = (1.f + bank.beta[i]) * cosf(theta);
+        bank.amp[i] = 0.25f * (i % 3) - 0.2f;
+    }
+
+    fill(src, SAMPLES * CHANNELS_MAX);
+
+    for (unsigned channels = 1; channels <= CHANNELS_MAX; channels++)
+    {
+        memset(ref_st, 0, sizeof (ref_st));
+        memset(st, 0, sizeof (st));
+
+        /* Several buffers, so that the state is carried over */
+        for (unsigned off = 0; off < SAMPLES; off += SAMPLES / 4)
+            for (unsigned ch = 0; ch < channels; ch++)
+            {
+                const float *in = &src[off * channels + ch];
+
+                biquad_bank_C(&bank, &ref_st[ch], &ref[off * channels + ch],
+                              in, channels, SAMPLES / 4, 0.25f, 0.9f);
+                fn(&bank, &st[ch], &out[off * channels + ch], in, channels,
+                   SAMPLES / 4, 0.25f, 0.9f);
+            }
+        compare(ref, out, SAMPLES * channels, name);
+    }
+
+    printf("%s: %.2f ns/frame (C %.2f ns/frame)\n", name,
+           bench_bank(fn, &bank, src, out),
+           bench_bank(biquad_bank_C, &bank, src, ref));
+}
+
+static void test_cascade(biquad_cascade_fn fn, const char *name)
+{
+    float coeffs[5 * 5];
+    static float ref_st[4 * 5 * CHANNELS_MAX], st[4 * 5 * CHANNELS_MAX];
+    static float src[SAMPLES * CHANNELS_MAX];
+    static float ref[SAMPLES * CHANNELS_MAX], out[SAMPLES * CHANNELS_MAX];
+
+    for (unsigned i = 0; i < 5; i++)
+    {   /* Peaking filters from the RBJ cookbook */
+        float w0 = 2.f * (float)M_PI * (100.f + 2000.f * i) / 48000.f;
+        float alpha = sinf(w0) / 6.f;
+        float a = powf(10.f, (3.f * i - 6.f) / 40.f);
+        float a0 = 1.f + alpha / a;
+
+        coeffs[5 * i + 0] = (1.f + alpha * a) / a0;
+        coeffs[5 * i + 1] = -2.f * cosf(w0) / a0;
+        coeffs[5 * i + 2] = (1.f - alpha * a) / a0;
+        coeffs[5 * i + 3] = -2.f * cosf(w0) / a0;
+        coeffs[5 * i + 4] = (1.f - alpha / a) / a0;
+    }
+
+    fill(src, SAMPLES * CHANNELS_MAX);
+
+    for (unsigned channels = 1; channels <= CHANNELS_MAX; channels++)
+    {
+        memset(ref_st, 0, sizeof (ref_st));
+        memset(st, 0, sizeof (st));
+
+        for (unsigned off = 0; off < SAMPLES; off += SAMPLES / 4)
+        {
+            const float *in = &src[off * channels];
+
+            biquad_cascade_C(coeffs, 5, ref_st, &ref[off * channels], in,
+                             channels, SAMPLES / 4);
+            fn(coeffs, 5, st, &out[off * channels], in, channels,
+               SAMPLES / 4);
+        }
+        compare(ref, out, SAMPLES * channels, name);
+    }
+
+    printf("%s: %.2f ns/frame (C %.2f ns/frame)\n", name,
+           bench_cascade(fn, coeffs, src, out),
+           bench_cascade(biquad_cascade_C, coeffs, src, ref));
+}
+
+int main(void)
+{
+    test_bank(biquad_bank_Get(), "bank");
+    test_cascade(biquad_cascade_Get(), "cascade");
+#ifdef BIQUAD_SSE
+    if (vlc_CPU_SSE())
+    {
+        test_bank(biquad_bank_SSE, "bank SSE");
+        test_cascade(biquad_cascade_SSE, "cascade SSE");
+    }
+#endif
+#ifdef BIQUAD_AVX
+    if (vlc_CPU_AVX())
+        test_bank(biquad_bank_AVX, "bank AVX");
+#endif
+#ifdef BIQUAD_NEON
+    test_bank(biquad_bank_NEON, "bank NEON");
+    test_cascade(biquad_cascade_NEON, "cascade NEON");
+#endif
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ * loudness.c: EBU R 128 loudness meter conformance test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Before test.h, which defines a log() macro */
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+#define DURATION 20 /* seconds */
+#define BUFFER_FRAMES 1024
+
+/* Tolerances of EBU Tech 3341 */
+#define LOUDNESS_TOLERANCE .1
+#define TRUE_PEAK_ABOVE .2
+#define TRUE_PEAK_BELOW .4
+
+/* Stereo sine, the same on both channels */
+typedef struct
+{
+    double frequency; /**< in Hz, or 0 for a quarter of the sample rate */
+    double phase; /**< in radians */
+    double level; /**< peak of the sine in dBFS */
+} signal_t;
+
+static filter_t *CreateMeter(libvlc_int_t *obj, unsigned rate)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = rate;
+    filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    filter->fmt_in.audio.i_original_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+
+    filter->p_module = module_need(filter, "audio filter", "loudness", true);
+    assert(filter->p_module != NULL);
+    return filter;
+}
+
+static void DeleteMeter(filter_t *filter)
+{
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_release(filter);
+}
+
+static void Feed(filter_t *filter, const signal_t *signal)
+{
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+    const double step = 2. * M_PI * (signal->frequency ? signal->frequency
+                                                       : rate / 4.) / rate;
+    const double amplitude = pow(10., signal->level / 20.);
+
+    for (unsigned frame = 0; frame < DURATION * rate; frame += BUFFER_FRAMES)
+    {
+        block_t *block = block_Alloc(2 * BUFFER_FRAMES * sizeof (float));
+        assert(block != NULL);
+
+        float *samples = (float *)block->p_buffer;
+        for (unsigned i = 0; i < BUFFER_FRAMES; i++)
+            samples[2 * i] = samples[2 * i + 1] =
+                amplitude * sin(step * (frame + i) + signal->phase);
+        block->i_nb_samples = BUFFER_FRAMES;
+
+        block = filter->pf_audio_filter(filter, block);
+        assert(block != NULL);
+        block_Release(block);
+    }
+}
+
+static void Check(libvlc_int_t *obj, const char *name, float expected,
+                  float below, float above)
+{
+    float value = var_GetFloat(obj, name);
+
+    log("  %s: %.2f (expected %.2f)\n", name, value, expected);
+    assert(value >= expected - below && value <= expected + above);
+}
+
+static void test_sine(libvlc_int_t *obj, unsigned rate)
+{
+    /* 1 kHz at -23 dBFS must read -23 LUFS (Tech 3341 case 1) */
+    static const signal_t sine = { 1000., 0., -23. };
+    filter_t *filter = CreateMeter(obj, rate);
+
+    log("Testing a 1 kHz sine at %u Hz\n", rate);
+    Feed(filter, &sine);
+    Check(obj, "loudness-momentary", -23.f,
+          LOUDNESS_TOLERANCE, LOUDNESS_TOLERANCE);
+    Check(obj, "loudness-short-term", -23.f,
+          LOUDNESS_TOLERANCE, LOUDNESS_TOLERANCE);
+    Check(obj, "loudness-integrated", -23.f,
+          LOUDNESS_TOLERANCE, LOUDNESS_TOLERANCE);
+    Check(obj, "loudness-true-peak", -23.f, TRUE_PEAK_BELOW, TRUE_PEAK_ABOVE);
+    DeleteMeter(filter);
+}
+
+static void test_true_peak(libvlc_int_t *obj, unsigned rate)
+{
+    /* At a quarter of the sample rate and 45 degrees off, the samples are
+     * 3 dB below the peaks of the sine, which only the oversampled signal
+     * shows */
+    static const signal_t sine = { 0., M_PI / 4., -6. };
+    filter_t *filter = CreateMeter(obj, rate);
+
+    log("Testing true peak at %u Hz\n", rate);
+    Feed(filter, &sine);
+    Check(obj, "loudness-true-peak", -6.f, TRUE_PEAK_BELOW, TRUE_PEAK_ABOVE);
+    DeleteMeter(filter);
+}
+
+int main(void)
+{
+    static const char *argv[] = {
+        "-v", "--ignore-config",
+    };
+    static const unsigned rates[] = { 48000, 44100 };
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++)
+    {
+        test_sine(vlc->p_libvlc_int, rates[i]);
+        test_true_peak(vlc->p_libvlc_int, rates[i]);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
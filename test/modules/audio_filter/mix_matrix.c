@@ -0,0 +1,223 @@
+/*****************************************************************************
+ * mix_matrix.c: vectorized channel mixing test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include "../modules/audio_filter/channel_mixer/mix_matrix.h"
+
+#define FRAMES 4099 /* not a multiple of the vector width */
+#define TOLERANCE 1e-6f
+
+/* The hand-written downmixes of the simple channel mixer, as references.
+ * The LFE channel, if any, is dropped unless the output has one too. */
+static void ref_5_x_to_2_0(float *dst, const float *src, unsigned frames,
+                           unsigned in)
+{
+    for (unsigned i = 0; i < frames; i++, src += in)
+    {
+        *dst++ = src[0] + 0.7071f * (src[4] + src[2]);
+        *dst++ = src[1] + 0.7071f * (src[4] + src[3]);
+    }
+}
+
+static void ref_7_x_to_2_0(float *dst, const float *src, unsigned frames,
+                           unsigned in)
+{
+    for (unsigned i = 0; i < frames; i++, src += in)
+    {
+        float ctr = src[6] * 0.7071f;
+        *dst++ = ctr + src[0] + src[2] / 4 + src[4] / 4;
+        *dst++ = ctr + src[1] + src[3] / 4 + src[5] / 4;
+    }
+}
+
+static void ref_5_x_to_1_0(float *dst, const float *src, unsigned frames,
+                           unsigned in)
+{
+    for (unsigned i = 0; i < frames; i++, src += in)
+        *dst++ = 0.7071f * (src[0] + src[1]) + src[4]
+               + 0.5f * (src[2] + src[3]);
+}
+
+static void ref_7_x_to_4_0(float *dst, const float *src, unsigned frames,
+                           unsigned in)
+{
+    for (unsigned i = 0; i < frames; i++, src += in)
+    {
+        *dst++ = src[6] + 0.5f * src[0] + src[2] / 6;
+        *dst++ = src[6] + 0.5f * src[1] + src[3] / 6;
+        *dst++ = src[2] / 6 + src[4];
+        *dst++ = src[3] / 6 + src[5];
+    }
+}
+
+static void ref_7_x_to_5_x(float *dst, const float *src, unsigned frames,
+                           unsigned in)
+{
+    for (unsigned i = 0; i < frames; i++, src += in)
+    {
+        *dst++ = src[0];
+        *dst++ = src[1];
+        *dst++ = (src[2] + src[4]) * 0.5f;
+        *dst++ = (src[3] + src[5]) * 0.5f;
+        *dst++ = src[6];
+        if (in == 8)
+            *dst++ = src[7];
+    }
+}
+
+struct term
+{
+    uint8_t out, in;
+    float coeff;
+};
+
+struct layout
+{
+    const char *name;
+    unsigned in, out;
+    const struct term *terms;
+    void (*ref)(float *, const float *, unsigned, unsigned);
+    bool vector; /**< whether a vector kernel is expected */
+};
+
+static const struct term t_5_x_to_2_0[] = {
+    { 0, 0, 1.f }, { 0, 2, .7071f }, { 0, 4, .7071f },
+    { 1, 1, 1.f }, { 1, 3, .7071f }, { 1, 4, .7071f },
+    { 0, 0, 0.f },
+};
+static const struct term t_7_x_to_2_0[] = {
+    { 0, 0, 1.f }, { 0, 2, .25f }, { 0, 4, .25f }, { 0, 6, .7071f },
+    { 1, 1, 1.f }, { 1, 3, .25f }, { 1, 5, .25f }, { 1, 6, .7071f },
+    { 0, 0, 0.f },
+};
+static const struct term t_5_x_to_1_0[] = {
+    { 0, 0, .7071f }, { 0, 1, .7071f }, { 0, 2, .5f }, { 0, 3, .5f },
+    { 0, 4, 1.f },
+    { 0, 0, 0.f },
+};
+static const struct term t_7_x_to_4_0[] = {
+    { 0, 0, .5f }, { 0, 2, 1.f / 6 }, { 0, 6, 1.f },
+    { 1, 1, .5f }, { 1, 3, 1.f / 6 }, { 1, 6, 1.f },
+    { 2, 2, 1.f / 6 }, { 2, 4, 1.f },
+    { 3, 3, 1.f / 6 }, { 3, 5, 1.f },
+    { 0, 0, 0.f },
+};
+static const struct term t_7_x_to_5_x[] = {
+    { 0, 0, 1.f }, { 1, 1, 1.f },
+    { 2, 2, .5f }, { 2, 4, .5f }, { 3, 3, .5f }, { 3, 5, .5f },
+    { 4, 6, 1.f }, { 5, 7, 1.f },
+    { 0, 0, 0.f },
+};
+
+static const struct layout layouts[] = {
+    { "5.1 to 2.0", 6, 2, t_5_x_to_2_0, ref_5_x_to_2_0, true },
+    { "5.0 to 2.0", 5, 2, t_5_x_to_2_0, ref_5_x_to_2_0, true },
+    { "7.1 to 2.0", 8, 2, t_7_x_to_2_0, ref_7_x_to_2_0, true },
+    { "7.0 to 2.0", 7, 2, t_7_x_to_2_0, ref_7_x_to_2_0, true },
+    { "5.1 to 1.0", 6, 1, t_5_x_to_1_0, ref_5_x_to_1_0, false },
+    { "7.1 to 4.0", 8, 4, t_7_x_to_4_0, ref_7_x_to_4_0, true },
+    { "7.0 to 4.0", 7, 4, t_7_x_to_4_0, ref_7_x_to_4_0, true },
+    { "7.1 to 5.1", 8, 6, t_7_x_to_5_x, ref_7_x_to_5_x, true },
+    { "7.0 to 5.0", 7, 5, t_7_x_to_5_x, ref_7_x_to_5_x, true },
+};
+
+static float src[FRAMES * MIX_CHANNELS_MAX];
+static float ref[FRAMES * MIX_CHANNELS_MAX], out[FRAMES * MIX_CHANNELS_MAX];
+
+static double bench(mix_fn fn, const struct layout *l, const mix_matrix_t *m)
+{
+    const unsigned runs = 200;
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < runs; i++)
+    {
+        if (fn != NULL)
+            fn(m, out, src, FRAMES);
+        else
+            l->ref(out, src, FRAMES, l->in);
+    }
+    return (double)(mdate() - start) * 1000. / (runs * FRAMES);
+}
+
+static void test_layout(const struct layout *l, bool vector)
+{
+    mix_matrix_t m;
+
+    mix_matrix_Init(&m, l->in, l->out);
+    for (const struct term *t = l->terms; t->coeff != 0.f; t++)
+        if (t->out < l->out && t->in < l->in)
+            mix_matrix_Set(&m, t->out, t->in, t->coeff);
+
+    mix_fn fn = vector ? mix_Get(&m) : mix_C;
+    if (vector && fn == mix_C)
+    {   /* No vector kernel for this layout or this CPU */
+#ifdef MIX_SSE
+        assert(!l->vector || !vlc_CPU_SSE());
+#endif
+        return;
+    }
+
+    l->ref(ref, src, FRAMES, l->in);
+    memset(out, 0, sizeof (out));
+    fn(&m, out, src, FRAMES);
+
+    float err = 0.f;
+    for (unsigned i = 0; i < FRAMES * l->out; i++)
+        err = fmaxf(err, fabsf(ref[i] - out[i]));
+    /* Nothing written past the end */
+    for (unsigned i = FRAMES * l->out; i < FRAMES * MIX_CHANNELS_MAX; i++)
+        assert(out[i] == 0.f);
+
+    printf("%s %s: max error %g, %.2f ns/frame (simple mixer %.2f ns/frame)\n",
+           l->name, vector ? "vector" : "C", err, bench(fn, l, &m),
+           bench(NULL, l, &m));
+    assert(err < TOLERANCE);
+}
+
+int main(void)
+{
+    unsigned seed = 1;
+
+    for (unsigned i = 0; i < FRAMES * MIX_CHANNELS_MAX; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (float)((seed >> 16) & 0x7fff) / 16384.f - 1.f;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(layouts); i++)
+    {
+        test_layout(&layouts[i], false);
+        test_layout(&layouts[i], true);
+    }
+    return 0;
+}
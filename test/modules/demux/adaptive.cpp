@@ -0,0 +1,273 @@
+/*****************************************************************************
+ * adaptive.cpp: adaptive streaming downloader test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "../../../modules/demux/adaptive/ID.cpp"
+#include "../../../modules/demux/adaptive/http/BytesRange.cpp"
+#include "../../../modules/demux/adaptive/http/ConnectionParams.cpp"
+#include "../../../modules/demux/adaptive/http/Sockets.cpp"
+#include "../../../modules/demux/adaptive/http/HTTPConnection.cpp"
+#include "../../../modules/demux/adaptive/http/HTTPConnectionManager.cpp"
+#include "../../../modules/demux/adaptive/http/Downloader.cpp"
+#include "../../../modules/demux/adaptive/http/Chunk.cpp"
+
+#define TEST_DOWNLOADS  3
+#define TEST_SEGMENT_SIZE (3 * HTTPChunkSource::CHUNK_SIZE + 123)
+
+/* Fake origin: segments are served from memory, and the ones under
+ * /stall/ are held back until the gate is opened. */
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    bool        gate_open;
+    unsigned    stalled;
+    unsigned    requests;
+} origin;
+
+static uint8_t segment_byte(unsigned index, size_t offset)
+{
+    return (index * 7 + offset) & 0xFF;
+}
+
+class TestConnection : public AbstractConnection
+{
+    public:
+        TestConnection(vlc_object_t *obj) : AbstractConnection(obj)
+        {
+            index = 0;
+            stall = false;
+            counted = false;
+        }
+
+        virtual bool canReuse(const ConnectionParams &params_) const
+        {
+            return available && params_.getHostname() == params.getHostname();
+        }
+
+        virtual int request(const std::string &path, const BytesRange &)
+        {
+            vlc_mutex_lock(&origin.lock);
+            origin.requests++;
+            vlc_mutex_unlock(&origin.lock);
+
+            stall = path.compare(0, 7, "/stall/") == 0;
+            counted = false;
+            if(sscanf(path.c_str(), "/%*[a-z]/%u", &index) != 1)
+                return VLC_EGENERIC;
+            contentLength = TEST_SEGMENT_SIZE;
+            bytesRead = 0;
+            return VLC_SUCCESS;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len)
+        {
+            if(stall)
+            {
+                vlc_mutex_lock(&origin.lock);
+                if(!counted)
+                {
+                    counted = true;
+                    origin.stalled++;
+                    vlc_cond_broadcast(&origin.wait);
+                }
+                while(!origin.gate_open)
+                    vlc_cond_wait(&origin.wait, &origin.lock);
+                vlc_mutex_unlock(&origin.lock);
+            }
+
+            if(len > contentLength - bytesRead)
+                len = contentLength - bytesRead;
+            uint8_t *p = reinterpret_cast<uint8_t *>(p_buffer);
+            for(size_t i = 0; i < len; i++)
+                p[i] = segment_byte(index, bytesRead + i);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b)
+        {
+            available = !b;
+        }
+
+    private:
+        unsigned index;
+        bool stall;
+        bool counted;
+};
+
+class TestConnectionFactory : public ConnectionFactory
+{
+    public:
+        virtual AbstractConnection * createConnection(vlc_object_t *obj,
+                                                      const ConnectionParams &)
+        {
+            return new TestConnection(obj);
+        }
+};
+
+static void origin_close(void)
+{
+    vlc_mutex_lock(&origin.lock);
+    origin.gate_open = false;
+    origin.stalled = 0;
+    vlc_mutex_unlock(&origin.lock);
+}
+
+static void origin_open(void)
+{
+    vlc_mutex_lock(&origin.lock);
+    origin.gate_open = true;
+    vlc_cond_broadcast(&origin.wait);
+    vlc_mutex_unlock(&origin.lock);
+}
+
+static void origin_wait_stalled(unsigned count)
+{
+    vlc_mutex_lock(&origin.lock);
+    while(origin.stalled < count)
+        vlc_cond_wait(&origin.wait, &origin.lock);
+    vlc_mutex_unlock(&origin.lock);
+}
+
+static unsigned origin_requests(void)
+{
+    vlc_mutex_lock(&origin.lock);
+    unsigned requests = origin.requests;
+    vlc_mutex_unlock(&origin.lock);
+    return requests;
+}
+
+static HTTPChunkBufferedSource * source_start(AbstractConnectionManager *mgr,
+                                              const char *dir, unsigned index)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://origin.test/%s/%u", dir, index);
+    HTTPChunkBufferedSource *source =
+            new HTTPChunkBufferedSource(url, mgr, adaptive::ID(index));
+    mgr->start(source);
+    return source;
+}
+
+static void source_check(HTTPChunkBufferedSource *source, unsigned index)
+{
+    size_t total = 0;
+    block_t *block;
+
+    while((block = source->readBlock()) != NULL)
+    {
+        for(size_t i = 0; i < block->i_buffer; i++)
+            assert(block->p_buffer[i] == segment_byte(index, total + i));
+        total += block->i_buffer;
+        block_Release(block);
+    }
+    assert(total == TEST_SEGMENT_SIZE);
+    assert(!source->isDownloading());
+    delete source;
+}
+
+static void test_prefetch(AbstractConnectionManager *mgr)
+{
+    origin_close();
+
+    /* The next segment must complete while the current one is stalled */
+    HTTPChunkBufferedSource *current = source_start(mgr, "stall", 0);
+    origin_wait_stalled(1);
+    HTTPChunkBufferedSource *next = source_start(mgr, "seg", 1);
+    source_check(next, 1);
+    assert(current->isDownloading());
+
+    origin_open();
+    source_check(current, 0);
+}
+
+static void test_concurrency(AbstractConnectionManager *mgr)
+{
+    HTTPChunkBufferedSource *sources[TEST_DOWNLOADS];
+
+    origin_close();
+
+    /* Every download thread gets a segment at the same time */
+    for(unsigned i = 0; i < TEST_DOWNLOADS; i++)
+        sources[i] = source_start(mgr, "stall", 2 + i);
+    origin_wait_stalled(TEST_DOWNLOADS);
+
+    /* A queued source is cancelled without ever being requested */
+    unsigned requests = origin_requests();
+    delete source_start(mgr, "seg", 2 + TEST_DOWNLOADS);
+    assert(origin_requests() == requests);
+
+    origin_open();
+    for(unsigned i = 0; i < TEST_DOWNLOADS; i++)
+        source_check(sources[i], 2 + i);
+
+    /* A source can be deleted while it is being downloaded */
+    delete source_start(mgr, "seg", 0);
+}
+
+int main(void)
+{
+    alarm(10);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    var_Create(obj, "adaptive-downloads", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "adaptive-downloads", TEST_DOWNLOADS);
+
+    vlc_mutex_init(&origin.lock);
+    vlc_cond_init(&origin.wait);
+    origin.gate_open = true;
+    origin.stalled = 0;
+    origin.requests = 0;
+
+    /* The manager owns the factory */
+    HTTPConnectionManager *mgr =
+            new HTTPConnectionManager(obj, new TestConnectionFactory());
+
+    test_prefetch(mgr);
+    test_concurrency(mgr);
+
+    delete mgr;
+
+    vlc_cond_destroy(&origin.wait);
+    vlc_mutex_destroy(&origin.lock);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * swscale.c: swscale chroma converter benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define FRAMES 50
+
+struct bench_case
+{
+    vlc_fourcc_t i_chroma_in;
+    unsigned i_width_in, i_height_in;
+    vlc_fourcc_t i_chroma_out;
+    unsigned i_width_out, i_height_out;
+};
+
+static const struct bench_case cases[] = {
+    { VLC_CODEC_I420, 1920, 1080, VLC_CODEC_RGB32, 1920, 1080 },
+    { VLC_CODEC_I420, 1920, 1080, VLC_CODEC_I420, 1280,  720 },
+    { VLC_CODEC_I420, 3840, 2160, VLC_CODEC_RGB32, 3840, 2160 },
+    { VLC_CODEC_I420, 3840, 2160, VLC_CODEC_I420, 1920, 1080 },
+    { VLC_CODEC_I420, 3840, 2160, VLC_CODEC_I420, 1280,  720 },
+    { VLC_CODEC_I420, 3840, 2160, VLC_CODEC_NV12, 3840, 2160 },
+};
+
+static picture_t *NewPicture(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static void FillPicture(picture_t *pic)
+{
+    unsigned seed = 1;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = (seed >> 16) + x + y;
+            }
+    }
+}
+
+/* Runs a conversion, returns the number of frames per second and the last
+ * output picture */
+static double Bench(libvlc_int_t *obj, const struct bench_case *c,
+                    picture_t **pp_out)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, c->i_chroma_in);
+    video_format_Setup(&filter->fmt_in.video, c->i_chroma_in,
+                       c->i_width_in, c->i_height_in,
+                       c->i_width_in, c->i_height_in, 1, 1);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, c->i_chroma_out);
+    video_format_Setup(&filter->fmt_out.video, c->i_chroma_out,
+                       c->i_width_out, c->i_height_out,
+                       c->i_width_out, c->i_height_out, 1, 1);
+    filter->owner.video.buffer_new = NewPicture;
+
+    filter->p_module = module_need(filter, "video converter", "swscale", true);
+    if (filter->p_module == NULL)
+    {
+        log("swscale cannot convert %4.4s to %4.4s, skipped\n",
+            (const char *)&c->i_chroma_in, (const char *)&c->i_chroma_out);
+        vlc_object_release(filter);
+        return 0.;
+    }
+
+    picture_t *in = picture_NewFromFormat(&filter->fmt_in.video);
+    assert(in != NULL);
+    FillPicture(in);
+
+    picture_t *out = NULL;
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        if (out != NULL)
+            picture_Release(out);
+        out = filter->pf_video_filter(filter, picture_Hold(in));
+        assert(out != NULL);
+    }
+    mtime_t duration = mdate() - start;
+
+    picture_Release(in);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_release(filter);
+
+    *pp_out = out;
+    return (double)FRAMES * CLOCK_FREQ / duration;
+}
+
+static unsigned MaxDifference(const picture_t *a, const picture_t *b)
+{
+    unsigned max = 0;
+
+    for (int i = 0; i < a->i_planes; i++)
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            for (int x = 0; x < pa->i_visible_pitch; x++)
+            {
+                int d = pa->p_pixels[y * pa->i_pitch + x]
+                      - pb->p_pixels[y * pb->i_pitch + x];
+                if ((unsigned)abs(d) > max)
+                    max = abs(d);
+            }
+    }
+    return max;
+}
+
+int main(void)
+{
+    static const char *argv_single[] = {
+        "-v", "--ignore-config", "--filter-threads=1",
+    };
+    static const char *argv_multi[] = {
+        "-v", "--ignore-config", "--filter-threads=0",
+    };
+
+    test_init();
+    alarm(0); /* benchmarks take their time */
+
+    libvlc_instance_t *single = libvlc_new(ARRAY_SIZE(argv_single),
+                                           argv_single);
+    libvlc_instance_t *multi = libvlc_new(ARRAY_SIZE(argv_multi), argv_multi);
+    assert(single != NULL && multi != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++)
+    {
+        const struct bench_case *c = &cases[i];
+        picture_t *ref = NULL, *out = NULL;
+
+        double fps_single = Bench(single->p_libvlc_int, c, &ref);
+        if (ref == NULL)
+            continue;
+        double fps_multi = Bench(multi->p_libvlc_int, c, &out);
+        assert(out != NULL);
+
+        log("%4.4s %ux%u -> %4.4s %ux%u: %.1f fps, %.1f fps threaded "
+            "(x%.2f), max difference %u\n",
+            (const char *)&c->i_chroma_in, c->i_width_in, c->i_height_in,
+            (const char *)&c->i_chroma_out, c->i_width_out, c->i_height_out,
+            fps_single, fps_multi, fps_multi / fps_single,
+            MaxDifference(ref, out));
+
+        picture_Release(out);
+        picture_Release(ref);
+    }
+
+    libvlc_release(multi);
+    libvlc_release(single);
+    return 0;
+}
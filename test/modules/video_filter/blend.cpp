@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * blend.cpp: blending fast paths test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vlc/vlc.h>
+#include "../../../lib/libvlc_internal.h"
+
+/* The generic templates are only reachable from within the module */
+#define MODULE_NAME blend
+#define MODULE_STRING "blend"
+#include "../../../modules/video_filter/blend.cpp"
+
+#define DST_WIDTH  720
+#define DST_HEIGHT 576
+#define BENCH_LOOPS 50
+
+/* Odd sizes and offsets, and a source clipped by the destination edges */
+static const struct
+{
+    unsigned width, height;
+    int x, y;
+} areas[] = {
+    { 333, 201, 0, 0 },
+    { 333, 201, 1, 1 },
+    { 333, 201, 101, 37 },
+    { 333, 201, 500, 400 },
+    { 1, 1, 3, 5 },
+    { DST_WIDTH, DST_HEIGHT, 0, 0 },
+};
+
+static const int alphas[] = { 1, 128, 255 };
+
+static void fill_picture(picture_t *pic, unsigned seed)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int j = 0; j < p->i_lines * p->i_pitch; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            p->p_pixels[j] = seed >> 16;
+        }
+    }
+}
+
+static void fill_palette(video_palette_t *palette)
+{
+    unsigned seed = 42;
+
+    palette->i_entries = 256;
+    for (unsigned i = 0; i < 256; i++)
+        for (unsigned j = 0; j < 4; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            palette->palette[i][j] = seed >> 16;
+        }
+}
+
+static filter_t *create_blend(libvlc_int_t *obj, vlc_fourcc_t dst,
+                              vlc_fourcc_t src, unsigned width,
+                              unsigned height)
+{
+    filter_t *filter = (filter_t *)vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, src);
+    video_format_Setup(&filter->fmt_in.video, src,
+                       width, height, width, height, 1, 1);
+    if (src == VLC_CODEC_YUVP)
+    {
+        filter->fmt_in.video.p_palette =
+            (video_palette_t *)malloc(sizeof (video_palette_t));
+        assert(filter->fmt_in.video.p_palette != NULL);
+        fill_palette(filter->fmt_in.video.p_palette);
+    }
+    es_format_Init(&filter->fmt_out, VIDEO_ES, dst);
+    video_format_Setup(&filter->fmt_out.video, dst, DST_WIDTH, DST_HEIGHT,
+                       DST_WIDTH, DST_HEIGHT, 1, 1);
+
+    assert(Open(VLC_OBJECT(filter)) == VLC_SUCCESS);
+    assert(filter->p_sys->fast != NULL);
+    return filter;
+}
+
+static void delete_blend(filter_t *filter)
+{
+    Close(VLC_OBJECT(filter));
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_release(filter);
+}
+
+/* Blends with the fast path, or with the generic template it replaces */
+static void blend(filter_t *filter, picture_t *dst, const picture_t *src,
+                  int x, int y, int alpha, bool fast)
+{
+    filter_sys_t *sys = filter->p_sys;
+    fast_blend_function_t fast_blend = sys->fast;
+
+    if (!fast)
+        sys->fast = NULL;
+    filter->pf_video_blend(filter, dst, src, x, y, alpha);
+    sys->fast = fast_blend;
+}
+
+static void compare_pictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            assert(!memcmp(pa->p_pixels + y * pa->i_pitch,
+                           pb->p_pixels + y * pb->i_pitch,
+                           pa->i_visible_pitch));
+    }
+}
+
+static void test_area(libvlc_int_t *obj, vlc_fourcc_t dst_chroma,
+                      vlc_fourcc_t src_chroma, unsigned i)
+{
+    filter_t *filter = create_blend(obj, dst_chroma, src_chroma,
+                                    areas[i].width, areas[i].height);
+
+    picture_t *src = picture_NewFromFormat(&filter->fmt_in.video);
+    picture_t *ref = picture_NewFromFormat(&filter->fmt_out.video);
+    picture_t *out = picture_NewFromFormat(&filter->fmt_out.video);
+    assert(src != NULL && ref != NULL && out != NULL);
+
+    fill_picture(src, i + 1);
+    for (size_t j = 0; j < ARRAY_SIZE(alphas); j++)
+    {
+        fill_picture(ref, 1234);
+        fill_picture(out, 1234);
+        blend(filter, ref, src, areas[i].x, areas[i].y, alphas[j], false);
+        blend(filter, out, src, areas[i].x, areas[i].y, alphas[j], true);
+        compare_pictures(ref, out);
+    }
+
+    picture_Release(out);
+    picture_Release(ref);
+    picture_Release(src);
+    delete_blend(filter);
+}
+
+static void bench(libvlc_int_t *obj, vlc_fourcc_t dst_chroma,
+                  vlc_fourcc_t src_chroma)
+{
+    filter_t *filter = create_blend(obj, dst_chroma, src_chroma,
+                                    DST_WIDTH, DST_HEIGHT);
+    picture_t *src = picture_NewFromFormat(&filter->fmt_in.video);
+    picture_t *dst = picture_NewFromFormat(&filter->fmt_out.video);
+    assert(src != NULL && dst != NULL);
+
+    fill_picture(src, 1);
+    fill_picture(dst, 2);
+
+    mtime_t times[2];
+    for (unsigned i = 0; i < 2; i++)
+    {
+        times[i] = mdate();
+        for (unsigned j = 0; j < BENCH_LOOPS; j++)
+            blend(filter, dst, src, 0, 0, 128, i != 0);
+        times[i] = __MAX(mdate() - times[i], 1);
+    }
+    printf("%4.4s onto %4.4s: generic %.3f ms, fast %.3f ms, speed up %.2f\n",
+           (const char *)&src_chroma, (const char *)&dst_chroma,
+           times[0] / (1000. * BENCH_LOOPS), times[1] / (1000. * BENCH_LOOPS),
+           (double)times[0] / times[1]);
+
+    picture_Release(dst);
+    picture_Release(src);
+    delete_blend(filter);
+}
+
+int main(void)
+{
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(fast_blends); i++)
+    {
+        for (size_t j = 0; j < ARRAY_SIZE(areas); j++)
+            test_area(vlc->p_libvlc_int, fast_blends[i].dst,
+                      fast_blends[i].src, j);
+        bench(vlc->p_libvlc_int, fast_blends[i].dst, fast_blends[i].src);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
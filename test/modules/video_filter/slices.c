@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * slices.c: slice-threaded video filters test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define FRAMES 8
+
+/* Filters ported onto vlc_slice_exec(), with the options selecting each
+ * of the sliced code paths */
+static const char *const filters[] = {
+    "deinterlace{mode=blend}",
+    "deinterlace{mode=x}",
+    "deinterlace{mode=yadif}",
+    "hqdn3d",
+    "hqdn3d{luma-temp=0,chroma-temp=0}",
+    "hqdn3d{luma-spat=0,chroma-spat=0}",
+};
+
+/* Odd sizes make sure the last slices and bands are partial */
+static const struct
+{
+    unsigned i_width, i_height;
+} sizes[] = {
+    { 720, 576 },
+    { 1366, 771 },
+    { 33, 17 },
+};
+
+static picture_t *NewPicture(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static void FillPicture(picture_t *pic, unsigned seed)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                /* Noise over a gradient, so that both the spatial and the
+                 * temporal filters have something to do */
+                p->p_pixels[y * p->i_pitch + x] = ((seed >> 16) & 0x3F)
+                                                + x + 2 * y;
+            }
+    }
+}
+
+static filter_t *CreateFilter(libvlc_int_t *obj, const char *chain,
+                              unsigned width, unsigned height)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup(&filter->fmt_in.video, VLC_CODEC_I420,
+                       width, height, width, height, 1, 1);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+    filter->owner.video.buffer_new = NewPicture;
+
+    char *name;
+    free(config_ChainCreate(&name, &filter->p_cfg, chain));
+    assert(name != NULL);
+
+    filter->p_module = module_need(filter, "video filter", name, true);
+    free(name);
+    if (filter->p_module == NULL)
+    {
+        config_ChainDestroy(filter->p_cfg);
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_release(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    module_unneed(filter, filter->p_module);
+    config_ChainDestroy(filter->p_cfg);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_release(filter);
+}
+
+static picture_t *FilterPicture(filter_t *filter, unsigned frame)
+{
+    picture_t *in = picture_NewFromFormat(&filter->fmt_in.video);
+    assert(in != NULL);
+
+    FillPicture(in, frame + 1);
+    in->date = VLC_TS_0 + frame * CLOCK_FREQ / 25;
+    in->b_progressive = false;
+    in->b_top_field_first = true;
+    return filter->pf_video_filter(filter, in);
+}
+
+static void ComparePictures(const picture_t *a, const picture_t *b)
+{
+    assert(a->i_planes == b->i_planes);
+    for (int i = 0; i < a->i_planes; i++)
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        assert(pa->i_visible_lines == pb->i_visible_lines);
+        assert(pa->i_visible_pitch == pb->i_visible_pitch);
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            assert(!memcmp(pa->p_pixels + y * pa->i_pitch,
+                           pb->p_pixels + y * pb->i_pitch,
+                           pa->i_visible_pitch));
+    }
+}
+
+static void test_filter(libvlc_int_t *single, libvlc_int_t *multi,
+                        const char *chain, unsigned width, unsigned height)
+{
+    filter_t *ref = CreateFilter(single, chain, width, height);
+    if (ref == NULL)
+    {
+        log("%s not available, skipped\n", chain);
+        return;
+    }
+
+    filter_t *test = CreateFilter(multi, chain, width, height);
+    assert(test != NULL);
+
+    log("Testing %s at %ux%u\n", chain, width, height);
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        picture_t *ref_out = FilterPicture(ref, i);
+        picture_t *test_out = FilterPicture(test, i);
+
+        /* Both drop the same frames (e.g. Yadif waiting for history) */
+        assert((ref_out == NULL) == (test_out == NULL));
+        if (ref_out == NULL)
+            continue;
+
+        ComparePictures(ref_out, test_out);
+        picture_Release(test_out);
+        picture_Release(ref_out);
+    }
+
+    DeleteFilter(test);
+    DeleteFilter(ref);
+}
+
+int main(void)
+{
+    static const char *argv_single[] = {
+        "-v", "--ignore-config", "--filter-threads=1",
+    };
+    /* More slices than lines in the smallest chroma planes */
+    static const char *argv_multi[] = {
+        "-v", "--ignore-config", "--filter-threads=13",
+    };
+
+    test_init();
+
+    libvlc_instance_t *single = libvlc_new(ARRAY_SIZE(argv_single),
+                                           argv_single);
+    libvlc_instance_t *multi = libvlc_new(ARRAY_SIZE(argv_multi), argv_multi);
+    assert(single != NULL && multi != NULL);
+
+    assert(vlc_slice_threads(single->p_libvlc_int) == 1);
+
+    for (size_t i = 0; i < ARRAY_SIZE(filters); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+            test_filter(single->p_libvlc_int, multi->p_libvlc_int,
+                        filters[i], sizes[j].i_width, sizes[j].i_height);
+
+    libvlc_release(multi);
+    libvlc_release(single);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * demux_index.c: test for the persistent demuxer index cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#define ENTRY_COUNT 1000
+
+static char cache_home[] = "/tmp/libvlc_XXXXXX";
+static char cache_dir[sizeof (cache_home) + sizeof ("/vlc/index")];
+
+static unsigned count_tables(void)
+{
+    DIR *dir = vlc_opendir(cache_dir);
+    const char *filename;
+    unsigned count = 0;
+
+    assert(dir != NULL);
+    while ((filename = vlc_readdir(dir)) != NULL)
+    {
+        size_t len = strlen(filename);
+        if (len >= 4 && !strcmp(filename + len - 4, ".idx"))
+            count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+static void clean_tables(void)
+{
+    DIR *dir = vlc_opendir(cache_dir);
+    const char *filename;
+
+    if (dir == NULL)
+        return;
+    while ((filename = vlc_readdir(dir)) != NULL)
+    {
+        char *path;
+        if (filename[0] == '.')
+            continue;
+        assert(asprintf(&path, "%s/%s", cache_dir, filename) != -1);
+        unlink(path);
+        free(path);
+    }
+    closedir(dir);
+}
+
+static void fill_entries(demux_index_entry_t *entries)
+{
+    for (unsigned i = 0; i < ENTRY_COUNT; i++)
+    {
+        entries[i].i_time = i * INT64_C(40000) - 1;
+        entries[i].i_offset = i * UINT64_C(0x100000001);
+        entries[i].i_size = 1000 + i;
+        entries[i].i_stream = i % 3;
+        entries[i].i_flags = i & 1;
+    }
+}
+
+static void test_round_trip(demux_t *demux)
+{
+    demux_index_entry_t entries[ENTRY_COUNT];
+    demux_index_entry_t *loaded;
+    size_t count;
+
+    fill_entries(entries);
+    assert(demux_IndexSave(demux, "test", entries, ENTRY_COUNT)
+           == VLC_SUCCESS);
+    assert(count_tables() == 1);
+
+    assert(demux_IndexLoad(demux, "test", &loaded, &count) == VLC_SUCCESS);
+    assert(count == ENTRY_COUNT);
+    for (unsigned i = 0; i < ENTRY_COUNT; i++)
+    {
+        assert(loaded[i].i_time == entries[i].i_time);
+        assert(loaded[i].i_offset == entries[i].i_offset);
+        assert(loaded[i].i_size == entries[i].i_size);
+        assert(loaded[i].i_stream == entries[i].i_stream);
+        assert(loaded[i].i_flags == entries[i].i_flags);
+    }
+    free(loaded);
+
+    /* Tables are per demuxer name */
+    assert(demux_IndexLoad(demux, "other", &loaded, &count) != VLC_SUCCESS);
+}
+
+static void test_stale(demux_t *demux, int fd)
+{
+    demux_index_entry_t *loaded;
+    size_t count;
+
+    /* A modified file is indexed again, and its old table is dropped */
+    assert(write(fd, "more", 4) == 4);
+    assert(demux_IndexLoad(demux, "test", &loaded, &count) != VLC_SUCCESS);
+    assert(count_tables() == 0);
+}
+
+static void test_eviction(demux_t *demux)
+{
+    demux_index_entry_t entries[ENTRY_COUNT];
+    struct stat st;
+    char *path;
+    FILE *file;
+
+    /* Tables that were not written for long are removed */
+    assert(asprintf(&path, "%s/old.idx", cache_dir) != -1);
+    file = vlc_fopen(path, "wb");
+    assert(file != NULL);
+    fclose(file);
+
+    struct utimbuf times = { .actime = 0, .modtime = 0 };
+    assert(utime(path, &times) == 0);
+    assert(count_tables() == 1);
+
+    fill_entries(entries);
+    assert(demux_IndexSave(demux, "test", entries, ENTRY_COUNT)
+           == VLC_SUCCESS);
+    assert(count_tables() == 1);
+    assert(vlc_stat(path, &st) != 0);
+    free(path);
+}
+
+int main(void)
+{
+    test_init();
+
+    assert(mkdtemp(cache_home) != NULL);
+    setenv("XDG_CACHE_HOME", cache_home, 1);
+    snprintf(cache_dir, sizeof (cache_dir), "%s/vlc/index", cache_home);
+
+    char file[] = "/tmp/libvlc_XXXXXX";
+    int fd = vlc_mkstemp(file);
+    assert(fd != -1);
+    assert(write(fd, "data", 4) == 4);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    demux_t *demux = vlc_object_create(vlc->p_libvlc_int, sizeof (*demux));
+    assert(demux != NULL);
+    demux->psz_file = file;
+
+    test_round_trip(demux);
+    test_stale(demux, fd);
+    test_eviction(demux);
+
+    vlc_object_release(demux);
+    libvlc_release(vlc);
+
+    close(fd);
+    unlink(file);
+    clean_tables();
+    rmdir(cache_dir);
+    snprintf(cache_dir, sizeof (cache_dir), "%s/vlc", cache_home);
+    rmdir(cache_dir);
+    rmdir(cache_home);
+    return 0;
+}
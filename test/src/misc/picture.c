@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * picture.c: picture copy and conversion benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#define FRAMES 50
+
+static const struct
+{
+    unsigned i_width, i_height;
+} sizes[] = {
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+
+static void FillPlane(plane_t *p, unsigned seed)
+{
+    for (int y = 0; y < p->i_lines; y++)
+        for (int x = 0; x < p->i_pitch; x++)
+        {
+            seed = seed * 1103515245 + 12345;
+            p->p_pixels[y * p->i_pitch + x] = seed >> 16;
+        }
+}
+
+/* Allocates a plane with an odd pitch */
+static void NewPlane(plane_t *p, unsigned width, unsigned height,
+                     unsigned padding)
+{
+    p->i_pitch = p->i_visible_pitch = width;
+    p->i_pitch += padding;
+    p->i_lines = p->i_visible_lines = height;
+    p->i_pixel_pitch = 1;
+    p->p_pixels = malloc(p->i_pitch * p->i_lines);
+    assert(p->p_pixels != NULL);
+    FillPlane(p, padding);
+}
+
+static void CheckPlanes(const plane_t *a, const plane_t *b)
+{
+    for (int y = 0; y < a->i_visible_lines; y++)
+        assert(!memcmp(&a->p_pixels[y * a->i_pitch],
+                       &b->p_pixels[y * b->i_pitch], a->i_visible_pitch));
+}
+
+static void BenchCopy(unsigned width, unsigned height)
+{
+    plane_t src, dst;
+
+    NewPlane(&src, width, height, 17);
+    NewPlane(&dst, width, height, 33);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < FRAMES; i++)
+        plane_CopyPixels(&dst, &src);
+    mtime_t duration = mdate() - start;
+    CheckPlanes(&src, &dst);
+
+    /* Reference line by line copy */
+    start = mdate();
+    for (unsigned i = 0; i < FRAMES; i++)
+        for (unsigned y = 0; y < height; y++)
+            memcpy(&dst.p_pixels[y * dst.i_pitch],
+                   &src.p_pixels[y * src.i_pitch], width);
+    mtime_t reference = mdate() - start;
+
+    log("plane copy %ux%u (pitches %d -> %d): %.1f fps, memcpy %.1f fps\n",
+        width, height, src.i_pitch, dst.i_pitch,
+        (double)FRAMES * CLOCK_FREQ / duration,
+        (double)FRAMES * CLOCK_FREQ / reference);
+
+    free(dst.p_pixels);
+    free(src.p_pixels);
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height)
+{
+    video_format_t fmt;
+
+    video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+        FillPlane(&pic->p[i], i + 1);
+    return pic;
+}
+
+/* Checks a conversion with the reference C code */
+static void CheckConversion(const picture_t *src, const picture_t *dst)
+{
+    const vlc_fourcc_t in = src->format.i_chroma;
+    const vlc_fourcc_t out = dst->format.i_chroma;
+    const unsigned width = src->format.i_width;
+    const unsigned height = src->format.i_height;
+
+    for (unsigned y = 0; y < height; y++)
+        for (unsigned x = 0; x < width; x++)
+        {
+            uint8_t Y, U, V, y1, u1, v1;
+
+            if (in == VLC_CODEC_NV12)
+            {
+                Y = src->p[0].p_pixels[y * src->p[0].i_pitch + x];
+                U = src->p[1].p_pixels[y/2 * src->p[1].i_pitch + x/2*2];
+                V = src->p[1].p_pixels[y/2 * src->p[1].i_pitch + x/2*2 + 1];
+            }
+            else
+            {
+                Y = src->p[0].p_pixels[y * src->p[0].i_pitch + x];
+                U = src->p[1].p_pixels[y/2 * src->p[1].i_pitch + x/2];
+                V = src->p[2].p_pixels[y/2 * src->p[2].i_pitch + x/2];
+            }
+
+            if (out == VLC_CODEC_NV12)
+            {
+                y1 = dst->p[0].p_pixels[y * dst->p[0].i_pitch + x];
+                u1 = dst->p[1].p_pixels[y/2 * dst->p[1].i_pitch + x/2*2];
+                v1 = dst->p[1].p_pixels[y/2 * dst->p[1].i_pitch + x/2*2 + 1];
+            }
+            else if (out == VLC_CODEC_YUYV)
+            {
+                const uint8_t *p = &dst->p[0].p_pixels[y * dst->p[0].i_pitch
+                                                       + x/2*4];
+                y1 = p[(x & 1) * 2];
+                u1 = p[1];
+                v1 = p[3];
+            }
+            else
+            {
+                y1 = dst->p[0].p_pixels[y * dst->p[0].i_pitch + x];
+                u1 = dst->p[1].p_pixels[y/2 * dst->p[1].i_pitch + x/2];
+                v1 = dst->p[2].p_pixels[y/2 * dst->p[2].i_pitch + x/2];
+            }
+            assert(Y == y1 && U == u1 && V == v1);
+        }
+}
+
+static void BenchConversion(vlc_fourcc_t in, vlc_fourcc_t out,
+                            unsigned width, unsigned height)
+{
+    picture_t *src = NewPicture(in, width, height);
+    picture_t *dst = NewPicture(out, width, height);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        int ret = picture_ConvertPixels(dst, src);
+        assert(ret == VLC_SUCCESS);
+    }
+    mtime_t duration = mdate() - start;
+    CheckConversion(src, dst);
+
+    log("%4.4s -> %4.4s %ux%u: %.1f fps\n",
+        (const char *)&in, (const char *)&out, width, height,
+        (double)FRAMES * CLOCK_FREQ / duration);
+
+    picture_Release(dst);
+    picture_Release(src);
+}
+
+int main(void)
+{
+    test_init();
+    alarm(0); /* benchmarks take their time */
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        const unsigned width = sizes[i].i_width;
+        const unsigned height = sizes[i].i_height;
+
+        BenchCopy(width, height);
+        BenchConversion(VLC_CODEC_NV12, VLC_CODEC_I420, width, height);
+        BenchConversion(VLC_CODEC_I420, VLC_CODEC_NV12, width, height);
+        BenchConversion(VLC_CODEC_I420, VLC_CODEC_YUYV, width, height);
+    }
+    return 0;
+}
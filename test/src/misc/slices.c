@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * slices.c: test for slice-threaded execution
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_atomic.h>
+
+#define SLICES 257
+
+struct slice_test
+{
+    atomic_uint runs[SLICES];
+    atomic_uint total;
+    unsigned count;
+};
+
+static void RunSlice(void *opaque, unsigned slice, unsigned count)
+{
+    struct slice_test *test = opaque;
+
+    assert(count == test->count);
+    assert(slice < count);
+    atomic_fetch_add(&test->runs[slice], 1);
+    atomic_fetch_add(&test->total, 1);
+}
+
+static void test_slices(libvlc_int_t *obj, unsigned count)
+{
+    struct slice_test test;
+
+    for (unsigned i = 0; i < SLICES; i++)
+        atomic_init(&test.runs[i], 0);
+    atomic_init(&test.total, 0);
+    test.count = count;
+
+    vlc_slice_exec(obj, RunSlice, &test, count);
+
+    assert(atomic_load(&test.total) == count);
+    for (unsigned i = 0; i < count; i++)
+        assert(atomic_load(&test.runs[i]) == 1);
+}
+
+struct nested_test
+{
+    libvlc_int_t *obj;
+};
+
+static void RunNested(void *opaque, unsigned slice, unsigned count)
+{
+    struct nested_test *nested = opaque;
+
+    (void) slice; (void) count;
+    /* Slices may themselves be processed by slices */
+    test_slices(nested->obj, SLICES);
+}
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+
+    test_init();
+
+    vlc = libvlc_new(test_defaults_nargs, test_defaults_args);
+    assert(vlc != NULL);
+
+    libvlc_int_t *obj = vlc->p_libvlc_int;
+
+    log("Testing with %u thread(s)\n", vlc_slice_threads(obj));
+    assert(vlc_slice_threads(obj) >= 1);
+
+    test_slices(obj, 0);
+    test_slices(obj, 1);
+    test_slices(obj, SLICES);
+
+    for (unsigned i = 0; i < 100; i++)
+        test_slices(obj, 1 + (i % SLICES));
+
+    struct nested_test nested = { obj };
+    vlc_slice_exec(obj, RunNested, &nested, 8);
+
+    libvlc_release(vlc);
+    return 0;
+}